@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "feeds.h"
 #include "gmcerts.h"
 #include "gmdocument.h"
+#include "gmrequest.h"
 #include "gmutil.h"
 #include "history.h"
 #include "ipc.h"
@@ -45,6 +46,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "ui/labelwidget.h"
 #include "ui/listwidget.h"
 #include "ui/lookupwidget.h"
+#include "ui/profiler.h"
 #include "ui/root.h"
 #include "ui/sidebarwidget.h"
 #include "ui/text.h"
@@ -136,10 +138,12 @@ static const char *defaultDataDir_App_ = "~/config/settings/lagrange";
 #   define PREFS_NAME "prefs"
 #endif
 
-static const char *prefsFileName_App_      = PREFS_NAME ".cfg";
-static const char *oldStateFileName_App_   = STATE_NAME ".binary";
-static const char *stateFileName_App_      = STATE_NAME ".lgr";
-static const char *tempStateFileName_App_  = STATE_NAME ".lgr.tmp";
+static const char *prefsFileName_App_       = PREFS_NAME ".cfg";
+static const char *oldStateFileName_App_    = STATE_NAME ".binary";
+static const char *stateFileName_App_       = STATE_NAME ".lgr";
+static const char *tempStateFileName_App_   = STATE_NAME ".lgr.tmp";
+static const char *contentFileName_App_     = STATE_NAME "-content.lgr";
+static const char *tempContentFileName_App_ = STATE_NAME "-content.lgr.tmp";
 static const char *defaultDownloadDir_App_ = "~/Downloads";
 
 static const int    idleThreshold_App_             = 1000; /* ms */
@@ -155,6 +159,10 @@ struct Impl_App {
     iStringSet * tempFilesPendingDeletion;
     iStringList *recentlyClosedTabUrls; /* for reopening, like an undo stack */
     iStringArray *recentlySubmittedInput;
+    iFile *      savedContent; /* cached responses of restored tabs, read when needed */
+    size_t       savedContentSize;     /* committed size; appends being written are not included */
+    size_t       compactedContentSize; /* size when the content file was last rewritten */
+    iThread *    snapshotWriter;       /* writes the latest state snapshot to disk */
     iStringHash *savedWidths;
     iMimeHooks * mimehooks;
     iGmCerts *   certs;
@@ -330,6 +338,7 @@ static iString *serializePrefs_App_(const iApp *d) {
     appendFormat_String(str, "cachesize.set arg:%d\n", d->prefs.maxCacheSize);
     appendFormat_String(str, "memorysize.set arg:%d\n", d->prefs.maxMemorySize);
     appendFormat_String(str, "urlsize.set arg:%d\n", d->prefs.maxUrlSize);
+    appendFormat_String(str, "filterhooks.max arg:%d\n", d->prefs.maxFilterHooks);
     appendFormat_String(str, "decodeurls arg:%d\n", d->prefs.decodeUserVisibleURLs);
     appendFormat_String(str, "linewidth.set arg:%d\n", d->prefs.lineWidth);
     appendFormat_String(str, "linespacing.set arg:%f\n", d->prefs.lineSpacing);
@@ -713,6 +722,7 @@ static const char *magicWindow_App_      = "wind";
 static const char *magicTabDocument_App_ = "tabd";
 static const char *magicSidebar_App_     = "side";
 static const char *magicInput_App_       = "inpt";
+static const char *magicContent_App_     = "lgC1";
 
 enum iDocumentStateFlag {
     current_DocumentStateFlag    = iBit(1),
@@ -747,6 +757,145 @@ static iRect initialWindowRect_App_(const iApp *d, size_t windowIndex) {
     return rect;
 }
 
+static void openSavedContent_App_(iApp *d) {
+    /* If the file was written during this session, the sizes are already known. A failed
+       append may have left unused data at the end of the file. */
+    const iBool isSizeKnown = (d->savedContentSize != 0);
+    iReleasePtr(&d->savedContent);
+    iFile *f = newCStr_File(concatPath_CStr(dataDir_App_(), contentFileName_App_));
+    if (open_File(f, readOnly_FileMode)) {
+        char magic[4];
+        readData_File(f, 4, magic);
+        const uint32_t version = readU32_File(f);
+        if (!memcmp(magic, magicContent_App_, 4) && version <= latest_FileVersion) {
+            setVersion_Stream(stream_File(f), version);
+            d->savedContent = f;
+            if (!isSizeKnown) {
+                d->savedContentSize = size_Stream(stream_File(f));
+                d->compactedContentSize = d->savedContentSize;
+            }
+            return;
+        }
+        printf("%s: format not recognized\n", cstr_String(path_File(f)));
+    }
+    iRelease(f);
+    d->savedContentSize = 0;
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+iDeclareType(StateSnapshot)
+iDeclareTypeConstruction(StateSnapshot)
+
+/* Serialized app state waiting to be written to disk. */
+struct Impl_StateSnapshot {
+    iBuffer *state;
+    iBuffer *content;         /* newly saved cached responses; NULL if content is not saved */
+    iBool    isNewContent;    /* replaces the content file instead of being appended to it */
+    size_t   contentSize;     /* size of the content file once written */
+    iFile   *prevContent;     /* content file being replaced; kept open until committed */
+    iBool    isFailed;        /* set by the writer thread */
+    iString  statePath;       /* paths are composed in the main thread */
+    iString  tempStatePath;
+    iString  contentPath;
+    iString  tempContentPath;
+};
+
+void init_StateSnapshot(iStateSnapshot *d) {
+    d->state = new_Buffer();
+    openEmpty_Buffer(d->state);
+    d->content      = NULL;
+    d->isNewContent = iFalse;
+    d->contentSize  = 0;
+    d->prevContent  = NULL;
+    d->isFailed     = iFalse;
+    initCStr_String(&d->statePath,       concatPath_CStr(dataDir_App_(), stateFileName_App_));
+    initCStr_String(&d->tempStatePath,   concatPath_CStr(dataDir_App_(), tempStateFileName_App_));
+    initCStr_String(&d->contentPath,     concatPath_CStr(dataDir_App_(), contentFileName_App_));
+    initCStr_String(&d->tempContentPath, concatPath_CStr(dataDir_App_(), tempContentFileName_App_));
+}
+
+void deinit_StateSnapshot(iStateSnapshot *d) {
+    deinit_String(&d->tempContentPath);
+    deinit_String(&d->contentPath);
+    deinit_String(&d->tempStatePath);
+    deinit_String(&d->statePath);
+    iRelease(d->prevContent);
+    iRelease(d->content);
+    iRelease(d->state);
+}
+
+iDefineTypeConstruction(StateSnapshot)
+
+static iBool writeFile_StateSnapshot_(const iBuffer *buf, const iString *path, int mode) {
+    iFile *f  = new_File(path);
+    iBool  ok = iFalse;
+    if (open_File(f, mode)) {
+        const iBlock *data = data_Buffer(buf);
+        ok = (write_File(f, data) == size_Block(data));
+    }
+    iRelease(f);
+    return ok;
+}
+
+static iThreadResult write_StateSnapshot_(iThread *thread) {
+    iStateSnapshot *d = userData_Thread(thread);
+    /* The state refers to saved content, so it is only updated if the content is in place.
+       Appended content is not referred to by the old state, but new content replacing the
+       whole file is only committed together with the state. */
+    iBool ok = iTrue;
+    if (d->content) {
+        ok = d->isNewContent
+                 ? writeFile_StateSnapshot_(d->content, &d->tempContentPath, writeOnly_FileMode)
+                 : writeFile_StateSnapshot_(d->content, &d->contentPath, append_FileMode);
+    }
+    if (!ok || !writeFile_StateSnapshot_(d->state, &d->tempStatePath, writeOnly_FileMode)) {
+        fprintf(stderr, "[App] failed to save state: %s\n", strerror(errno));
+        d->isFailed = iTrue;
+        return 0;
+    }
+    /* Copy them over to the real files. This avoids truncation if the app for any reason
+       crashes before the files are fully written. */
+    if (d->content && d->isNewContent) {
+        iReleasePtr(&d->prevContent); /* can't be replaced while open */
+        commitFile_App(cstr_String(&d->contentPath), cstr_String(&d->tempContentPath));
+    }
+    commitFile_App(cstr_String(&d->statePath), cstr_String(&d->tempStatePath));
+    return 0;
+}
+
+static void waitForSnapshot_App_(iApp *d) {
+    if (d->snapshotWriter) {
+        join_Thread(d->snapshotWriter);
+        iStateSnapshot *snap = userData_Thread(d->snapshotWriter);
+        if (snap->content) {
+            /* Content positions assigned during the save are only valid if it was written. */
+            iConstForEach(ObjectList, i, iClob(listDocuments_App(NULL))) {
+                commitContent_History(
+                    history_DocumentWidget(i.object), !snap->isFailed, snap->isNewContent);
+            }
+            if (!snap->isFailed) {
+                /* A replaced content file is reopened when needed. */
+                d->savedContentSize = snap->contentSize;
+                if (snap->isNewContent) {
+                    d->compactedContentSize = snap->contentSize;
+                }
+            }
+            else {
+                /* Keep using the previous content file, and rewrite it next time. */
+                if (snap->prevContent) {
+                    iAssert(!d->savedContent);
+                    d->savedContent   = snap->prevContent;
+                    snap->prevContent = NULL;
+                }
+                d->compactedContentSize = 0;
+            }
+        }
+        delete_StateSnapshot(snap);
+        iReleasePtr(&d->snapshotWriter);
+    }
+}
+
 static iBool loadState_App_(iApp *d) {
     iUnused(d);
     const char *oldPath = concatPath_CStr(dataDir_App_(), oldStateFileName_App_);
@@ -766,6 +915,10 @@ static iBool loadState_App_(iApp *d) {
             return iFalse;
         }
         setVersion_Stream(stream_File(f), version);
+        if (version >= separateContentFile_FileVersion) {
+            /* Cached responses are read from here when each tab is first shown. */
+            openSavedContent_App_(d);
+        }
         /* Window state. */
         iDeclareType(CurrentTabs);
         struct Impl_CurrentTabs {
@@ -915,7 +1068,7 @@ static iBool loadState_App_(iApp *d) {
     return iFalse;
 }
 
-static void saveState_App_(const iApp *d, iBool withContent) {
+static void saveState_App_(iApp *d, iBool withContent) {
     if (isAppleDesktop_Platform() && isEmpty_PtrArray(&d->mainWindows)) {
         return; /* nothing to save; keep what was saved earlier */
     }
@@ -926,75 +1079,102 @@ static void saveState_App_(const iApp *d, iBool withContent) {
        navigation history, cached content) and depends closely on the widget
        tree. The data is largely not reorderable and should not be modified
        by the user manually. */
-    iFile *f = newCStr_File(concatPath_CStr(dataDir_App_(), tempStateFileName_App_));
-    if (open_File(f, writeOnly_FileMode)) {
-        writeData_File(f, magicState_App_, 4);
-        writeU32_File(f, latest_FileVersion); /* version */
+    /* The state is captured in memory here and written to disk in a background thread.
+       Only one snapshot is being written at a time. */
+    waitForSnapshot_App_(d);
+    iStateSnapshot *snap        = new_StateSnapshot();
+    iStream        *outs        = stream_Buffer(snap->state);
+    iStream        *contentOuts = NULL;
+    size_t          contentBase = 0;
+    if (withContent) {
+        /* Cached responses go in a separate file so they can be read on demand. Responses
+           saved there earlier are not written again; the file is rewritten from scratch once
+           it has grown to twice its compacted size. */
+        snap->content = new_Buffer();
+        openEmpty_Buffer(snap->content);
+        contentOuts = stream_Buffer(snap->content);
+        snap->isNewContent = (d->savedContentSize == 0 ||
+                              d->savedContentSize >= 2 * d->compactedContentSize);
+        if (snap->isNewContent) {
+            writeData_Stream(contentOuts, magicContent_App_, 4);
+            writeU32_Stream(contentOuts, latest_FileVersion); /* version */
+        }
+        else {
+            contentBase = d->savedContentSize;
+        }
+    }
+    /* Write into the snapshot buffer. */ {
+        writeData_Stream(outs, magicState_App_, 4);
+        writeU32_Stream(outs, latest_FileVersion); /* version */
         /* Recently submitted input strings. */
-        writeData_File(f, magicInput_App_, 4);
-        serialize_StringArray(d->recentlySubmittedInput, stream_File(f));
+        writeData_Stream(outs, magicInput_App_, 4);
+        serialize_StringArray(d->recentlySubmittedInput, outs);
         iConstForEach(PtrArray, winIter, &d->mainWindows) {
             const iMainWindow *win = winIter.ptr;
             setCurrent_Window(winIter.ptr);
             /* Window state. */ {
-                writeData_File(f, magicWindow_App_, 4);
-                writeU32_File(f, win->splitMode);
-                writeU32_File(f, (win->base.keyRoot == win->base.roots[0] ? 0 : 1) |
-                                 (constAs_Window(win) == d->window ? current_WindowStateFlag : 0));
+                writeData_Stream(outs, magicWindow_App_, 4);
+                writeU32_Stream(outs, win->splitMode);
+                writeU32_Stream(outs, (win->base.keyRoot == win->base.roots[0] ? 0 : 1) |
+                                      (constAs_Window(win) == d->window ? current_WindowStateFlag : 0));
             }
             /* State of UI elements. */ {
                 iForIndices(i, win->base.roots) {
                     const iRoot *root = win->base.roots[i];
                     if (root) {
-                        writeData_File(f, magicSidebar_App_, 4);
+                        writeData_Stream(outs, magicSidebar_App_, 4);
                         const iSidebarWidget *sidebar  = findChild_Widget(root->widget, "sidebar");
                         const iSidebarWidget *sidebar2 = findChild_Widget(root->widget, "sidebar2");
-                        writeU16_File(f, i |
-                                      (isVisible_Widget(sidebar)  ? 0x100 : 0) |
-                                      (isVisible_Widget(sidebar2) ? 0x200 : 0) |
-                                      (feedsMode_SidebarWidget(sidebar)  == unread_FeedsMode ? 0x400 : 0) |
-                                      (feedsMode_SidebarWidget(sidebar2) == unread_FeedsMode ? 0x800 : 0));
-                        writeU8_File(f,
-                                     mode_SidebarWidget(sidebar) |
-                                     (mode_SidebarWidget(sidebar2) << 4));
-                        writef_Stream(stream_File(f), width_SidebarWidget(sidebar));
-                        writef_Stream(stream_File(f), width_SidebarWidget(sidebar2));
-                        serialize_IntSet(closedFolders_SidebarWidget(sidebar), stream_File(f));
-                        serialize_IntSet(closedFolders_SidebarWidget(sidebar2), stream_File(f));
+                        writeU16_Stream(outs, i |
+                                        (isVisible_Widget(sidebar)  ? 0x100 : 0) |
+                                        (isVisible_Widget(sidebar2) ? 0x200 : 0) |
+                                        (feedsMode_SidebarWidget(sidebar)  == unread_FeedsMode ? 0x400 : 0) |
+                                        (feedsMode_SidebarWidget(sidebar2) == unread_FeedsMode ? 0x800 : 0));
+                        writeU8_Stream(outs,
+                                       mode_SidebarWidget(sidebar) |
+                                       (mode_SidebarWidget(sidebar2) << 4));
+                        writef_Stream(outs, width_SidebarWidget(sidebar));
+                        writef_Stream(outs, width_SidebarWidget(sidebar2));
+                        serialize_IntSet(closedFolders_SidebarWidget(sidebar), outs);
+                        serialize_IntSet(closedFolders_SidebarWidget(sidebar2), outs);
                     }
                 }
             }
             iConstForEach(ObjectList, i, iClob(listDocuments_App(NULL))) {
                 iAssert(isInstance_Object(i.object, &Class_DocumentWidget));
                 const iWidget *widget = constAs_Widget(i.object);
-                writeData_File(f, magicTabDocument_App_, 4);
+                writeData_Stream(outs, magicTabDocument_App_, 4);
                 int8_t flags = (document_Root(widget->root) == i.object ? current_DocumentStateFlag : 0);
                 if (widget->root == win->base.roots[1]) {
                     flags |= rootIndex1_DocumentStateFlag;
                 }
-                write8_File(f, flags);
-                serializeState_DocumentWidget(i.object, stream_File(f), withContent);
+                write8_Stream(outs, flags);
+                serializeState_DocumentWidget(i.object, outs, contentOuts, contentBase);
             }
         }
-        iRelease(f);
     }
-    else {
-        iRelease(f);
-        fprintf(stderr, "[App] failed to save state: %s\n", strerror(errno));
-        return;
+    if (contentOuts) {
+        const size_t size = size_Block(data_Buffer(snap->content));
+        snap->contentSize = contentBase + size;
+        if (snap->isNewContent) {
+            /* The writer closes the previous file once the new one is ready to replace it. */
+            snap->prevContent = d->savedContent;
+            d->savedContent   = NULL;
+        }
     }
-    /* Copy it over to the real file. This avoids truncation if the app for any reason crashes
-       before the state file is fully written. */
-    commitFile_App(concatPath_CStr(dataDir_App_(), stateFileName_App_),
-                   concatPath_CStr(dataDir_App_(), tempStateFileName_App_));
+    d->snapshotWriter = new_Thread(write_StateSnapshot_);
+    setUserData_Thread(d->snapshotWriter, snap);
+    start_Thread(d->snapshotWriter);
 }
 
 void commitFile_App(const char *path, const char *tempPathWithNewContents) {
-    iString *oldPath = collectNewCStr_String(path);
+    /* Not using collected strings; this is also called in the state snapshot writer thread. */
+    iString *oldPath = newCStr_String(path);
     appendCStr_String(oldPath, ".old");
     rename(path, cstr_String(oldPath));
     rename(tempPathWithNewContents, path);
     remove(cstr_String(oldPath));
+    delete_String(oldPath);
 }
 
 #if defined (LAGRANGE_ENABLE_IDLE_SLEEP)
@@ -1167,6 +1347,10 @@ static void init_App_(iApp *d, int argc, char **argv) {
     d->tempFilesPendingDeletion = new_StringSet();
     d->recentlyClosedTabUrls = new_StringList();
     d->recentlySubmittedInput = new_StringArray();
+    d->savedContent = NULL;
+    d->savedContentSize = 0;
+    d->compactedContentSize = 0;
+    d->snapshotWriter = NULL;
     d->savedWidths = new_StringHash();
     d->overrideDataPath = NULL;
     d->didCheckDataPathOption = iFalse;
@@ -1214,6 +1398,7 @@ static void init_App_(iApp *d, int argc, char **argv) {
         }
     }
     init_Lang();
+    init_RequestScheduler();
     iStringList *openCmds = new_StringList();
 #if !defined (iPlatformAndroidMobile)
     /* Configure the valid command line options. */ {
@@ -1515,6 +1700,7 @@ static void deinit_App(iApp *d) {
 #endif
     SDL_RemoveTimer(d->autoReloadTimer);
     saveState_App_(d, iTrue);
+    waitForSnapshot_App_(d);
     savePrefs_App_(d);
     iReverseForEach(PtrArray, j, &d->mainWindows) {
         delete_MainWindow(j.ptr);
@@ -1548,12 +1734,14 @@ static void deinit_App(iApp *d) {
     deinit_Periodic(&d->periodic);
     deinit_Lang();
     iRecycle();
+    deinit_RequestScheduler();
     /* Delete all temporary files created while running. */
     iConstForEach(StringSet, tmp, d->tempFilesPendingDeletion) {
         remove(cstr_String(tmp.value));
     }
     deinit_Array(&d->initialWindowRects);
     iRelease(d->savedWidths);
+    iRelease(d->savedContent);
     iRelease(d->recentlySubmittedInput);
     iRelease(d->recentlyClosedTabUrls);
     iRelease(d->tempFilesPendingDeletion);
@@ -1704,6 +1892,8 @@ const iString *debugInfo_App(void) {
     iConstForEach(StringList, j, d->launchCommands) {
         appendFormat_String(msg, "%s\n", cstr_String(j.value));
     }
+    appendFormat_String(msg, "## Request scheduler\n");
+    append_String(msg, debugInfo_RequestScheduler());
     appendFormat_String(msg, "## MIME hooks\n");
     append_String(msg, debugInfo_MimeHooks(d->mimehooks));
     return msg;
@@ -1790,6 +1980,16 @@ void saveStateQuickly_App(void) {
     saveState_App_(&app_, iFalse /* cached content is not saved */);
 }
 
+iStream *savedContent_App(void) {
+    iApp *d = &app_;
+    /* Recently saved content may still be on its way to disk. */
+    waitForSnapshot_App_(d);
+    if (!d->savedContent && d->savedContentSize) {
+        openSavedContent_App_(d);
+    }
+    return d->savedContent ? stream_File(d->savedContent) : NULL;
+}
+
 const iStringArray *recentlySubmittedInput_App(void) {
     return app_.recentlySubmittedInput;
 }
@@ -1881,6 +2081,7 @@ static iBool                pendingMotionPosted_;
 static SDL_MouseMotionEvent pendingMotion_;
 
 static iBool nextEvent_App_(iApp *d, enum iAppEventMode eventMode, SDL_Event *event) {
+    endPhase_Profiler(events_ProfilerPhase); /* waiting for events is not included */
 #if !defined (iPlatformApple)
     /* If there is accumulated mouse motion, don't spend too long processing events.
         We want to refresh the UI ASAP, if necessary. */
@@ -1940,6 +2141,7 @@ void processEvents_App(enum iAppEventMode eventMode) {
     pendingMotionPosted_ = iFalse;
     iZap(pendingMotion_);
     while (nextEvent_App_(d, gotRefresh ? postedEventsOnly_AppEventMode : eventMode, &ev)) {
+        beginPhase_Profiler(events_ProfilerPhase);
 #if defined (iPlatformAppleMobile)
         if (processEvent_iOS(&ev)) {
             continue;
@@ -1987,6 +2189,7 @@ void processEvents_App(enum iAppEventMode eventMode) {
                 }
                 savePrefs_App_(d);
                 saveState_App_(d, iTrue);
+                waitForSnapshot_App_(d); /* the app may be terminated while in background */
                 d->isSuspended = iTrue;
                 if (d->isTextInputActive) {
                     SDL_StopTextInput();
@@ -1999,6 +2202,7 @@ void processEvents_App(enum iAppEventMode eventMode) {
                 }
                 savePrefs_App_(d);
                 saveState_App_(d, iTrue);
+                waitForSnapshot_App_(d);
                 break;
             }
             case SDL_DROPFILE: {
@@ -2336,6 +2540,7 @@ void processEvents_App(enum iAppEventMode eventMode) {
     }
 #endif
 backToMainLoop:;
+    endPhase_Profiler(events_ProfilerPhase);
     setCurrent_Root(oldCurrentRoot);
 }
 
@@ -2360,6 +2565,7 @@ static void runTickers_App_(iApp *d) {
         }
         delete_PtrArray(winList);
     }
+    beginPhase_Profiler(tickers_ProfilerPhase);
     /* Tickers may add themselves again, so we'll run off a copy. */
     iSortedArray *pending = copy_SortedArray(&d->tickers);
     clear_SortedArray(&d->tickers);
@@ -2375,6 +2581,7 @@ static void runTickers_App_(iApp *d) {
     }
     setCurrent_Root(NULL);
     delete_SortedArray(pending);
+    endPhase_Profiler(tickers_ProfilerPhase);
     if (isEmpty_SortedArray(&d->tickers)) {
         d->lastTickerTime = 0;
     }
@@ -2481,24 +2688,22 @@ void refresh_App(void) {
                 continue; /* No need to draw this window. */
             }
             setCurrent_Window(win);
+            beginPhase_Profiler(draw_ProfilerPhase);
             switch (win->type) {
-                case main_WindowType: {
-//                    iTime draw;
-//                    initCurrent_Time(&draw);
+                case main_WindowType:
                     draw_MainWindow(as_MainWindow(win));
-//                    printf("draw: %lld \u03bcs\n", (long long) (elapsedSeconds_Time(&draw) * 1000000));
-//                    fflush(stdout);
                     break;
-                }
                 default:
                     draw_Window(win);
                     break;
             }
+            endPhase_Profiler(draw_ProfilerPhase);
             win->frameCount++;
             if (isTerminal_Platform()) {
                 sleep_Thread(1.0 / 60.0);
             }
         }
+        endFrame_Profiler();
     }
     else {
 #if defined (iPlatformApple)
@@ -2620,12 +2825,10 @@ int run_App(int argc, char **argv) {
     return rc;
 }
 
-void postRefresh_Window(iAnyWindow *windowPtr) {
-    iApp *d = &app_;
+static void postRefresh_App_(iApp *d, iWindow *window) {
 #if defined (LAGRANGE_ENABLE_IDLE_SLEEP)
     d->isIdling = iFalse;
 #endif
-    iWindow *window = windowPtr;
     iAtomicInt *pendingWindow = (window ? &window->isRefreshPending : NULL);
     iBool wasPending = exchange_Atomic(&d->pendingRefresh, iTrue);
     if (pendingWindow) {
@@ -2638,6 +2841,23 @@ void postRefresh_Window(iAnyWindow *windowPtr) {
     }
 }
 
+void postRefresh_Window(iAnyWindow *windowPtr) {
+    iWindow *window = windowPtr;
+    if (window) {
+        set_Atomic(&window->isFullRedrawPending, iTrue);
+    }
+    postRefresh_App_(&app_, window);
+}
+
+void postRefreshRect_Window(iAnyWindow *windowPtr, iRect damage) {
+    /* Only called in the main thread, when a widget has changed. */
+    iWindow *window = windowPtr;
+    if (window && !isEmpty_Rect(damage)) {
+        window->damage = isEmpty_Rect(window->damage) ? damage : union_Rect(window->damage, damage);
+    }
+    postRefresh_App_(&app_, window);
+}
+
 void postRefreshAllWindows_App(void) {
     iApp *d = &app_;
     iConstForEach(PtrArray, m, &d->mainWindows) {
@@ -4072,6 +4292,10 @@ static iBool handleNonWindowRelatedCommand_App_(iApp *d, const char *cmd) {
         }
         return iTrue;
     }
+    else if (equal_Command(cmd, "filterhooks.max")) {
+        d->prefs.maxFilterHooks = iMax(1, arg_Command(cmd));
+        return iTrue;
+    }
     else if (equal_Command(cmd, "searchurl")) {
         iString *url = &d->prefs.strings[searchUrl_PrefsString];
         setCStr_String(url, suffixPtr_Command(cmd, "address"));
@@ -4231,6 +4455,27 @@ static iBool handleNonWindowRelatedCommand_App_(iApp *d, const char *cmd) {
         postCommand_App("idents.changed");
         return iTrue;
     }
+    else if (equal_Command(cmd, "profiler.toggle")) {
+        setEnabled_Profiler(!isEnabled_Profiler());
+        postCommand_App("navigate.reload");
+        return iTrue;
+    }
+    else if (equal_Command(cmd, "profiler.overlay")) {
+        setOverlay_Profiler(!isOverlayVisible_Profiler());
+        postRefreshAllWindows_App();
+        postCommand_App("navigate.reload");
+        return iTrue;
+    }
+    else if (equal_Command(cmd, "profiler.export")) {
+        const iString *path = collect_String(concatCStr_Path(downloadDir_App(), "lagrange_trace.json"));
+        if (!exportTrace_Profiler(path)) {
+            makeSimpleMessage_Widget(uiTextCaution_ColorEscape "${heading.save.error}",
+                                     strerror(errno));
+            return iTrue;
+        }
+        postCommand_App("navigate.reload");
+        return iTrue;
+    }
     else if (equal_Command(cmd, "os.theme.changed")) {
         const int dark = argLabel_Command(cmd, "dark");
         d->isDarkSystemTheme = dark;
@@ -5067,8 +5312,7 @@ iBool handleCommand_App(const char *cmd) {
         if (hasLabel_Command(cmd, "arg")) {
             /* This is triggered via the bookmark button context menu. Just add the bookmark
                with the default values. */
-            const uint32_t bmId = add_Bookmarks(bookmarks_App(), url, title, NULL, icon);
-            get_Bookmarks(bookmarks_App(), bmId)->parentId = arg_Command(cmd);
+            addToFolder_Bookmarks(bookmarks_App(), url, title, NULL, icon, arg_Command(cmd));
             postCommand_App("bookmarks.changed");
             return iTrue;
         }
@@ -5088,7 +5332,7 @@ iBool handleCommand_App(const char *cmd) {
     else if (equal_Command(cmd, "bookmark.setfolder")) {
         const uint32_t bmId = argLabel_Command(cmd, "bmid");
         const uint32_t destFolder = arg_Command(cmd);
-        get_Bookmarks(bookmarks_App(), bmId)->parentId = destFolder;
+        setParent_Bookmarks(bookmarks_App(), bmId, destFolder);
         postCommand_App("bookmarks.changed");
         return iTrue;
     }
@@ -5103,11 +5347,9 @@ iBool handleCommand_App(const char *cmd) {
     else if (equal_Command(cmd, "bookmarks.addfolder")) {
         const int parentId = argLabel_Command(cmd, "parent");
         if (suffixPtr_Command(cmd, "value")) {
-            uint32_t id = add_Bookmarks(d->bookmarks, NULL,
-                                        collect_String(suffix_Command(cmd, "value")), NULL, 0);
-            if (parentId) {
-                get_Bookmarks(d->bookmarks, id)->parentId = parentId;
-            }
+            uint32_t id = addToFolder_Bookmarks(d->bookmarks, NULL,
+                                                collect_String(suffix_Command(cmd, "value")),
+                                                NULL, 0, parentId);
             postCommandf_App("bookmarks.changed added:%zu", id);
             setRecentFolder_Bookmarks(d->bookmarks, id);
         }
@@ -137,6 +137,7 @@ iDocumentWidget *   newTab_App                  (const iDocumentWidget *duplicat
 void                trimCache_App               (void);
 void                trimMemory_App              (void);
 void                saveStateQuickly_App        (void);
+iStream *           savedContent_App            (void); /* NULL if no content was saved */
 void                setTextInputActive_App      (iBool);
 
 const iStringArray *recentlySubmittedInput_App  (void);
@@ -27,18 +27,95 @@ iDefineTypeConstruction(InputBuf)
 void init_InputBuf(iInputBuf *d) {
     init_Mutex(&d->mtx);
     init_Condition(&d->changed);
-    init_Block(&d->data, 0);
+    init_PtrArray(&d->chunks);
+    d->size       = 0;
+    init_Block(&d->scratch, 0);
+    d->scratchPos = 0;
     d->isComplete = iTrue;
 }
 
 void deinit_InputBuf(iInputBuf *d) {
-    deinit_Block(&d->data);
+    clear_InputBuf(d);
+    deinit_PtrArray(&d->chunks);
+    deinit_Block(&d->scratch);
     deinit_Condition(&d->changed);
     deinit_Mutex(&d->mtx);
 }
 
 size_t size_InputBuf(const iInputBuf *d) {
-    return size_Block(&d->data);
+    return d->size;
+}
+
+void clear_InputBuf(iInputBuf *d) {
+    iForEach(PtrArray, i, &d->chunks) {
+        free(i.ptr);
+    }
+    clear_PtrArray(&d->chunks);
+    d->size = 0;
+    clear_Block(&d->scratch);
+    d->scratchPos = 0;
+}
+
+void append_InputBuf(iInputBuf *d, const void *data, size_t size) {
+    const char *in = data;
+    while (size > 0) {
+        const size_t offset = d->size % chunkSize_InputBuf;
+        if (offset == 0 && d->size == chunkSize_InputBuf * size_PtrArray(&d->chunks)) {
+            pushBack_PtrArray(&d->chunks, malloc(chunkSize_InputBuf));
+        }
+        const size_t n = iMin(size, chunkSize_InputBuf - offset);
+        memcpy((char *) back_PtrArray(&d->chunks) + offset, in, n);
+        in      += n;
+        size    -= n;
+        d->size += n;
+    }
+}
+
+size_t read_InputBuf(const iInputBuf *d, size_t pos, size_t size, void *data_out) {
+    char  *out   = data_out;
+    size_t total = 0;
+    size = iMin(size, pos < d->size ? d->size - pos : 0);
+    while (size > 0) {
+        const size_t offset = pos % chunkSize_InputBuf;
+        const size_t n      = iMin(size, chunkSize_InputBuf - offset);
+        memcpy(out, (const char *) constAt_PtrArray(&d->chunks, pos / chunkSize_InputBuf) + offset, n);
+        out   += n;
+        pos   += n;
+        size  -= n;
+        total += n;
+    }
+    return total;
+}
+
+iBlock *copy_InputBuf(const iInputBuf *d, size_t pos, size_t size) {
+    size = iMin(size, pos < d->size ? d->size - pos : 0);
+    iBlock *copied = new_Block(size);
+    read_InputBuf(d, pos, size, data_Block(copied));
+    return copied;
+}
+
+iRangecc window_InputBuf(iInputBuf *d, size_t pos, size_t minSize) {
+    /* Returns at least `minSize` contiguous bytes starting at `pos` (fewer only if the stream
+       doesn't have that many yet). Data is copied only when the range crosses a chunk
+       boundary, and the copy is reused for subsequent windows that fit inside it. */
+    if (pos >= d->size) {
+        return (iRangecc){ NULL, NULL };
+    }
+    minSize = iMin(minSize, d->size - pos);
+    const size_t offset = pos % chunkSize_InputBuf;
+    const char * chunk  = constAt_PtrArray(&d->chunks, pos / chunkSize_InputBuf);
+    const size_t inChunk = iMin(chunkSize_InputBuf - offset, d->size - pos);
+    if (inChunk >= minSize) {
+        return (iRangecc){ chunk + offset, chunk + offset + inChunk };
+    }
+    if (pos < d->scratchPos || pos + minSize > d->scratchPos + size_Block(&d->scratch)) {
+        /* Refill with some extra so the next windows can use the same copy. */
+        resize_Block(&d->scratch, iMin(2 * minSize, d->size - pos));
+        read_InputBuf(d, pos, size_Block(&d->scratch), data_Block(&d->scratch));
+        d->scratchPos = pos;
+    }
+    const char *begin = constData_Block(&d->scratch) + (pos - d->scratchPos);
+    return (iRangecc){ begin, constEnd_Block(&d->scratch) };
 }
 
 /*----------------------------------------------------------------------------------------------*/
@@ -50,24 +127,25 @@ void init_SampleBuf(iSampleBuf *d, SDL_AudioFormat format, size_t numChannels, s
     d->format      = format;
     d->numChannels = numChannels;
     d->sampleSize  = SDL_AUDIO_BITSIZE(format) / 8 * numChannels;
-    d->count       = count + 1; /* considered empty if head==tail */
+    d->count       = 1;
+    while (d->count < count) {
+        d->count <<= 1;
+    }
     d->data        = malloc(d->sampleSize * d->count);
-    d->head        = 0;
-    d->tail        = 0;
-    init_Condition(&d->moreNeeded);
+    set_Atomic(&d->head, 0);
+    set_Atomic(&d->tail, 0);
 }
 
 void deinit_SampleBuf(iSampleBuf *d) {
-    deinit_Condition(&d->moreNeeded);
     free(d->data);
 }
 
 size_t size_SampleBuf(const iSampleBuf *d) {
-    return d->head - d->tail;
+    return (unsigned int) value_Atomic(&d->head) - (unsigned int) value_Atomic(&d->tail);
 }
 
 size_t vacancy_SampleBuf(const iSampleBuf *d) {
-    return d->count - size_SampleBuf(d) - 1;
+    return d->count - size_SampleBuf(d);
 }
 
 iBool isFull_SampleBuf(const iSampleBuf *d) {
@@ -76,8 +154,8 @@ iBool isFull_SampleBuf(const iSampleBuf *d) {
 
 void write_SampleBuf(iSampleBuf *d, const void *samples, const size_t n) {
     iAssert(n <= vacancy_SampleBuf(d));
-    const size_t headPos = d->head % d->count;
-    const size_t avail   = d->count - headPos;
+    const unsigned int headPos = value_Atomic(&d->head);
+    const size_t       avail   = d->count - (headPos & (d->count - 1));
     if (n > avail) {
         const char *in = samples;
         memcpy(ptr_SampleBuf_(d, headPos), in, d->sampleSize * avail);
@@ -87,13 +165,14 @@ void write_SampleBuf(iSampleBuf *d, const void *samples, const size_t n) {
     else {
         memcpy(ptr_SampleBuf_(d, headPos), samples, d->sampleSize * n);
     }
-    d->head += n;
+    /* Publish the samples only after they have been copied. */
+    add_Atomic(&d->head, (int) n);
 }
 
 void read_SampleBuf(iSampleBuf *d, const size_t n, void *samples_out) {
     iAssert(n <= size_SampleBuf(d));
-    const size_t tailPos = d->tail % d->count;
-    const size_t avail   = d->count - tailPos;
+    const unsigned int tailPos = value_Atomic(&d->tail);
+    const size_t       avail   = d->count - (tailPos & (d->count - 1));
     if (n > avail) {
         char *out = samples_out;
         memcpy(out, ptr_SampleBuf_(d, tailPos), d->sampleSize * avail);
@@ -103,5 +182,10 @@ void read_SampleBuf(iSampleBuf *d, const size_t n, void *samples_out) {
     else {
         memcpy(samples_out, ptr_SampleBuf_(d, tailPos), d->sampleSize * n);
     }
-    d->tail += n;
+    add_Atomic(&d->tail, (int) n);
+}
+
+void clear_SampleBuf(iSampleBuf *d) {
+    /* Only safe while the reader is locked out (e.g., with SDL_LockAudioDevice). */
+    set_Atomic(&d->tail, value_Atomic(&d->head));
 }
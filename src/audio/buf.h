@@ -26,6 +26,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 #include "the_Foundation/block.h"
 #include "the_Foundation/mutex.h"
+#include "the_Foundation/ptrarray.h"
 
 #include <SDL_audio.h>
 
@@ -39,27 +40,43 @@ iDeclareType(SampleBuf)
 #   define AUDIO_F64LSB     0x8140  /* 64-bit floating point samples */
 #endif
 
+/* Append-only input byte stream, stored as fixed-size chunks so that appending never moves
+   or copies the data received earlier. Positions are offsets from the beginning of the
+   stream. All access must happen while holding `mtx`. */
 struct Impl_InputBuf {
     iMutex     mtx;
     iCondition changed;
-    iBlock     data;
+    iPtrArray  chunks;     /* each chunkSize_InputBuf bytes; only the last one is partial */
+    size_t     size;
+    iBlock     scratch;    /* contiguous copy for ranges that cross chunk boundaries */
+    size_t     scratchPos;
     iBool      isComplete;
 };
 
+#define chunkSize_InputBuf  ((size_t) 0x10000)
+
 iDeclareTypeConstruction(InputBuf)
 
-size_t  size_InputBuf   (const iInputBuf *);
+size_t  size_InputBuf           (const iInputBuf *);
+void    clear_InputBuf          (iInputBuf *);
+void    append_InputBuf         (iInputBuf *, const void *data, size_t size);
+size_t  read_InputBuf           (const iInputBuf *, size_t pos, size_t size, void *data_out);
+iBlock *copy_InputBuf           (const iInputBuf *, size_t pos, size_t size);
+iRangecc window_InputBuf        (iInputBuf *, size_t pos, size_t minSize);
 
 /*----------------------------------------------------------------------------------------------*/
 
+/* Single-producer/single-consumer ring buffer. The decoder thread is the only writer and
+   the audio callback is the only reader, so no locking is needed: only the writer advances
+   `head` and only the reader advances `tail`. Both are free-running counters, and `count`
+   is a power of two so that they can wrap around. */
 struct Impl_SampleBuf {
     SDL_AudioFormat format;
     uint8_t         numChannels;
     uint8_t         sampleSize; /* as bytes; one sample includes values for all channels */
     void *          data;
     size_t          count;
-    size_t          head, tail;
-    iCondition      moreNeeded;
+    iAtomicInt      head, tail;
 };
 
 iDeclareTypeConstructionArgs(SampleBuf, SDL_AudioFormat format, size_t numChannels, size_t count)
@@ -69,10 +86,11 @@ iBool   isFull_SampleBuf    (const iSampleBuf *);
 size_t  vacancy_SampleBuf   (const iSampleBuf *);
 
 iLocalDef void *ptr_SampleBuf_(iSampleBuf *d, size_t pos) {
-    return ((char *) d->data) + (d->sampleSize * pos);
+    return ((char *) d->data) + (d->sampleSize * (pos & (d->count - 1)));
 }
 
 void    write_SampleBuf     (iSampleBuf *, const void *samples, const size_t n);
 void    read_SampleBuf      (iSampleBuf *, const size_t n, void *samples_out);
+void    clear_SampleBuf     (iSampleBuf *);
 
 #endif /* LAGRANGE_ENABLE_AUDIO */
@@ -24,6 +24,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "defs.h"
 #include "buf.h"
 #include "lang.h"
+#include "app.h"
 
 #define STB_VORBIS_HEADER_ONLY
 #include "stb_vorbis.c"
@@ -69,6 +70,14 @@ struct Impl_ContentSpec {
     size_t            inputStartPos;
 };
 
+iDeclareType(SeekPoint)
+
+/* A decoded sample position and the input offset where decoding of its frame began. */
+struct Impl_SeekPoint {
+    uint64_t sample;
+    size_t   inputPos;
+};
+
 iDeclareType(Decoder)
 
 struct Impl_Decoder {
@@ -78,16 +87,25 @@ struct Impl_Decoder {
     SDL_AudioFormat   inputFormat;
     iInputBuf *       input;
     size_t            inputPos;
+    size_t            inputStartPos; /* first byte of audio data */
     size_t            totalInputSize;
     unsigned int      outputFreq;
-    iSampleBuf        output;
-    iMutex            outputMutex;
+    SDL_AudioDeviceID device;        /* locked while the output is being discarded */
+    iSampleBuf        output;      /* lock-free; written here, read by the audio callback */
+    SDL_sem *         outputDrained; /* posted by the audio callback when space is freed */
+    iAtomicInt        isOutputFull;  /* decoder is (about to start) waiting for space */
     iArray            pendingOutput;
     uint64_t          currentSample;
     uint64_t          totalSamples; /* zero if unknown */
+    iAtomicInt        isSeekPending;
+    uint64_t          seekTarget;   /* guarded by input->mtx */
+    const void *      player;       /* identifies the player in posted commands */
+    uint64_t          skipUntil;    /* decoded samples before this are discarded */
     iMutex            tagMutex;
     iString           tags[max_PlayerTag];
     stb_vorbis *      vorbis;
+    int64_t           vorbisSample; /* position of the next decoded frame; -1 if unknown */
+    iArray            vorbisSeekPoints;
 #if defined (LAGRANGE_ENABLE_MPG123)
     mpg123_handle *   mpeg;
     mpg123_id3v1 *    id3v1;
@@ -100,6 +118,8 @@ struct Impl_Decoder {
 #endif
 };
 
+#define maxOggPageSize_  65307
+
 enum iDecoderStatus {
     ok_DecoderStatus,
     needMoreInput_DecoderStatus,
@@ -109,7 +129,7 @@ static enum iDecoderStatus decodeWav_Decoder_(iDecoder *d, iRanges inputRange) {
     const uint8_t numChannels     = d->output.numChannels;
     const size_t  inputSampleSize = numChannels * SDL_AUDIO_BITSIZE(d->inputFormat) / 8;
     const size_t  vacancy         = vacancy_SampleBuf(&d->output);
-    const size_t  inputBytePos    = inputSampleSize * d->inputPos;
+    const size_t  inputBytePos    = d->inputStartPos + inputSampleSize * d->inputPos;
     const size_t  avail           = (inputRange.end - inputBytePos) / inputSampleSize;
     if (avail == 0) {
         return needMoreInput_DecoderStatus;
@@ -121,10 +141,8 @@ static enum iDecoderStatus decodeWav_Decoder_(iDecoder *d, iRanges inputRange) {
     void *samples = malloc(inputSampleSize * n);
     /* Get a copy of the input for further processing. */ {
         lock_Mutex(&d->input->mtx);
-        iAssert(inputSampleSize * d->inputPos < size_Block(&d->input->data));
-        memcpy(samples,
-               constData_Block(&d->input->data) + inputSampleSize * d->inputPos,
-               inputSampleSize * n);
+        iAssert(inputBytePos < size_InputBuf(d->input));
+        read_InputBuf(d->input, inputBytePos, inputSampleSize * n, samples);
         d->inputPos += n;
         unlock_Mutex(&d->input->mtx);
     }
@@ -179,7 +197,7 @@ static enum iDecoderStatus decodeWav_Decoder_(iDecoder *d, iRanges inputRange) {
             }
         }
     }
-    iGuardMutex(&d->outputMutex, write_SampleBuf(&d->output, samples, n));
+    write_SampleBuf(&d->output, samples, n);
     d->currentSample += n;
     free(samples);
     return ok_DecoderStatus;
@@ -187,28 +205,112 @@ static enum iDecoderStatus decodeWav_Decoder_(iDecoder *d, iRanges inputRange) {
 
 static void writePending_Decoder_(iDecoder *d) {
     /* Write as much as we can. */
-    lock_Mutex(&d->outputMutex);
     size_t avail = vacancy_SampleBuf(&d->output);
     size_t n = iMin(avail, size_Array(&d->pendingOutput));
     write_SampleBuf(&d->output, constData_Array(&d->pendingOutput), n);
     removeN_Array(&d->pendingOutput, 0, n);
-    unlock_Mutex(&d->outputMutex);
     d->currentSample += n;
 }
 
+static uint64_t lastOggGranulePosition_(iInputBuf *input) {
+    /* The granule position of the last page is the total number of samples. */
+    const size_t   size  = size_InputBuf(input);
+    const size_t   start = size > maxOggPageSize_ ? size - maxOggPageSize_ : 0;
+    const iRangecc tail  = window_InputBuf(input, start, size - start);
+    if (size_Range(&tail) < 27) {
+        return 0;
+    }
+    for (const char *pos = tail.end - 27; pos >= tail.start; pos--) {
+        if (!memcmp(pos, "OggS", 4) && pos[4] == 0) {
+            uint64_t granule = 0;
+            for (int i = 7; i >= 0; i--) {
+                granule = (granule << 8) | (uint8_t) pos[6 + i];
+            }
+            return granule != ~(uint64_t) 0 ? granule : 0;
+        }
+    }
+    return 0;
+}
+
+static void addVorbisSeekPoint_Decoder_(iDecoder *d, uint64_t sample, size_t inputPos) {
+    /* Seek points are recorded about twice per second of decoded audio. */
+    if (!isEmpty_Array(&d->vorbisSeekPoints)) {
+        const iSeekPoint *last = constBack_Array(&d->vorbisSeekPoints);
+        if (sample < last->sample + d->outputFreq / 2) {
+            return;
+        }
+    }
+    pushBack_Array(&d->vorbisSeekPoints, &(iSeekPoint){ sample, inputPos });
+}
+
+static iBool seekVorbis_Decoder_(iDecoder *d, uint64_t target) {
+    if (!d->vorbis) {
+        return iFalse;
+    }
+    /* Decoding resumes at the first page boundary after the seek position, so leave a
+       margin that covers a full page. */
+    const uint64_t margin = d->outputFreq;
+    if (target < margin) {
+        /* Just start over. */
+        stb_vorbis_close(d->vorbis);
+        d->vorbis    = NULL;
+        d->inputPos  = 0;
+        d->skipUntil = target;
+        return iTrue;
+    }
+    uint64_t pointSample = 0;
+    size_t   pos         = d->inputStartPos;
+    iConstForEach(Array, i, &d->vorbisSeekPoints) {
+        const iSeekPoint *sp = i.value;
+        if (sp->sample + margin > target) {
+            break;
+        }
+        pointSample = sp->sample;
+        pos         = sp->inputPos;
+    }
+    if (target > pointSample + 2 * margin) {
+        /* This part hasn't been decoded yet. Estimate the position using the average
+           bitrate. */
+        double bytesPerSample = 0.0;
+        if (d->totalSamples && d->totalInputSize) {
+            bytesPerSample = (double) (d->totalInputSize - d->inputStartPos) / d->totalSamples;
+        }
+        else if (pointSample) {
+            bytesPerSample = (double) (pos - d->inputStartPos) / pointSample;
+        }
+        pos += (size_t) (bytesPerSample * (target - margin - pointSample));
+    }
+    lock_Mutex(&d->input->mtx);
+    const iBool isAvailable = (pos < size_InputBuf(d->input));
+    unlock_Mutex(&d->input->mtx);
+    if (!isAvailable) {
+        return iFalse;
+    }
+    stb_vorbis_flush_pushdata(d->vorbis);
+    d->inputPos     = pos;
+    d->vorbisSample = -1;
+    d->skipUntil    = target;
+    return iTrue;
+}
+
 static enum iDecoderStatus decodeVorbis_Decoder_(iDecoder *d) {
-    const iBlock *input = &d->input->data;
+    iInputBuf *input = d->input;
     if (!d->vorbis) {
-        lock_Mutex(&d->input->mtx);
+        lock_Mutex(&input->mtx);
         int error;
         int consumed;
+        const iRangecc head =
+            window_InputBuf(input, d->inputPos, size_InputBuf(input) - d->inputPos);
         d->vorbis = stb_vorbis_open_pushdata(
-            constData_Block(input), (int) size_Block(input), &consumed, &error, NULL);
+            (const unsigned char *) head.start, (int) size_Range(&head), &consumed, &error, NULL);
         if (!d->vorbis) {
+            unlock_Mutex(&input->mtx);
             return needMoreInput_DecoderStatus;
         }
         d->inputPos += consumed;
-        unlock_Mutex(&d->input->mtx);
+        d->inputStartPos = d->inputPos;
+        d->vorbisSample  = 0;
+        unlock_Mutex(&input->mtx);
         /* Check the metadata. */ {
             const stb_vorbis_comment com = stb_vorbis_get_comment(d->vorbis);
             //        printf("vendor: {%s}\n", comment.vendor);
@@ -231,31 +333,30 @@ static enum iDecoderStatus decodeVorbis_Decoder_(iDecoder *d) {
             unlock_Mutex(&d->tagMutex);
         }
     }
-    if (d->totalSamples == 0 && d->input->isComplete) {
+    if (d->totalSamples == 0 && input->isComplete) {
         /* Time to check the stream size. */
-        lock_Mutex(&d->input->mtx);
-        d->totalInputSize = size_Block(input);
-        int error = 0;
-        stb_vorbis *vrb = stb_vorbis_open_memory(constData_Block(input), (int) size_Block(input),
-                                                 &error, NULL);
-        if (vrb) {
-            d->totalSamples = stb_vorbis_stream_length_in_samples(vrb);
-            stb_vorbis_close(vrb);
-        }
-        unlock_Mutex(&d->input->mtx);
+        lock_Mutex(&input->mtx);
+        d->totalInputSize = size_InputBuf(input);
+        d->totalSamples   = lastOggGranulePosition_(input);
+        unlock_Mutex(&input->mtx);
     }
     enum iDecoderStatus status = ok_DecoderStatus;
     while (size_Array(&d->pendingOutput) < d->output.count) {
         /* Try to decode some input. */
-        lock_Mutex(&d->input->mtx);
-        int     count     = 0;
-        float **samples   = NULL;
-        int     remaining = d->inputPos < size_Block(input) ? size_Block(input) - d->inputPos : 0;
-        int     consumed  = stb_vorbis_decode_frame_pushdata(
-            d->vorbis, constData_Block(input) + d->inputPos, remaining, NULL, &samples, &count);
+        lock_Mutex(&input->mtx);
+        const size_t   framePos = d->inputPos;
+        int            count    = 0;
+        float **       samples  = NULL;
+        const iRangecc frame    = window_InputBuf(input, d->inputPos, maxOggPageSize_);
+        int            consumed = stb_vorbis_decode_frame_pushdata(d->vorbis,
+                                                                   (const unsigned char *) frame.start,
+                                                                   (int) size_Range(&frame),
+                                                                   NULL,
+                                                                   &samples,
+                                                                   &count);
         d->inputPos += consumed;
-        iAssert(d->inputPos <= size_Block(input));
-        unlock_Mutex(&d->input->mtx);
+        iAssert(d->inputPos <= size_InputBuf(input));
+        unlock_Mutex(&input->mtx);
         if (count == 0) {
             if (consumed == 0) {
                 status = needMoreInput_DecoderStatus;
@@ -263,10 +364,28 @@ static enum iDecoderStatus decodeVorbis_Decoder_(iDecoder *d) {
             }
             else continue;
         }
+        if (d->vorbisSample < 0) {
+            /* After a seek, the position becomes known when the end of a page is reached. */
+            const int nextSample = stb_vorbis_get_sample_offset(d->vorbis);
+            if (nextSample < 0) {
+                continue;
+            }
+            d->vorbisSample = (int64_t) nextSample - count;
+        }
+        const uint64_t frameSample = d->vorbisSample;
+        d->vorbisSample += count;
+        addVorbisSeekPoint_Decoder_(d, frameSample, framePos);
+        size_t first = 0;
+        if (frameSample < d->skipUntil) {
+            if ((uint64_t) d->vorbisSample <= d->skipUntil) {
+                continue;
+            }
+            first = d->skipUntil - frameSample;
+        }
         /* Apply gain. */ {
             const float gain = d->gain;
             float sample[2];
-            for (size_t i = 0; i < (size_t) count; ++i) {
+            for (size_t i = first; i < (size_t) count; ++i) {
                 for (size_t chan = 0; chan < d->output.numChannels; chan++) {
                     sample[chan] = samples[chan][i] * gain;
                 }
@@ -287,7 +406,7 @@ static const char *mpegStr_(const mpg123_string *str) {
 enum iDecoderStatus decodeMpeg_Decoder_(iDecoder *d) {
     enum iDecoderStatus status = ok_DecoderStatus;
 #if defined (LAGRANGE_ENABLE_MPG123)
-    const iBlock *input = &d->input->data;
+    iInputBuf *input = d->input;
     if (!d->mpeg) {
         d->inputPos = 0;
         d->mpeg = mpg123_new(NULL, NULL);
@@ -296,22 +415,27 @@ enum iDecoderStatus decodeMpeg_Decoder_(iDecoder *d) {
         mpg123_open_feed(d->mpeg);
     }
     /* Feed more input. */ {
-        lock_Mutex(&d->input->mtx);
-        if (d->input->isComplete) {
-            d->totalInputSize = size_Block(input);
+        lock_Mutex(&input->mtx);
+        if (input->isComplete) {
+            d->totalInputSize = size_InputBuf(input);
         }
-        if (d->inputPos < size_Block(input)) {
-            mpg123_feed(d->mpeg, constData_Block(input) + d->inputPos, size_Block(input) - d->inputPos);
-            if (d->inputPos == 0) {
+        if (d->inputPos < size_InputBuf(input)) {
+            const iBool isFirst = (d->inputPos == 0);
+            while (d->inputPos < size_InputBuf(input)) {
+                /* The decoder keeps its own copy, so feed one chunk at a time. */
+                const iRangecc chunk = window_InputBuf(input, d->inputPos, 1);
+                mpg123_feed(d->mpeg, (const unsigned char *) chunk.start, size_Range(&chunk));
+                d->inputPos += size_Range(&chunk);
+            }
+            if (isFirst) {
                 long r; int ch, enc;
                 mpg123_getformat(d->mpeg, &r, &ch, &enc);
                 iAssert(r == d->outputFreq);
                 iAssert(ch == d->output.numChannels);
                 iAssert(enc == MPG123_ENC_SIGNED_16);
             }
-            d->inputPos = size_Block(input);
         }
-        unlock_Mutex(&d->input->mtx);
+        unlock_Mutex(&input->mtx);
     }
     while (size_Array(&d->pendingOutput) < d->output.count) {
         int16_t buffer[512];
@@ -355,19 +479,15 @@ enum iDecoderStatus decodeMpeg_Decoder_(iDecoder *d) {
 
 #if defined (LAGRANGE_ENABLE_OPUS)
 static int readOpus_(void *stream, unsigned char *ptr, int nbytes) {
-    iDecoder     *d     = stream;
-    const iBlock *input = &d->input->data;
-    const size_t  avail = size_Block(input) - d->inputPos;
-    const size_t  n     = iMin(avail, nbytes);
-    memcpy(ptr, constData_Block(input) + d->inputPos, n);
+    iDecoder    *d = stream;
+    const size_t n = read_InputBuf(d->input, d->inputPos, nbytes, ptr);
     d->inputPos += n;
     return n;
 }
 
 static int seekOpus_(void *stream, opus_int64 offset, int whence) {
     iDecoder     *d     = stream;
-    const iBlock *input = &d->input->data;
-    const size_t  avail = size_Block(input);
+    const size_t  avail = size_InputBuf(d->input);
     const size_t  pos   = d->inputPos;
     switch (whence) {
         case SEEK_SET:
@@ -383,7 +503,7 @@ static int seekOpus_(void *stream, opus_int64 offset, int whence) {
             if (avail <= pos + offset || PTRDIFF_MAX - pos < offset || -offset > pos) {
                 return -1;
             }
-            d->inputPos = size_Block(input) + offset;
+            d->inputPos = avail + offset;
             break;
     }
     return 0;
@@ -405,9 +525,11 @@ static const OpusFileCallbacks opusCallbacks_ = {
 static enum iDecoderStatus decodeOpus_Decoder_(iDecoder *d) {
     enum iDecoderStatus status = ok_DecoderStatus;
 #if defined (LAGRANGE_ENABLE_OPUS)
-    const iBlock *input = &d->input->data;
+    /* Note: The Opus decoder is reopened as more input arrives and it reads the stream from
+       the beginning, so the input is never released. */
+    const iInputBuf *input = d->input;
     lock_Mutex(&d->input->mtx);
-    if (!d->opus || d->opusLastInputSize != size_Block(input)) {
+    if (!d->opus || d->opusLastInputSize != size_InputBuf(input)) {
         ogg_int64_t lastRead = 0;
         if (d->opus) {
             lastRead = op_pcm_tell(d->opus);
@@ -434,7 +556,7 @@ static enum iDecoderStatus decodeOpus_Decoder_(iDecoder *d) {
             }
         }
     }
-    d->opusLastInputSize = size_Block(input);
+    d->opusLastInputSize = size_InputBuf(input);
     while (size_Array(&d->pendingOutput) < d->output.count) {
         float       buffer[512];
         const int   samplePerCh  = op_read_float(d->opus, buffer, sizeof(buffer) / sizeof(float), NULL);
@@ -463,9 +585,92 @@ static enum iDecoderStatus decodeOpus_Decoder_(iDecoder *d) {
     return status;
 }
 
+static iBool seekWav_Decoder_(iDecoder *d, uint64_t target) {
+    const size_t inputSampleSize = d->output.numChannels * SDL_AUDIO_BITSIZE(d->inputFormat) / 8;
+    const size_t pos             = d->inputStartPos + inputSampleSize * target;
+    lock_Mutex(&d->input->mtx);
+    const iBool isAvailable = (pos < size_InputBuf(d->input));
+    unlock_Mutex(&d->input->mtx);
+    if (!isAvailable) {
+        return iFalse;
+    }
+    d->inputPos = target;
+    return iTrue;
+}
+
+static iBool seekMpeg_Decoder_(iDecoder *d, uint64_t *target) {
+#if defined (LAGRANGE_ENABLE_MPG123)
+    if (d->mpeg) {
+        /* In feed mode, mpg123 tells where the input should continue from. It uses its
+           frame index when possible, so the resulting position is frame-accurate. */
+        off_t inputOffset = 0;
+        const off_t pos = mpg123_feedseek(d->mpeg, (off_t) *target, SEEK_SET, &inputOffset);
+        if (pos >= 0 && inputOffset >= 0) {
+            d->inputPos = inputOffset;
+            *target     = pos;
+            return iTrue;
+        }
+    }
+#endif
+    iUnused(d, target);
+    return iFalse;
+}
+
+static iBool seekOpus_Decoder_(iDecoder *d, uint64_t target) {
+#if defined (LAGRANGE_ENABLE_OPUS)
+    if (d->opus) {
+        lock_Mutex(&d->input->mtx);
+        const int rc = op_pcm_seek(d->opus, (ogg_int64_t) target);
+        unlock_Mutex(&d->input->mtx);
+        return rc == 0;
+    }
+#endif
+    iUnused(d, target);
+    return iFalse;
+}
+
+static iBool seek_Decoder_(iDecoder *d, uint64_t target) {
+    iBool isSeeking = iFalse;
+    switch (d->type) {
+        case wav_DecoderType:
+            isSeeking = seekWav_Decoder_(d, target);
+            break;
+        case vorbis_DecoderType:
+            isSeeking = seekVorbis_Decoder_(d, target);
+            break;
+        case mpeg_DecoderType:
+            isSeeking = seekMpeg_Decoder_(d, &target);
+            break;
+        case opus_DecoderType:
+            isSeeking = seekOpus_Decoder_(d, target);
+            break;
+        default:
+            break;
+    }
+    if (!isSeeking) {
+        return iFalse;
+    }
+    /* Discard everything decoded from the old position. The audio callback must not be
+       reading the ring buffer while it is reset. */
+    clear_Array(&d->pendingOutput);
+    SDL_LockAudioDevice(d->device);
+    clear_SampleBuf(&d->output);
+    SDL_UnlockAudioDevice(d->device);
+    d->currentSample = target;
+    return iTrue;
+}
+
 static iThreadResult run_Decoder_(iThread *thread) {
     iDecoder *d = userData_Thread(thread);
     while (d->type) {
+        if (exchange_Atomic(&d->isSeekPending, iFalse)) {
+            lock_Mutex(&d->input->mtx);
+            const uint64_t target = d->seekTarget;
+            unlock_Mutex(&d->input->mtx);
+            const iBool isOk = seek_Decoder_(d, target);
+            postCommandf_App("media.player.seeked player:%p ok:%d start:%d",
+                             d->player, isOk, target == 0);
+        }
         /* Check amount of data available. */
         lock_Mutex(&d->input->mtx);
         size_t inputSize = size_InputBuf(d->input);
@@ -492,31 +697,40 @@ static iThreadResult run_Decoder_(iThread *thread) {
         }
         if (status == needMoreInput_DecoderStatus) {
             lock_Mutex(&d->input->mtx);
-            if (size_InputBuf(d->input) == inputSize) {
+            if (size_InputBuf(d->input) == inputSize && !value_Atomic(&d->isSeekPending)) {
                 wait_Condition(&d->input->changed, &d->input->mtx);
             }
             unlock_Mutex(&d->input->mtx);
         }
         else {
-            iGuardMutex(
-                &d->outputMutex, if (isFull_SampleBuf(&d->output)) {
-                    wait_Condition(&d->output.moreNeeded, &d->outputMutex);
-                });
+            /* The flag is raised before checking so the audio callback cannot miss it. */
+            set_Atomic(&d->isOutputFull, iTrue);
+            if (d->type && isFull_SampleBuf(&d->output) && !value_Atomic(&d->isSeekPending)) {
+                SDL_SemWait(d->outputDrained);
+            }
+            set_Atomic(&d->isOutputFull, iFalse);
         }
     }
     return 0;
 }
 
-void init_Decoder(iDecoder *d, iInputBuf *input, const iContentSpec *spec) {
+void init_Decoder(iDecoder *d, iInputBuf *input, const iContentSpec *spec,
+                  SDL_AudioDeviceID device) {
     d->type           = spec->type;
     d->gain           = 1.0f;
     d->input          = input;
-    d->inputPos       = spec->inputStartPos;
+    d->inputPos       = 0;
+    d->inputStartPos  = spec->inputStartPos;
     d->inputFormat    = spec->inputFormat;
     d->totalInputSize = spec->totalInputSize;
     d->outputFreq     = spec->output.freq;
+    d->device         = device;
     d->currentSample  = 0;
     d->totalSamples   = spec->totalSamples;
+    d->seekTarget     = 0;
+    d->player         = spec->output.userdata;
+    d->skipUntil      = 0;
+    set_Atomic(&d->isSeekPending, iFalse);
     init_Array(&d->pendingOutput, spec->output.channels * SDL_AUDIO_BITSIZE(spec->output.format) / 8);
     init_SampleBuf(&d->output,
                    spec->output.format,
@@ -526,7 +740,9 @@ void init_Decoder(iDecoder *d, iInputBuf *input, const iContentSpec *spec) {
     iForIndices(i, d->tags) {
         init_String(&d->tags[i]);
     }
-    d->vorbis = NULL;
+    d->vorbis       = NULL;
+    d->vorbisSample = 0;
+    init_Array(&d->vorbisSeekPoints, sizeof(iSeekPoint));
 #if defined (LAGRANGE_ENABLE_MPG123)
     d->mpeg  = NULL;
     d->id3v1 = NULL;
@@ -536,7 +752,8 @@ void init_Decoder(iDecoder *d, iInputBuf *input, const iContentSpec *spec) {
     d->opus = NULL;
     d->opusLastInputSize = 0;
 #endif
-    init_Mutex(&d->outputMutex);
+    d->outputDrained = SDL_CreateSemaphore(0);
+    set_Atomic(&d->isOutputFull, iFalse);
     d->thread = new_Thread(run_Decoder_);
     setUserData_Thread(d->thread, d);
     start_Thread(d->thread);
@@ -544,11 +761,11 @@ void init_Decoder(iDecoder *d, iInputBuf *input, const iContentSpec *spec) {
 
 void deinit_Decoder(iDecoder *d) {
     d->type = none_DecoderType;
-    signal_Condition(&d->output.moreNeeded);
-    signal_Condition(&d->input->changed);
+    SDL_SemPost(d->outputDrained);
+    iGuardMutex(&d->input->mtx, signal_Condition(&d->input->changed));
     join_Thread(d->thread);
     iRelease(d->thread);
-    deinit_Mutex(&d->outputMutex);
+    SDL_DestroySemaphore(d->outputDrained);
     deinit_SampleBuf(&d->output);
     deinit_Array(&d->pendingOutput);
     iForIndices(i, d->tags) {
@@ -558,6 +775,7 @@ void deinit_Decoder(iDecoder *d) {
     if (d->vorbis) {
         stb_vorbis_close(d->vorbis);
     }
+    deinit_Array(&d->vorbisSeekPoints);
 #if defined (LAGRANGE_ENABLE_MPG123)
     if (d->mpeg) {
         mpg123_close(d->mpeg);
@@ -571,8 +789,9 @@ void deinit_Decoder(iDecoder *d) {
 #endif
 }
 
-iDefineTypeConstructionArgs(Decoder, (iInputBuf *input, const iContentSpec *spec),
-                            input, spec)
+iDefineTypeConstructionArgs(Decoder,
+                            (iInputBuf *input, const iContentSpec *spec, SDL_AudioDeviceID device),
+                            input, spec, device)
 
 /*----------------------------------------------------------------------------------------------*/
 
@@ -606,10 +825,15 @@ static iRangecc mediaType_(const iString *str) {
     return part;
 }
 
+static const size_t maxProbeSize_Player_ = 4 * 1024 * 1024;
+
 static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
     iContentSpec content;
     iZap(content);
     const size_t dataSize = size_InputBuf(d->data);
+    /* Content is detected from the beginning of the stream. Large headers (e.g., embedded
+       cover images) should fit in the probed range. */
+    const iBlock *probe = collect_Block(copy_InputBuf(d->data, 0, maxProbeSize_Player_));
     iBuffer *buf = NULL;
     const iRangecc mediaType = mediaType_(&d->mime);
     if (equal_Rangecc(mediaType, "audio/wave") || equal_Rangecc(mediaType, "audio/wav") ||
@@ -630,7 +854,7 @@ static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
 #if defined (LAGRANGE_ENABLE_OPUS)
         // Some servers will reply with audio/ogg for Opus, so we need to check the content.
         OpusHead head;
-        int result = op_test(&head, constData_Block(&d->data->data), size_Block(&d->data->data));
+        int result = op_test(&head, constData_Block(probe), size_Block(probe));
         if (result == 0) {
             content.type = opus_DecoderType;
         }
@@ -647,9 +871,7 @@ static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
     }
     if (content.type != none_DecoderType) {
         buf = iClob(new_Buffer());
-        /* This holds a reference to the data block. The decoder runs in a background
-           thread so it needs its own copy of the data. */
-        open_Buffer(buf, &d->data->data);
+        open_Buffer(buf, probe);
     }
     if (content.type == wav_DecoderType && dataSize >= 44) {
         /* Read the RIFF/WAVE header. */
@@ -734,7 +956,7 @@ static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
         int consumed = 0;
         int error = 0;
         stb_vorbis *vrb = stb_vorbis_open_pushdata(
-            constData_Block(&d->data->data), size_Block(&d->data->data), &consumed, &error, NULL);
+            constData_Block(probe), size_Block(probe), &consumed, &error, NULL);
         if (!vrb) {
             if (error != VORBIS_need_more_data) {
                 content.type = none_DecoderType;
@@ -756,7 +978,7 @@ static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
 #if defined (LAGRANGE_ENABLE_MPG123)
         mpg123_handle *mh = mpg123_new(NULL, NULL);
         mpg123_open_feed(mh);
-        mpg123_feed(mh, constData_Block(&d->data->data), size_Block(&d->data->data));
+        mpg123_feed(mh, constData_Block(probe), size_Block(probe));
         long rate     = 0;
         int  channels = 0;
         int  encoding = 0;
@@ -773,7 +995,7 @@ static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
     else if (content.type == opus_DecoderType) {
 #if defined (LAGRANGE_ENABLE_OPUS)
         OpusHead head;
-        int result = op_test(&head, constData_Block(&d->data->data), size_Block(&d->data->data));
+        int result = op_test(&head, constData_Block(probe), size_Block(probe));
         if (result != 0) {
             return content;
         }
@@ -793,17 +1015,19 @@ static iContentSpec detectContentSpec_Player_(const iPlayer *d) {
 static void writeOutputSamples_Player_(void *plr, Uint8 *stream, int len) {
     iPlayer *d = plr;
     iAssert(d->decoder);
+    iDecoder    *dec        = d->decoder;
     const size_t sampleSize = sampleSize_Player_(d);
     const size_t count      = len / sampleSize;
-    lock_Mutex(&d->decoder->outputMutex);
-    if (size_SampleBuf(&d->decoder->output) >= count) {
-        read_SampleBuf(&d->decoder->output, count, stream);
+    /* This runs in the audio thread, so no locks: the sample buffer is a lock-free ring. */
+    if (size_SampleBuf(&dec->output) >= count) {
+        read_SampleBuf(&dec->output, count, stream);
+        if (value_Atomic(&dec->isOutputFull)) {
+            SDL_SemPost(dec->outputDrained);
+        }
     }
     else {
         memset(stream, d->spec.silence, len);
     }
-    signal_Condition(&d->decoder->output.moreNeeded);
-    unlock_Mutex(&d->decoder->outputMutex);
 }
 
 void init_Player(iPlayer *d) {
@@ -867,20 +1091,19 @@ void updateSourceData_Player(iPlayer *d, const iString *mimeType, const iBlock *
     }
     switch (update) {
         case replace_PlayerUpdate:
-            set_Block(&input->data, data);
+            clear_InputBuf(input);
+            append_InputBuf(input, constData_Block(data), size_Block(data));
             input->isComplete = iFalse;
             break;
         case append_PlayerUpdate: {
-            const size_t oldSize = size_Block(&input->data);
+            const size_t oldSize = size_InputBuf(input);
             const size_t newSize = size_Block(data);
             if (input->isComplete) {
                 iAssert(newSize == oldSize);
                 break;
             }
-            /* The old parts cannot have changed. */
-            /* NOTE: The decoder will hold a reference to the data block, which means
-               appending here will cause a copy-on-write detach to occur. */
-            appendData_Block(&input->data, constBegin_Block(data) + oldSize, newSize - oldSize);
+            /* The old parts cannot have changed. Earlier chunks stay where they are. */
+            append_InputBuf(input, constBegin_Block(data) + oldSize, newSize - oldSize);
             break;
         }
         case complete_PlayerUpdate:
@@ -889,7 +1112,10 @@ void updateSourceData_Player(iPlayer *d, const iString *mimeType, const iBlock *
 #if defined (iPlatformAppleMobile)
                 iAssert(d->avfPlayer == NULL);
                 d->avfPlayer = new_AVFAudioPlayer();
-                if (!setInput_AVFAudioPlayer(d->avfPlayer, &d->mime, &input->data)) {
+                if (!setInput_AVFAudioPlayer(
+                        d->avfPlayer,
+                        &d->mime,
+                        collect_Block(copy_InputBuf(input, 0, size_InputBuf(input))))) {
                     delete_AVFAudioPlayer(d->avfPlayer);
                     d->avfPlayer = NULL;
                 }
@@ -903,7 +1129,7 @@ void updateSourceData_Player(iPlayer *d, const iString *mimeType, const iBlock *
 
 size_t sourceDataSize_Player(const iPlayer *d) {
     lock_Mutex(&d->data->mtx);
-    const size_t size = size_Block(&d->data->data);
+    const size_t size = size_InputBuf(d->data);
     unlock_Mutex(&d->data->mtx);
     return size;
 }
@@ -949,7 +1175,7 @@ iBool start_Player(iPlayer *d) {
     if (!d->device) {
         return iFalse;
     }
-    d->decoder = new_Decoder(d->data, &content);
+    d->decoder = new_Decoder(d->data, &content, d->device);
     d->decoder->gain = d->volume;
     SDL_PauseAudioDevice(d->device, SDL_FALSE);
     setNotIdle_Player(d);
@@ -988,6 +1214,35 @@ void stop_Player(iPlayer *d) {
     }
 }
 
+iBool seek_Player(iPlayer *d, float time) {
+#if defined (iPlatformAppleMobile)
+    if (d->avfPlayer) {
+        return iFalse;
+    }
+#endif
+    iDecoder *dec = d->decoder;
+    if (!dec || !d->spec.freq) {
+        return iFalse;
+    }
+    uint64_t target = (uint64_t) (iMax(0.0f, time) * d->spec.freq);
+    if (dec->totalSamples) {
+        target = iMin(target, dec->totalSamples);
+    }
+    iInputBuf *input = d->data;
+    lock_Mutex(&input->mtx);
+    dec->seekTarget = target;
+    set_Atomic(&dec->isSeekPending, iTrue);
+    signal_Condition(&input->changed);
+    unlock_Mutex(&input->mtx);
+    if (value_Atomic(&dec->isOutputFull)) {
+        SDL_SemPost(dec->outputDrained);
+    }
+    /* The decoder thread performs the seek and posts "media.player.seeked" with the result.
+       The position only changes if the seek succeeds. */
+    setNotIdle_Player(d);
+    return iTrue;
+}
+
 void setVolume_Player(iPlayer *d, float volume) {
     d->volume = iClamp(volume, 0, 1);
     if (d->decoder) {
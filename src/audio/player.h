@@ -53,6 +53,7 @@ size_t  sourceDataSize_Player   (const iPlayer *);
 iBool   	start_Player            (iPlayer *);
 void    	stop_Player             (iPlayer *);
 void    	setPaused_Player        (iPlayer *, iBool isPaused);
+iBool   	seek_Player             (iPlayer *, float time); /* seconds; result posted as "media.player.seeked" */
 void    	setVolume_Player        (iPlayer *, float volume);
 void    	setFlags_Player         (iPlayer *, int flags, iBool set);
 void    	setNotIdle_Player       (iPlayer *);
@@ -22,6 +22,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 #include "bookmarks.h"
 #include "gmrequest.h"
+#include "inicache.h"
 #include "app.h"
 
 #include <the_Foundation/file.h>
@@ -29,8 +30,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include <the_Foundation/mutex.h>
 #include <the_Foundation/path.h>
 #include <the_Foundation/regexp.h>
+#include <the_Foundation/sortedarray.h>
 #include <the_Foundation/stringset.h>
 #include <the_Foundation/toml.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
 
 void init_Bookmark(iBookmark *d) {
     init_String(&d->url);
@@ -138,6 +143,45 @@ static iString *packedDotTags_Bookmark_(const iBookmark *d) {
     return withDot;
 }
 
+static iBool isUnpacked_Tags_(const iString *tags) {
+    /* Checks without regular expressions that unpacking would not change the tags. */
+    if (isEmpty_String(tags)) {
+        return iTrue;
+    }
+    /* Non-ASCII characters at the ends may be whitespace that gets trimmed. */
+    const unsigned char first = *constBegin_String(tags);
+    const unsigned char last  = constEnd_String(tags)[-1];
+    if (isspace(first) || isspace(last) || first >= 0x80 || last >= 0x80 ||
+        indexOfCStr_String(tags, "  ") != iInvalidPos) {
+        return iFalse;
+    }
+    iForIndices(i, specialTags_) {
+        if (indexOfCStr_String(tags, specialTags_[i].tag + 1) != iInvalidPos) {
+            return iFalse;
+        }
+    }
+    return iTrue;
+}
+
+static void savedTags_Bookmark_(const iBookmark *d, iString *tags_out, uint32_t *flags_out) {
+    /* Tags and flags as they will be after a round trip through bookmarks.ini. */
+    if (isUnpacked_Tags_(&d->tags)) {
+        /* Only dot tags will be added, and they unpack back to the same flags. */
+        set_String(tags_out, &d->tags);
+        *flags_out = d->flags & ~remote_BookmarkFlag;
+        return;
+    }
+    iBookmark saved;
+    init_Bookmark(&saved);
+    iString *packed = packedDotTags_Bookmark_(d);
+    set_String(&saved.tags, packed);
+    delete_String(packed);
+    unpackDotTags_Bookmark_(&saved);
+    set_String(tags_out, &saved.tags);
+    *flags_out = saved.flags;
+    deinit_Bookmark(&saved);
+}
+
 iDefineTypeConstruction(Bookmark)
 
 static int cmpTimeDescending_Bookmark_(const iBookmark **a, const iBookmark **b) {
@@ -157,21 +201,175 @@ iBool filterInsideFolder_Bookmark(void *context, const iBookmark *bm) {
 static const char *oldFileName_Bookmarks_  = "bookmarks.txt";
 static const char *fileName_Bookmarks_     = "bookmarks.ini"; /* since v1.7 (TOML subset) */
 static const char *tempFileName_Bookmarks_ = "bookmarks.ini.tmp";
+static const uint32_t cacheVersion_Bookmarks_ = 1; /* see `serializeCache_Bookmarks_` */
+
+iDeclareType(BookmarkKey)
+
+/* Index entry for finding bookmarks by a string. */
+struct Impl_BookmarkKey {
+    iString *str; /* lower case */
+    uint32_t id;
+};
+
+static int cmp_BookmarkKey_(const void *a, const void *b) {
+    const iBookmarkKey *k1 = a, *k2 = b;
+    const int cmp = cmpString_String(k1->str, k2->str);
+    return cmp ? cmp : iCmp(k1->id, k2->id);
+}
+
+iDeclareType(BookmarkChild)
+
+/* Index entry for finding the contents of a folder in order. */
+struct Impl_BookmarkChild {
+    uint32_t parentId;
+    int      order;
+    uint32_t id;
+};
+
+static int cmp_BookmarkChild_(const void *a, const void *b) {
+    const iBookmarkChild *c1 = a, *c2 = b;
+    int cmp = iCmp(c1->parentId, c2->parentId);
+    if (!cmp) {
+        cmp = iCmp(c1->order, c2->order);
+    }
+    return cmp ? cmp : iCmp(c1->id, c2->id);
+}
+
+static iString *urlKey_Bookmark_(const iBookmark *d) {
+    return isFolder_Bookmark(d) ? NULL : lower_String(&d->url);
+}
+
+static iString *rootKey_Bookmark_(const iBookmark *d) {
+    /* Only user-set icons are looked up by site. */
+    if (isFolder_Bookmark(d) || !d->icon || ~d->flags & userIcon_BookmarkFlag) {
+        return NULL;
+    }
+    iString *root = newRange_String(urlRoot_String(&d->url));
+    iString *key  = lower_String(root);
+    delete_String(root);
+    return key;
+}
+
+/*----------------------------------------------------------------------------------------------*/
 
 struct Impl_Bookmarks {
-    iMutex *  mtx;
-    int       idEnum;
-    iHash     bookmarks; /* bookmark ID is the hash key */
-    uint32_t  recentFolderId; /* recently interacted with */
-    iPtrArray remoteRequests;
+    iMutex *     mtx;
+    int          idEnum;
+    iHash        bookmarks;      /* bookmark ID is the hash key */
+    iSortedArray urlIndex;       /* BookmarkKey: URL */
+    iSortedArray rootIndex;      /* BookmarkKey: URL root of bookmarks with a user-set icon */
+    iSortedArray childIndex;     /* BookmarkChild: parent folder and order */
+    uint32_t     recentFolderId; /* recently interacted with */
+    iPtrArray    remoteRequests;
 };
 
 iDefineTypeConstruction(Bookmarks)
 
+static void insertKey_Bookmarks_(iSortedArray *index, iString *str, uint32_t id) {
+    if (str) {
+        insert_SortedArray(index, &(iBookmarkKey){ str, id }); /* takes ownership of `str` */
+    }
+}
+
+static void removeKey_Bookmarks_(iSortedArray *index, iString *str, uint32_t id) {
+    if (str) {
+        size_t pos;
+        if (locate_SortedArray(index, &(iBookmarkKey){ str, id }, &pos)) {
+            delete_String(((iBookmarkKey *) at_SortedArray(index, pos))->str);
+            remove_Array(&index->values, pos);
+        }
+        delete_String(str);
+    }
+}
+
+static void removeChild_Bookmarks_(iBookmarks *d, const iBookmark *bm) {
+    size_t pos;
+    if (locate_SortedArray(&d->childIndex,
+                           &(iBookmarkChild){ bm->parentId, bm->order, id_Bookmark(bm) },
+                           &pos)) {
+        remove_Array(&d->childIndex.values, pos);
+    }
+}
+
+static void insertChild_Bookmarks_(iBookmarks *d, const iBookmark *bm) {
+    insert_SortedArray(&d->childIndex,
+                       &(iBookmarkChild){ bm->parentId, bm->order, id_Bookmark(bm) });
+}
+
+static void insertIndex_Bookmarks_(iBookmarks *d, const iBookmark *bm) {
+    insertKey_Bookmarks_(&d->urlIndex, urlKey_Bookmark_(bm), id_Bookmark(bm));
+    insertKey_Bookmarks_(&d->rootIndex, rootKey_Bookmark_(bm), id_Bookmark(bm));
+    insertChild_Bookmarks_(d, bm);
+}
+
+static void removeIndex_Bookmarks_(iBookmarks *d, const iBookmark *bm) {
+    /* The indexed fields must not have been modified since the bookmark was indexed. */
+    removeKey_Bookmarks_(&d->urlIndex, urlKey_Bookmark_(bm), id_Bookmark(bm));
+    removeKey_Bookmarks_(&d->rootIndex, rootKey_Bookmark_(bm), id_Bookmark(bm));
+    removeChild_Bookmarks_(d, bm);
+}
+
+static void clearKeys_Bookmarks_(iSortedArray *index) {
+    iForEach(Array, i, &index->values) {
+        delete_String(((iBookmarkKey *) i.value)->str);
+    }
+    clear_SortedArray(index);
+}
+
+static void clearIndex_Bookmarks_(iBookmarks *d) {
+    clearKeys_Bookmarks_(&d->urlIndex);
+    clearKeys_Bookmarks_(&d->rootIndex);
+    clear_SortedArray(&d->childIndex);
+}
+
+static void rebuildIndex_Bookmarks_(iBookmarks *d) {
+    clearIndex_Bookmarks_(d);
+    iConstForEach(Hash, i, &d->bookmarks) {
+        insertIndex_Bookmarks_(d, (const iBookmark *) i.value);
+    }
+}
+
+static size_t firstChild_Bookmarks_(const iBookmarks *d, uint32_t parentId) {
+    size_t pos;
+    locate_SortedArray(&d->childIndex, &(iBookmarkChild){ parentId, INT_MIN, 0 }, &pos);
+    return pos;
+}
+
+static const iBookmarkChild *child_Bookmarks_(const iBookmarks *d, uint32_t parentId,
+                                              size_t pos) {
+    if (pos < size_SortedArray(&d->childIndex)) {
+        const iBookmarkChild *child = constAt_SortedArray(&d->childIndex, pos);
+        if (child->parentId == parentId) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+static size_t firstKey_Bookmarks_(const iSortedArray *index, const iString *str) {
+    size_t pos;
+    locate_SortedArray(index, &(iBookmarkKey){ iConstCast(iString *, str), 0 }, &pos);
+    return pos;
+}
+
+static const iBookmarkKey *key_Bookmarks_(const iSortedArray *index, const iString *str,
+                                          size_t pos) {
+    if (pos < size_SortedArray(index)) {
+        const iBookmarkKey *key = constAt_SortedArray(index, pos);
+        if (equal_String(key->str, str)) {
+            return key;
+        }
+    }
+    return NULL;
+}
+
 void init_Bookmarks(iBookmarks *d) {
     d->mtx = new_Mutex();
     d->idEnum = 0;
     init_Hash(&d->bookmarks);
+    init_SortedArray(&d->urlIndex, sizeof(iBookmarkKey), cmp_BookmarkKey_);
+    init_SortedArray(&d->rootIndex, sizeof(iBookmarkKey), cmp_BookmarkKey_);
+    init_SortedArray(&d->childIndex, sizeof(iBookmarkChild), cmp_BookmarkChild_);
     d->recentFolderId = 0;
     init_PtrArray(&d->remoteRequests);
 }
@@ -184,6 +382,9 @@ void deinit_Bookmarks(iBookmarks *d) {
     }
     deinit_PtrArray(&d->remoteRequests);
     clear_Bookmarks(d);
+    deinit_SortedArray(&d->childIndex);
+    deinit_SortedArray(&d->rootIndex);
+    deinit_SortedArray(&d->urlIndex);
     deinit_Hash(&d->bookmarks);
     delete_Mutex(d->mtx);
 }
@@ -194,6 +395,7 @@ void clear_Bookmarks(iBookmarks *d) {
         delete_Bookmark((iBookmark *) i.value);
     }
     clear_Hash(&d->bookmarks);
+    clearIndex_Bookmarks_(d);
     d->idEnum = 0;
     unlock_Mutex(d->mtx);
 }
@@ -201,6 +403,7 @@ void clear_Bookmarks(iBookmarks *d) {
 static void insertId_Bookmarks_(iBookmarks *d, iBookmark *bookmark, int id) {
     bookmark->node.key = id;
     insert_Hash(&d->bookmarks, &bookmark->node);
+    insertIndex_Bookmarks_(d, bookmark);
 }
 
 static void insert_Bookmarks_(iBookmarks *d, iBookmark *bookmark) {
@@ -371,15 +574,19 @@ iDefineTypeConstructionArgs(BookmarkLoader, (iBookmarks *b), b)
 
 /*----------------------------------------------------------------------------------------------*/
 
-static iBool isMatchingParent_Bookmark_(void *context, const iBookmark *bm) {
-    return bm->parentId == *(const uint32_t *) context;
-}
-
 void sort_Bookmarks(iBookmarks *d, uint32_t parentId, iBookmarksCompareFunc cmp) {
     lock_Mutex(d->mtx);
-    iConstForEach(PtrArray, i, list_Bookmarks(d, cmp, isMatchingParent_Bookmark_, &parentId)) {
+    iPtrArray *children = collectNew_PtrArray();
+    const size_t first = firstChild_Bookmarks_(d, parentId);
+    for (const iBookmarkChild *child; (child = child_Bookmarks_(d, parentId, first)) != NULL; ) {
+        pushBack_PtrArray(children, get_Bookmarks(d, child->id));
+        remove_Array(&d->childIndex.values, first);
+    }
+    sort_Array(children, (int (*)(const void *, const void *)) cmp);
+    iConstForEach(PtrArray, i, children) {
         iBookmark *bm = i.ptr;
         bm->order = index_PtrArrayConstIterator(&i) + 1;
+        insertChild_Bookmarks_(d, bm);
     }
     unlock_Mutex(d->mtx);
 }
@@ -415,6 +622,8 @@ static void mergeFolders_BookmarkLoader(iBookmarkLoader *d) {
             }
         }
     }
+    /* Parents were changed in bulk. */
+    rebuildIndex_Bookmarks_(d->bookmarks);
 }
 
 void deserialize_Bookmarks(iBookmarks *d, iStream *ins, enum iImportMethod method) {
@@ -428,10 +637,116 @@ void deserialize_Bookmarks(iBookmarks *d, iStream *ins, enum iImportMethod metho
     unlock_Mutex(d->mtx);
 }
 
+static void writeCacheEntry_Bookmarks_(iStream *outs, uint32_t id, const iBookmark *bm,
+                                       const iString *title, const iString *tags,
+                                       uint32_t flags) {
+    writeU32_Stream(outs, id);
+    serialize_String(&bm->url, outs);
+    serialize_String(title, outs);
+    serialize_String(tags, outs);
+    serialize_String(&bm->notes, outs);
+    serialize_String(&bm->identity, outs);
+    writeU32_Stream(outs, flags);
+    writeU32_Stream(outs, bm->icon);
+    writeU64_Stream(outs, (int64_t) nearbyint(seconds_Time(&bm->when))); /* like "%.0f" */
+    writeU32_Stream(outs, bm->parentId);
+    write32_Stream(outs, bm->order);
+}
+
+static uint32_t readCacheEntry_Bookmarks_(iStream *ins, iBookmark *bm) {
+    const uint32_t id = readU32_Stream(ins);
+    deserialize_String(&bm->url, ins);
+    deserialize_String(&bm->title, ins);
+    deserialize_String(&bm->tags, ins);
+    deserialize_String(&bm->notes, ins);
+    deserialize_String(&bm->identity, ins);
+    bm->flags = readU32_Stream(ins);
+    bm->icon  = readU32_Stream(ins);
+    initSeconds_Time(&bm->when, (int64_t) readU64_Stream(ins));
+    bm->parentId = readU32_Stream(ins);
+    bm->order    = read32_Stream(ins);
+    return id;
+}
+
+static iBool serializeCache_Bookmarks_(const iBookmarks *d, iStream *outs, iBool isParsed) {
+    /* The cache has the bookmarks exactly as they would be parsed from bookmarks.ini. The
+       tags are written as they are; returns false if some of them still have to be
+       normalized like when saving (see `normalizedCache_Bookmarks_`). */
+    iBool isNormalized = iTrue;
+    uint32_t count = 0;
+    iConstForEach(Hash, i, &d->bookmarks) {
+        if (~((const iBookmark *) i.value)->flags & remote_BookmarkFlag) {
+            count++;
+        }
+    }
+    writeU32_Stream(outs, d->recentFolderId);
+    writeU32_Stream(outs, count);
+    iString *title = new_String();
+    iConstForEach(Hash, j, &d->bookmarks) {
+        const iBookmark *bm = (const iBookmark *) j.value;
+        if (bm->flags & remote_BookmarkFlag) {
+            continue;
+        }
+        if (!isParsed && !isUnpacked_Tags_(&bm->tags)) {
+            isNormalized = iFalse;
+        }
+        set_String(title, &bm->title);
+        trim_String(title);
+        writeCacheEntry_Bookmarks_(outs, id_Bookmark(bm), bm, title, &bm->tags, bm->flags);
+    }
+    delete_String(title);
+    return isNormalized;
+}
+
+static void deserializeCache_Bookmarks_(iBookmarks *d, iStream *ins) {
+    d->recentFolderId = readU32_Stream(ins);
+    const uint32_t count = readU32_Stream(ins);
+    for (uint32_t i = 0; i < count; i++) {
+        iBookmark *bm = new_Bookmark();
+        const uint32_t id = readCacheEntry_Bookmarks_(ins, bm);
+        d->idEnum = iMax(d->idEnum, id);
+        insertId_Bookmarks_(d, bm, id);
+    }
+}
+
+static iBuffer *normalizedCache_Bookmarks_(const iBlock *cache) {
+    /* Does not need the bookmarks, so it can be done without holding the lock. */
+    iBuffer *in  = new_Buffer();
+    iBuffer *out = new_Buffer();
+    open_Buffer(in, cache);
+    openEmpty_Buffer(out);
+    iStream *ins  = stream_Buffer(in);
+    iStream *outs = stream_Buffer(out);
+    writeU32_Stream(outs, readU32_Stream(ins)); /* recent folder */
+    const uint32_t count = readU32_Stream(ins);
+    writeU32_Stream(outs, count);
+    iString *tags = new_String();
+    for (uint32_t i = 0; i < count; i++) {
+        iBookmark bm;
+        init_Bookmark(&bm);
+        const uint32_t id = readCacheEntry_Bookmarks_(ins, &bm);
+        uint32_t flags = bm.flags;
+        savedTags_Bookmark_(&bm, tags, &flags);
+        writeCacheEntry_Bookmarks_(outs, id, &bm, &bm.title, tags, flags);
+        deinit_Bookmark(&bm);
+    }
+    delete_String(tags);
+    iRelease(in);
+    return out;
+}
+
+static iBuffer *newCache_Bookmarks_(const iBookmarks *d, iBool isParsed, iBool *isNormalized_out) {
+    iBuffer *buf = new_Buffer();
+    openEmpty_Buffer(buf);
+    *isNormalized_out = serializeCache_Bookmarks_(d, stream_Buffer(buf), isParsed);
+    return buf;
+}
+
 void load_Bookmarks(iBookmarks *d, const char *dirPath) {
     clear_Bookmarks(d);
     /* Load new .ini bookmarks, if present. */
-    iFile *f = iClob(newCStr_File(concatPath_CStr(dirPath, fileName_Bookmarks_)));
+    const char *path = concatPath_CStr(dirPath, fileName_Bookmarks_);
+    iFile *f = iClob(newCStr_File(path));
     if (!open_File(f, readOnly_FileMode | text_FileMode)) {
         /* As a fallback, try loading the v1.6 bookmarks file. */
         loadOldFormat_Bookmarks(d, dirPath);
@@ -439,10 +754,24 @@ void load_Bookmarks(iBookmarks *d, const char *dirPath) {
         sort_Bookmarks(d, 0, cmpTitleAscending_Bookmark);
         return;
     }
+    const iBlock *src = collect_Block(readAll_File(f));
+    /* Parsing a large bookmarks.ini is slow, so use the binary cache if it is up to date. */
+    iBuffer *cache = open_IniCache(path, src, cacheVersion_Bookmarks_);
+    if (cache) {
+        deserializeCache_Bookmarks_(d, stream_Buffer(cache));
+        iRelease(cache);
+        return;
+    }
+    iBuffer *buf = iClob(new_Buffer());
+    open_Buffer(buf, src);
     iBookmarkLoader loader;
     init_BookmarkLoader(&loader, d);
-    load_BookmarkLoader(&loader, stream_File(f));
+    load_BookmarkLoader(&loader, stream_Buffer(buf));
     deinit_BookmarkLoader(&loader);
+    iBool isNormalized;
+    cache = newCache_Bookmarks_(d, iTrue, &isNormalized);
+    save_IniCache(path, src, cacheVersion_Bookmarks_, data_Buffer(cache));
+    iRelease(cache);
 }
 
 void serialize_Bookmarks(const iBookmarks *d, iStream *out) {
@@ -495,27 +824,41 @@ void save_Bookmarks(const iBookmarks *d, const char *dirPath) {
     const char *tempPath = concatPath_CStr(dirPath, tempFileName_Bookmarks_);
     const char *finalPath = concatPath_CStr(dirPath, fileName_Bookmarks_);
     lock_Mutex(d->mtx);
+    iBuffer *ini = new_Buffer();
+    openEmpty_Buffer(ini);
+    serialize_Bookmarks(d, stream_Buffer(ini));
     iFile *f = newCStr_File(tempPath);
     if (open_File(f, writeOnly_FileMode | text_FileMode)) {
-        serialize_Bookmarks(d, stream_File(f));
+        write_File(f, data_Buffer(ini));
     }
     iRelease(f);
+    iBool isNormalized;
+    iBuffer *cache = newCache_Bookmarks_(d, iFalse, &isNormalized);
     unlock_Mutex(d->mtx);
+    if (!isNormalized) {
+        iBuffer *normalized = normalizedCache_Bookmarks_(data_Buffer(cache));
+        iRelease(cache);
+        cache = normalized;
+    }
     commitFile_App(finalPath, tempPath);
+    save_IniCache(finalPath, data_Buffer(ini), cacheVersion_Bookmarks_, data_Buffer(cache));
+    iRelease(cache);
+    iRelease(ini);
 }
 
-static iRangei orderRange_Bookmarks_(const iBookmarks *d) {
-    iRangei ord = { 0, 0 };
-    iConstForEach(Hash, i, &d->bookmarks) {
-        const iBookmark *bm = (const iBookmark *) i.value;
-        if (isEmpty_Range(&ord)) {
-            ord.start = bm->order;
-            ord.end = bm->order + 1;
-        }
-        else {
-            ord.start = iMin(ord.start, bm->order);
-            ord.end   = iMax(ord.end, bm->order + 1);
+static iRangei orderRange_Bookmarks_(const iBookmarks *d, uint32_t parentId) {
+    /* Orders are only compared inside the same folder. */
+    iRangei      ord = { 0, 0 };
+    const size_t pos = firstChild_Bookmarks_(d, parentId);
+    const iBookmarkChild *first = child_Bookmarks_(d, parentId, pos);
+    if (first) {
+        size_t end = pos + 1;
+        while (child_Bookmarks_(d, parentId, end)) {
+            end++;
         }
+        const iBookmarkChild *last = child_Bookmarks_(d, parentId, end - 1);
+        ord.start = first->order;
+        ord.end   = last->order + 1;
     }
     return ord;
 }
@@ -538,7 +881,7 @@ uint32_t addToFolder_Bookmarks(iBookmarks *d, const iString *url, const iString
     }
     bm->icon = icon;
     initCurrent_Time(&bm->when);
-    const iRangei ord = orderRange_Bookmarks_(d);
+    const iRangei ord = orderRange_Bookmarks_(d, folderId);
     if (prefs_App()->addBookmarksToBottom) {
         bm->order = ord.end; /* Last in lists. */
     }
@@ -551,33 +894,84 @@ uint32_t addToFolder_Bookmarks(iBookmarks *d, const iString *url, const iString
     return id_Bookmark(bm);
 }
 
-iBool remove_Bookmarks(iBookmarks *d, uint32_t id) {
-    lock_Mutex(d->mtx);
+static iBool removeTree_Bookmarks_(iBookmarks *d, uint32_t id) {
     iBookmark *bm = (iBookmark *) remove_Hash(&d->bookmarks, id);
     if (bm) {
+        removeIndex_Bookmarks_(d, bm);
         /* Remove all the contained bookmarks as well. */
-        iConstForEach(PtrArray, i, list_Bookmarks(d, NULL, filterInsideFolder_Bookmark, bm)) {
-            delete_Bookmark((iBookmark *) remove_Hash(&d->bookmarks, id_Bookmark(i.ptr)));
+        const size_t first = firstChild_Bookmarks_(d, id);
+        for (const iBookmarkChild *child; (child = child_Bookmarks_(d, id, first)) != NULL; ) {
+            removeTree_Bookmarks_(d, child->id);
         }
         delete_Bookmark(bm);
     }
-    unlock_Mutex(d->mtx);
     return bm != NULL;
 }
 
+iBool remove_Bookmarks(iBookmarks *d, uint32_t id) {
+    lock_Mutex(d->mtx);
+    const iBool removed = removeTree_Bookmarks_(d, id);
+    unlock_Mutex(d->mtx);
+    return removed;
+}
+
+void setParent_Bookmarks(iBookmarks *d, uint32_t id, uint32_t parentId) {
+    lock_Mutex(d->mtx);
+    iBookmark *bm = get_Bookmarks(d, id);
+    if (bm) {
+        removeChild_Bookmarks_(d, bm);
+        bm->parentId = parentId;
+        insertChild_Bookmarks_(d, bm);
+    }
+    unlock_Mutex(d->mtx);
+}
+
+static void removeId_Bookmarks_(iSortedArray *index, uint32_t id, iBool isKey) {
+    iForEach(Array, i, &index->values) {
+        if (isKey) {
+            iBookmarkKey *key = i.value;
+            if (key->id == id) {
+                delete_String(key->str);
+                remove_ArrayIterator(&i);
+            }
+        }
+        else if (((const iBookmarkChild *) i.value)->id == id) {
+            remove_ArrayIterator(&i);
+        }
+    }
+}
+
+void reindex_Bookmarks(iBookmarks *d, uint32_t id) {
+    lock_Mutex(d->mtx);
+    /* The previous values of the indexed fields are unknown, so look for the ID. */
+    removeId_Bookmarks_(&d->urlIndex, id, iTrue);
+    removeId_Bookmarks_(&d->rootIndex, id, iTrue);
+    removeId_Bookmarks_(&d->childIndex, id, iFalse);
+    const iBookmark *bm = get_Bookmarks(d, id);
+    if (bm) {
+        insertIndex_Bookmarks_(d, bm);
+    }
+    unlock_Mutex(d->mtx);
+}
+
 iBool updateBookmarkIcon_Bookmarks(iBookmarks *d, const iString *url, iChar icon) {
-    iBool changed = iFalse;
+    iBool    changed = iFalse;
+    iString *key     = lower_String(url);
     lock_Mutex(d->mtx);
-    iForEach(Hash, i, &d->bookmarks) {
-        iBookmark *bm = (iBookmark *) i.value;
+    const iBookmarkKey *entry;
+    for (size_t pos = firstKey_Bookmarks_(&d->urlIndex, key);
+         (entry = key_Bookmarks_(&d->urlIndex, key, pos)) != NULL;
+         pos++) {
+        iBookmark *bm = get_Bookmarks(d, entry->id);
         if (~bm->flags & remote_BookmarkFlag && ~bm->flags & userIcon_BookmarkFlag) {
-            if (equalCase_String(&bm->url, url) && icon != bm->icon) {
+            if (icon != bm->icon) {
                 bm->icon = icon;
                 changed = iTrue;
             }
         }
     }
     unlock_Mutex(d->mtx);
+    delete_String(key);
     return changed;
 }
 
@@ -595,24 +989,25 @@ iChar siteIcon_Bookmarks(const iBookmarks *d, const iString *url) {
     if (isEmpty_String(url)) {
         return 0;
     }
-    const iRangecc urlRoot      = urlRoot_String(url);
-    size_t         matchingSize = iInvalidSize; /* we'll pick the shortest matching */
-    iChar          icon         = 0;
+    iString *urlRoot      = newRange_String(urlRoot_String(url));
+    iString *key          = lower_String(urlRoot);
+    size_t   matchingSize = iInvalidSize; /* we'll pick the shortest matching */
+    iChar    icon         = 0;
     lock_Mutex(d->mtx);
-    iConstForEach(Hash, i, &d->bookmarks) {
-        const iBookmark *bm = (const iBookmark *) i.value;
-        if (bm->icon && bm->flags & userIcon_BookmarkFlag) {
-            const iRangecc bmRoot = urlRoot_String(&bm->url);
-            if (equalRangeCase_Rangecc(urlRoot, bmRoot)) {
-                const size_t n = size_String(&bm->url);
-                if (n < matchingSize) {
-                    matchingSize = n;
-                    icon = bm->icon;
-                }
-            }
+    const iBookmarkKey *entry;
+    for (size_t pos = firstKey_Bookmarks_(&d->rootIndex, key);
+         (entry = key_Bookmarks_(&d->rootIndex, key, pos)) != NULL;
+         pos++) {
+        const iBookmark *bm = (const iBookmark *) value_Hash(&d->bookmarks, entry->id);
+        const size_t     n  = size_String(&bm->url);
+        if (n < matchingSize) {
+            matchingSize = n;
+            icon = bm->icon;
         }
     }
     unlock_Mutex(d->mtx);
+    delete_String(key);
+    delete_String(urlRoot);
     return icon;
 }
 
@@ -622,14 +1017,21 @@ iBookmark *get_Bookmarks(iBookmarks *d, uint32_t id) {
 
 void reorder_Bookmarks(iBookmarks *d, uint32_t id, int newOrder) {
     lock_Mutex(d->mtx);
-    iForEach(Hash, i, &d->bookmarks) {
-        iBookmark *bm = (iBookmark *) i.value;
-        if (id_Bookmark(bm) == id) {
-            bm->order = newOrder;
-        }
-        else if (bm->order >= newOrder) {
-            bm->order++;
+    iBookmark *bm = get_Bookmarks(d, id);
+    if (bm) {
+        removeChild_Bookmarks_(d, bm);
+        /* Make room among the siblings. They stay sorted since all are shifted by one. */
+        const iBookmarkChild *sibling;
+        for (size_t pos = firstChild_Bookmarks_(d, bm->parentId);
+             (sibling = child_Bookmarks_(d, bm->parentId, pos)) != NULL;
+             pos++) {
+            if (sibling->order >= newOrder) {
+                ((iBookmarkChild *) sibling)->order++;
+                get_Bookmarks(d, sibling->id)->order++;
+            }
         }
+        bm->order = newOrder;
+        insertChild_Bookmarks_(d, bm);
     }
     unlock_Mutex(d->mtx);
 }
@@ -663,14 +1065,24 @@ static iBool matchUrlAndIdent_(iMatchUrlArgs *args, const iBookmark *bm) {
 }
 
 uint32_t findUrlIdent_Bookmarks(const iBookmarks *d, const iString *url, const iString *identFp) {
-    iMatchUrlArgs args = { .url = canonicalUrl_String(url), .identityFp = identFp };
-    /* TODO: O(n), boo */
-    const iPtrArray *found =
-        list_Bookmarks(d, NULL, (iBookmarksFilterFunc) matchUrlAndIdent_, &args);
-    if (isEmpty_PtrArray(found)) {
-        return 0;
+    iMatchUrlArgs    args  = { .url = canonicalUrl_String(url), .identityFp = identFp };
+    iString *        key   = lower_String(args.url);
+    const iBookmark *found = NULL;
+    lock_Mutex(d->mtx);
+    const iBookmarkKey *entry;
+    for (size_t pos = firstKey_Bookmarks_(&d->urlIndex, key);
+         (entry = key_Bookmarks_(&d->urlIndex, key, pos)) != NULL;
+         pos++) {
+        const iBookmark *bm = (const iBookmark *) value_Hash(&d->bookmarks, entry->id);
+        /* The most recently created one is preferred. */
+        if (matchUrlAndIdent_(&args, bm) &&
+            (!found || cmpTimeDescending_Bookmark_(&bm, &found) < 0)) {
+            found = bm;
+        }
     }
-    return id_Bookmark(constFront_PtrArray(found));
+    unlock_Mutex(d->mtx);
+    delete_String(key);
+    return found ? id_Bookmark(found) : 0;
 }
 
 /*----------------------------------------------------------------------------------------------*/
@@ -849,10 +1261,9 @@ void requestFinished_Bookmarks(iBookmarks *d, iGmRequest *req) {
                     if (isEmpty_String(titleStr)) {
                         setRange_String(titleStr, urlHost_String(urlStr));
                     }
-                    const uint32_t bmId = add_Bookmarks(d, absUrl, titleStr, NULL, 0x2913);
-                    iBookmark *bm = get_Bookmarks(d, bmId);
-                    bm->flags |= remote_BookmarkFlag;
-                    bm->parentId = *(uint32_t *) userData_Object(req);
+                    const uint32_t bmId = addToFolder_Bookmarks(
+                        d, absUrl, titleStr, NULL, 0x2913, *(uint32_t *) userData_Object(req));
+                    get_Bookmarks(d, bmId)->flags |= remote_BookmarkFlag;
                     delete_String(titleStr);
                 }
                 delete_String(urlStr);
@@ -882,6 +1293,7 @@ void fetchRemote_Bookmarks(iBookmarks *d) {
             iBookmark *bm = (iBookmark *) i.value;
             if (bm->flags & remote_BookmarkFlag) {
                 remove_HashIterator(&i);
+                removeIndex_Bookmarks_(d, bm);
                 delete_Bookmark(bm);
                 numRemoved++;
             }
@@ -898,6 +1310,7 @@ void fetchRemote_Bookmarks(iBookmarks *d) {
         setUserData_Object(req, bmId);
         pushBack_PtrArray(&d->remoteRequests, req);
         setUrl_GmRequest(req, &bm->url);
+        setPriority_GmRequest(req, background_GmRequestPriority);
         iConnect(GmRequest, req, finished, req, remoteRequestFinished_Bookmarks_);
         submit_GmRequest(req);
     }
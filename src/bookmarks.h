@@ -92,7 +92,9 @@ uint32_t    addToFolder_Bookmarks       (iBookmarks *, const iString *url, const
                                          const iString *tags, iChar icon, uint32_t folderId);
 iBool       remove_Bookmarks            (iBookmarks *, uint32_t id);
 iBookmark * get_Bookmarks               (iBookmarks *, uint32_t id);
-void        reorder_Bookmarks           (iBookmarks *, uint32_t id, int newOrder);
+void        reorder_Bookmarks           (iBookmarks *, uint32_t id, int newOrder); /* within parent */
+void        setParent_Bookmarks         (iBookmarks *, uint32_t id, uint32_t parentId);
+void        reindex_Bookmarks           (iBookmarks *, uint32_t id); /* after editing fields directly */
 iBool       updateBookmarkIcon_Bookmarks(iBookmarks *, const iString *url, iChar icon);
 void        setRecentFolder_Bookmarks   (iBookmarks *, uint32_t folderId);
 void        sort_Bookmarks              (iBookmarks *, uint32_t parentId, iBookmarksCompareFunc cmp);
@@ -100,8 +102,8 @@ void        fetchRemote_Bookmarks       (iBookmarks *);
 void        requestFinished_Bookmarks   (iBookmarks *, iGmRequest *req);
 
 iChar       siteIcon_Bookmarks          (const iBookmarks *, const iString *url);
-uint32_t    findUrl_Bookmarks           (const iBookmarks *, const iString *url); /* O(n) */
-uint32_t    findUrlIdent_Bookmarks      (const iBookmarks *, const iString *url, const iString *identFp); /* O(n) */
+uint32_t    findUrl_Bookmarks           (const iBookmarks *, const iString *url);
+uint32_t    findUrlIdent_Bookmarks      (const iBookmarks *, const iString *url, const iString *identFp);
 uint32_t    recentFolder_Bookmarks      (const iBookmarks *);
 
 //iBool   filterTagsRegExp_Bookmarks      (void *regExp, const iBookmark *);
@@ -113,8 +113,9 @@ enum iFileVersion {
     responseIdentity_FileVersion        = 8,
     recentUrlSetIdentity_FileVersion    = 9,
     recentlySubmittedInput_FileVersion  = 10,
+    separateContentFile_FileVersion     = 11,
     /* meta */
-    latest_FileVersion = 10, /* used by state.lgr */
+    latest_FileVersion = 11, /* used by state.lgr */
     idents_FileVersion = 1, /* used by GmCerts/idents.lgr */
 };
 
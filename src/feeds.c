@@ -23,7 +23,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "feeds.h"
 #include "bookmarks.h"
 #include "gmrequest.h"
+#include "mimehooks.h"
 #include "visited.h"
+#include "xmlfeed.h"
 #include "lang.h"
 #include "app.h"
 
@@ -148,6 +150,10 @@ static iBool isInitialized_Feeds_(const iFeeds *d) {
 static void submit_FeedJob_(iFeedJob *d) {
     d->request = new_GmRequest(certs_App());
     setUrl_GmRequest(d->request, &d->url);
+    setPriority_GmRequest(d->request, background_GmRequestPriority);
+    /* The built-in hook would translate XML feeds to Gemini feeds, but XML is parsed
+       directly. Other formats are run through the hooks in `parseResult_FeedJob_`. */
+    enableFilters_GmRequest(d->request, iFalse);
     initCurrent_Time(&d->startTime);
     submit_GmRequest(d->request);
 }
@@ -200,6 +206,60 @@ static iBool isUrlIgnored_FeedJob_(const iFeedJob *d, iRangecc url) {
     return iFalse;
 }
 
+static void addEntry_FeedJob_(iFeedJob *d, iRangecc url, iRangecc title, const iDate *date,
+                              iTime *discovered) {
+    if (isUrlIgnored_FeedJob_(d, url)) {
+        return;
+    }
+    iFeedEntry *entry = new_FeedEntry();
+    iTime perEntryAdjust;
+    initSeconds_Time(&perEntryAdjust, 1.0);
+    entry->discovered = *discovered;
+    sub_Time(discovered, &perEntryAdjust);
+    entry->bookmarkId = d->bookmarkId;
+    setRange_String(&entry->url, url);
+    set_String(&entry->url, canonicalUrl_String(absoluteUrl_String(url_GmRequest(d->request), &entry->url)));
+    setRange_String(&entry->title, title);
+    trimTitle_(&entry->title);
+    init_Time(
+        &entry->posted,
+        &(iDate){
+            .year = date->year, .month = date->month, .day = date->day, .hour = 12 /* noon UTC */ });
+    pushBack_PtrArray(&d->results, entry);
+}
+
+iDeclareType(FeedXmlContext)
+
+struct Impl_FeedXmlContext {
+    iFeedJob *job;
+    iTime     now;
+};
+
+static void addXmlEntry_FeedJob_(void *context, const iXmlFeedEntry *entry) {
+    iFeedXmlContext *ctx = context;
+    if (isEmpty_String(&entry->title) || isEmpty_String(&entry->url) || !entry->date.year) {
+        return;
+    }
+    addEntry_FeedJob_(ctx->job,
+                      range_String(&entry->url),
+                      range_String(&entry->title),
+                      &entry->date,
+                      &ctx->now);
+}
+
+static void parseXml_FeedJob_(iFeedJob *d, const iBlock *body) {
+    /* The XML is read straight into feed entries, with no document tree or
+       intermediate Gemini feed. */
+    iBeginCollect();
+    iFeedXmlContext ctx = { .job = d };
+    initCurrent_Time(&ctx.now);
+    iXmlFeedParser *parser = new_XmlFeedParser();
+    setEntryHandler_XmlFeedParser(parser, addXmlEntry_FeedJob_, &ctx);
+    parse_XmlFeedParser(parser, range_Block(body));
+    delete_XmlFeedParser(parser);
+    iEndCollect();
+}
+
 static iBool parseResult_FeedJob_(iFeedJob *d) {
     /* Returns true if the job is done and can be released. False means the job continues. */
     if (category_GmStatusCode(status_GmRequest(d->request)) == categoryRedirect_GmStatusCode) {
@@ -213,7 +273,35 @@ static iBool parseResult_FeedJob_(iFeedJob *d) {
         return iTrue;
     }
     /* TODO: Should tell the user if the request failed. */
-    if (isSuccess_GmStatusCode(status_GmRequest(d->request))) {
+    if (isSuccess_GmStatusCode(status_GmRequest(d->request)) &&
+        isXmlMimeType_XmlFeed(meta_GmRequest(d->request))) {
+        parseXml_FeedJob_(d, &lockResponse_GmRequest(d->request)->body);
+        unlockResponse_GmRequest(d->request);
+    }
+    else if (isSuccess_GmStatusCode(status_GmRequest(d->request))) {
+        iString src;
+        initBlock_String(&src, &lockResponse_GmRequest(d->request)->body);
+        unlockResponse_GmRequest(d->request);
+        const iString *mime = meta_GmRequest(d->request);
+        if (!startsWithCase_String(mime, "text/gemini") &&
+            willTryFilter_MimeHooks(mimeHooks_App(), mime)) {
+            /* A user's MIME hook may translate some other feed format. The result is a
+               complete response, so the header line is skipped. */
+            iBlock *xbody = tryFilter_MimeHooks(mimeHooks_App(), mime, utf8_String(&src), &d->url);
+            if (xbody) {
+                iRangecc body = range_Block(xbody);
+                iRangecc header = iNullRange;
+                nextSplit_Rangecc(body, "\n", &header);
+                body.start = iMin(header.end + 1, body.end);
+                if (startsWith_Rangecc(header, "20")) {
+                    setRange_String(&src, body);
+                }
+                else {
+                    clear_String(&src); /* the hook rejected it */
+                }
+                delete_Block(xbody);
+            }
+        }
         iBeginCollect();
         iTime now;
         iTime perEntryAdjust;
@@ -224,9 +312,6 @@ static iBool parseResult_FeedJob_(iFeedJob *d) {
                        "([0-9][0-9][0-9][0-9]-[0-1][0-9]-[0-3][0-9])"
                        "([^0-9].*)",
                        0);
-        iString src;
-        initBlock_String(&src, &lockResponse_GmRequest(d->request)->body);
-        unlockResponse_GmRequest(d->request);
         iRangecc srcLine = iNullRange;
         while (nextSplit_Rangecc(range_String(&src), "\n", &srcLine)) {
             iRangecc line = srcLine;
@@ -237,24 +322,10 @@ static iBool parseResult_FeedJob_(iFeedJob *d) {
                 const iRangecc url   = capturedRange_RegExpMatch(&m, 1);
                 const iRangecc date  = capturedRange_RegExpMatch(&m, 2);
                 const iRangecc title = capturedRange_RegExpMatch(&m, 3);
-                if (isUrlIgnored_FeedJob_(d, url)) {
-                    continue;
-                }
-                iFeedEntry *entry = new_FeedEntry();
-                entry->discovered = now;
-                sub_Time(&now, &perEntryAdjust);
-                entry->bookmarkId = d->bookmarkId;
-                setRange_String(&entry->url, url);
-                set_String(&entry->url, canonicalUrl_String(absoluteUrl_String(url_GmRequest(d->request), &entry->url)));
-                setRange_String(&entry->title, title);
-                trimTitle_(&entry->title);
-                int year, month, day;
-                sscanf(date.start, "%04d-%02d-%02d", &year, &month, &day);
-                init_Time(
-                    &entry->posted,
-                    &(iDate){
-                        .year = year, .month = month, .day = day, .hour = 12 /* noon UTC */ });
-                pushBack_PtrArray(&d->results, entry);
+                iDate posted;
+                iZap(posted);
+                sscanf(date.start, "%04d-%02d-%02d", &posted.year, &posted.month, &posted.day);
+                addEntry_FeedJob_(d, url, title, &posted, &now);
             }
             if (d->checkHeadings) {
                 init_RegExpMatch(&m);
@@ -77,22 +77,19 @@ static void parseNavigationLinks_Gempub_(const iGempub *d) {
     submit_GmRequest(index); /* this is just a local file read */
     iAssert(isFinished_GmRequest(index));
     iRangecc src = iNullRange;
-    iRegExp *linkPattern = iClob(newGemtextLink_RegExp());
     while (nextSplit_Rangecc(range_Block(body_GmRequest(index)), "\n", &src)) {
         iRangecc line = src;
         trim_Rangecc(&line);
-        iRegExpMatch m;
-        init_RegExpMatch(&m);
-        if (matchRange_RegExp(linkPattern, line, &m)) {
+        iRangecc url, label;
+        if (parseGemtextLink_Rangecc(line, "=>", &url, &label)) {
             iBeginCollect();
-            const iRangecc url = capturedRange_RegExpMatch(&m, 1);
             iUrl parts;
             init_Url(&parts, collectNewRange_String(url));
             if (isEmpty_Range(&parts.scheme)) {
                 iGempubNavLink link;
                 init_GempubNavLink(&link);
                 set_String(&link.url, absoluteUrl_String(url_GmRequest(index), collectNewRange_String(url)));
-                setRange_String(&link.label, capturedRange_RegExpMatch(&m, 2));
+                setRange_String(&link.label, label);
                 trim_String(&link.label);
                 if (isEmpty_String(&link.label)) {
                     setRange_String(&link.label, url);                    
@@ -42,6 +42,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include <the_Foundation/stringset.h>
 
 #include <ctype.h>
+#include <limits.h>
 
 iBool isDark_GmDocumentTheme(enum iGmDocumentTheme d) {
     if (d == gray_GmDocumentTheme || d == oceanic_GmDocumentTheme || d == sepia_GmDocumentTheme) {
@@ -153,6 +154,50 @@ static uint32_t themeHash_(const iBlock *data) {
 
 /*----------------------------------------------------------------------------------------------*/
 
+iDeclareType(GmLine)
+
+enum iGmLineFlag {
+    preformat_GmLineFlag = iBit(1), /* contents of a preformatted block, or plain text */
+    preBegin_GmLineFlag  = iBit(2), /* opening ``` */
+    preEnd_GmLineFlag    = iBit(3), /* closing ``` */
+    hRule_GmLineFlag     = iBit(4), /* Markdown horizontal rule */
+};
+
+/* One line of the source, as parsed. Layout only needs to typeset these, so the source does
+   not have to be parsed again when the width, fonts, or colors change. */
+struct Impl_GmLine {
+    iRangecc  text;   /* visible part of the line (e.g., link label or trimmed text) */
+    iGmLinkId linkId;
+    uint16_t  preId;  /* preformatted block */
+    uint8_t   type;   /* enum iGmLineType */
+    uint8_t   flags;  /* enum iGmLineFlag */
+};
+
+iDeclareType(GmLayoutState)
+
+/* Progress of the layout. Very long documents are laid out in batches of lines from top to
+   bottom, so the runs that have already been laid out never move. */
+struct Impl_GmLayoutState {
+    size_t   lineIndex; /* next line to lay out */
+    iInt2    pos;
+    int      preFont;
+    uint16_t foldedPreId;
+    uint8_t  prevType;         /* enum iGmLineType */
+    uint8_t  prevNonBlankType; /* enum iGmLineType */
+    iBool    isFirstText;
+    iBool    addQuoteIcon;
+    iBool    enableIndents;
+    iBool    followsBlank;
+};
+
+/* Number of lines laid out at a time when the document is too long to do it all at once. */
+static const size_t layoutBatchSize_GmDocument_ = 1000;
+
+/* Number of runs per entry in the index for finding runs by Y coordinate. */
+static const size_t runIndexBlockSize_GmDocument_ = 32;
+
+/*----------------------------------------------------------------------------------------------*/
+
 struct Impl_GmDocument {
     iObject object;
     enum iSourceFormat origFormat;
@@ -165,7 +210,10 @@ struct Impl_GmDocument {
     iInt2     size;
     int       contentWidth; /* some runs may extend past the requested width */
     int       outsideMargin;
+    iArray    lines;  /* parsed source lines; independent of layout width and fonts */
     iArray    layout; /* contents of source, laid out in document space */
+    iGmLayoutState layoutState;
+    iArray    runIndex; /* max visual bottom of runs up to the end of each block of runs */
     iStringArray auxText; /* generated text that appears on the page but is not part of the source */
     iPtrArray links;
     iString   title; /* the first top-level title */
@@ -183,6 +231,8 @@ struct Impl_GmDocument {
         iBool isSpartan : 1;
         iBool isNex : 1;
         iBool isLayoutInvalidated : 1;
+        iBool isParseInvalidated : 1;
+        iBool isParsedNormalized : 1;
         iBool isPaletteValid : 1;
         iBool isGopherMenu : 1;
     } flags;
@@ -299,13 +349,14 @@ static int lastVisibleRunBottom_GmDocument_(const iGmDocument *d) {
         if (isEmpty_Range(&run->text)) {
             continue;
         }
-        return top_Rect(run->bounds) + height_Rect(run->bounds) * prefs_App()->lineSpacing;
+        const iRect bounds = bounds_GmRun(run);
+        return top_Rect(bounds) + height_Rect(bounds) * prefs_App()->lineSpacing;
     }
     return 0;
 }
 
-static iInt2 measurePreformattedBlock_GmDocument_(const iGmDocument *d, const char *start, int font,
-                                                  iRangecc *contents, const char **endPos) {
+static void findPreformattedBlock_GmDocument_(const iGmDocument *d, const char *start,
+                                              iRangecc *contents, const char **endPos) {
     const iRangecc content = { start, constEnd_String(&d->source) };
     iRangecc line = iNullRange;
     nextSplit_Rangecc(content, "\n", &line);
@@ -318,7 +369,6 @@ static iInt2 measurePreformattedBlock_GmDocument_(const iGmDocument *d, const ch
         }
         contents->end = line.end;
     }
-    return measureRange_Text(font, *contents).bounds.size;
 }
 
 static void setScheme_GmLink_(iGmLink *d, enum iGmLinkScheme scheme) {
@@ -348,32 +398,21 @@ static iBool isAllowedLinkIcon_Char_(iChar icon) {
 
 static iRangecc addLink_GmDocument_(iGmDocument *d, iRangecc line, iGmLinkId *linkId) {
     /* Returns the human-readable label of the link. */
-    static iRegExp *pattern_;
-    static iRegExp *spartanQueryPattern_;
-    if (!pattern_) {
-        pattern_ = newGemtextLink_RegExp();
-    }
-    if (d->flags.isSpartan && !spartanQueryPattern_) {
-        spartanQueryPattern_ = new_RegExp("=:\\s*([^\\s]+)(\\s.*)?", 0);
-    }
     *linkId = 0;
     iGmLink *link = NULL;
-    iRegExpMatch m;
-    init_RegExpMatch(&m);
-    if (d->flags.isSpartan && matchRange_RegExp(spartanQueryPattern_, line, &m)) {
+    iRangecc url   = iNullRange;
+    iRangecc label = iNullRange;
+    if (d->flags.isSpartan && parseGemtextLink_Rangecc(line, "=:", &url, &label)) {
         link = new_GmLink();
-        link->urlRange = capturedRange_RegExpMatch(&m, 1);
+        link->urlRange = url;
         link->flags = query_GmLinkFlag;
         setScheme_GmLink_(link, spartan_GmLinkScheme);
         setRange_String(&link->url, link->urlRange);
         set_String(&link->url, canonicalUrl_String(absoluteUrl_String(&d->url, &link->url)));
     }
-    if (!link) {
-        init_RegExpMatch(&m);
-    }
-    if (!link && matchRange_RegExp(pattern_, line, &m)) {
+    if (!link && parseGemtextLink_Rangecc(line, "=>", &url, &label)) {
         link = new_GmLink();
-        link->urlRange = capturedRange_RegExpMatch(&m, 1);
+        link->urlRange = url;
         setRange_String(&link->url, link->urlRange);
         set_String(&link->url, canonicalUrl_String(absoluteUrl_String(&d->url, &link->url)));
         if (d->flags.isNex) {
@@ -441,24 +480,23 @@ static iRangecc addLink_GmDocument_(iGmDocument *d, iRangecc line, iGmLinkId *li
             }
             /* Check the file name extension, if present. */
             if (!isEmpty_Range(&parts.path)) {
-                iString *path = newRange_String(parts.path);
-                if (endsWithCase_String(path, ".gif")  || endsWithCase_String(path, ".jpg") ||
-                    endsWithCase_String(path, ".jpeg") || endsWithCase_String(path, ".png") ||
-                    endsWithCase_String(path, ".tga")  || endsWithCase_String(path, ".psd") ||
+                const iRangecc path = parts.path;
+                if (endsWithCase_Rangecc(path, ".gif")  || endsWithCase_Rangecc(path, ".jpg") ||
+                    endsWithCase_Rangecc(path, ".jpeg") || endsWithCase_Rangecc(path, ".png") ||
+                    endsWithCase_Rangecc(path, ".tga")  || endsWithCase_Rangecc(path, ".psd") ||
 #if defined (LAGRANGE_ENABLE_WEBP)
-                    endsWithCase_String(path, ".webp") ||
+                    endsWithCase_Rangecc(path, ".webp") ||
 #endif
-                    endsWithCase_String(path, ".hdr")  || endsWithCase_String(path, ".pic")) {
+                    endsWithCase_Rangecc(path, ".hdr")  || endsWithCase_Rangecc(path, ".pic")) {
                     link->flags |= imageFileExtension_GmLinkFlag;
                 }
-                else if (endsWithCase_String(path, ".mp3") || endsWithCase_String(path, ".wav") ||
-                         endsWithCase_String(path, ".mid") || endsWithCase_String(path, ".ogg")) {
+                else if (endsWithCase_Rangecc(path, ".mp3") || endsWithCase_Rangecc(path, ".wav") ||
+                         endsWithCase_Rangecc(path, ".mid") || endsWithCase_Rangecc(path, ".ogg")) {
                     link->flags |= audioFileExtension_GmLinkFlag;
                 }
-                else if (endsWithCase_String(path, ".fontpack")) {
+                else if (endsWithCase_Rangecc(path, ".fontpack")) {
                     link->flags |= fontpackFileExtension_GmLinkFlag;
                 }
-                delete_String(path);
             }
         }
     }
@@ -475,13 +513,13 @@ static iRangecc addLink_GmDocument_(iGmDocument *d, iRangecc line, iGmLinkId *li
         }
         pushBack_PtrArray(&d->links, link);
         *linkId = size_PtrArray(&d->links); /* index + 1 */
-        iRangecc desc = capturedRange_RegExpMatch(&m, 2);
+        iRangecc desc = label;
         trim_Rangecc(&desc);
         link->labelRange = desc;
         link->labelIcon = iNullRange;
         if (d->flags.isNex) {
             link->labelIcon = (iRangecc){ line.start, link->urlRange.start };
-            link->labelRange = capturedRange_RegExpMatch(&m, 2);
+            link->labelRange = label;
             line = link->urlRange;
         }
         else if (!isEmpty_Range(&desc)) {
@@ -523,7 +561,7 @@ static iRangecc addLink_GmDocument_(iGmDocument *d, iRangecc line, iGmLinkId *li
             }
         }
         else {
-            line = capturedRange_RegExpMatch(&m, 1); /* Show the URL. */
+            line = url; /* Show the URL. */
         }
     }
     return line;
@@ -573,6 +611,17 @@ static enum iGmDocumentTheme currentTheme_(void) {
     return docTheme_Prefs(prefs_App());
 }
 
+static void setBounds_GmRun_(iGmRun *d, int left, int width) {
+    /* Vertically, the bounds match `visBounds`. */
+    d->boundsLeft  = left;
+    d->boundsWidth = width;
+}
+
+static void clearBounds_GmRun_(iGmRun *d) {
+    d->boundsLeft  = 0;
+    d->boundsWidth = -1;
+}
+
 static void alignDecoration_GmRun_(iGmRun *run, iBool isCentered) {
     const iRect visBounds = visualBounds_Text(run->font, run->text);
     const int   visWidth  = width_Rect(visBounds);
@@ -690,13 +739,11 @@ static iBool typesetOneLine_RunTypesetter_(iWrapText *wrap, iRangecc wrapRange,
     if (~d->run.flags & startOfLine_GmRunFlag && d->lineHeightReduction > 0.0f) {
         d->pos.y -= d->lineHeightReduction * lineHeight_Text(d->baseFont);
     }
-    d->run.bounds.pos = addX_I2(d->pos, origin + d->indent);
     const iInt2 dims = init_I2(advance, lineHeight_Text(d->baseFont));
     iChangeFlags(d->run.flags, wide_GmRunFlag, (d->isPreformat && dims.x > d->layoutWidth));
-    d->run.bounds.size.x    = iMax(wrap->maxWidth, dims.x) - origin; /* Extends to the right edge for selection. */
-    d->run.bounds.size.y    = dims.y;
-    d->run.visBounds        = d->run.bounds;
-    d->run.visBounds.size.x = dims.x;
+    d->run.visBounds = (iRect){ addX_I2(d->pos, origin + d->indent), dims };
+    /* Extends to the right edge for selection. */
+    setBounds_GmRun_(&d->run, d->run.visBounds.pos.x, iMax(wrap->maxWidth, dims.x) - origin);
     d->run.isRTL            = attrib.isBaseRTL;
 //    printf("origin:%d isRTL:%d\n{%s}\n", origin, attrib.isBaseRTL, cstr_Rangecc(wrapRange));
     pushBack_Array(&d->layout, &d->run);
@@ -720,12 +767,273 @@ static iBool isHRule_(iRangecc line) {
     return n >= 3;
 }
 
-static void doLayout_GmDocument_(iGmDocument *d) {
+static void updateLinkStates_GmDocument_(iGmDocument *d) {
+    /* Links are kept between layouts, but their state may have changed since parsing.
+       Content flags are set again as the content is laid out. */
+    updateOpenURLs_GmDocument_(d);
+    iForEach(PtrArray, i, &d->links) {
+        iGmLink *link = i.ptr;
+        link->flags &= ~(visited_GmLinkFlag | isOpen_GmLinkFlag | content_GmLinkFlag |
+                         permanent_GmLinkFlag);
+        if (cmpString_String(&link->url, &d->url)) {
+            link->when = urlVisitTime_Visited(visited_App(), &link->url);
+            if (isValid_Time(&link->when)) {
+                link->flags |= visited_GmLinkFlag;
+            }
+            if (contains_StringSet(d->openURLs, &link->url)) {
+                link->flags |= isOpen_GmLinkFlag;
+            }
+        }
+    }
+}
+
+static void parse_GmDocument_(iGmDocument *d) {
     static iRegExp *ansiPattern_;
     if (!ansiPattern_) {
         ansiPattern_ = makeAnsiEscapePattern_Text(iTrue /* with ESC */);
     }
+    const iPrefs *prefs        = prefs_App();
+    const iBool   isGopher     = isGopher_GmDocument_(d);
+    const iBool   isNormalized = shouldBeNormalized_GmDocument_(d);
+    d->flags.isParseInvalidated = iFalse;
+    d->flags.isParsedNormalized = isNormalized;
+    clear_Array(&d->lines);
+    clearLinks_GmDocument_(d);
+    clear_Array(&d->headings);
+    const iArray *oldPreMeta = collect_Array(copy_Array(&d->preMeta)); /* remember fold states */
+    clear_Array(&d->preMeta);
+    clear_String(&d->title);
+    if (isEmpty_String(&d->source)) {
+        return;
+    }
+    updateOpenURLs_GmDocument_(d);
+    const iRangecc content     = range_String(&d->source);
+    iRangecc       contentLine = iNullRange;
+    iBool          isPreformat = (d->format == plainText_SourceFormat);
+    uint16_t       preId       = 0;
+    iString        firstContentLine; /* may be used as a title if one isn't specified */
+    init_String(&firstContentLine);
+    while (nextSplit_Rangecc(content, "\n", &contentLine)) {
+        iRangecc line = contentLine;
+        if (*line.end == '\r') {
+            line.end--; /* trim CR always */
+        }
+        iGmLine ln = { .linkId = 0 };
+        enum iGmLineType type;
+        if (d->flags.isNex) {
+            type = lineType_GmDocument_(d, line);
+            if (type == link_GmLineType) {
+                line = addLink_GmDocument_(d, line, &ln.linkId);
+                if (!ln.linkId) {
+                    /* Invalid formatting. */
+                    type = text_GmLineType;
+                }
+            }
+        }
+        else if (!isPreformat) {
+            type = lineType_GmDocument_(d, line);
+            if (d->origFormat == markdown_SourceFormat && isHRule_(line)) {
+                ln.flags |= hRule_GmLineFlag;
+            }
+            else if (type == preformatted_GmLineType) {
+                /* Begin a new preformatted block. */
+                isPreformat = iTrue;
+                const size_t preIndex = preId++;
+                iGmPreMeta meta = { .bounds = line };
+                findPreformattedBlock_GmDocument_(d, line.start, &meta.contents, &meta.bounds.end);
+                trimLine_Rangecc(&line, type, isNormalized);
+                meta.altText = line; /* without the ``` */
+                /* Reuse previous state. */
+                if (preIndex < size_Array(oldPreMeta)) {
+                    meta.flags = constValue_Array(oldPreMeta, preIndex, iGmPreMeta).flags &
+                                 folded_GmPreMetaFlag;
+                }
+                else if (prefs->collapsePre >= byDefault_Collapse && !isGopher) {
+                    meta.flags |= folded_GmPreMetaFlag;
+                }
+                pushBack_Array(&d->preMeta, &meta);
+                ln.flags |= preBegin_GmLineFlag;
+                ln.preId = preId;
+            }
+            else {
+                if (type == link_GmLineType) {
+                    line = addLink_GmDocument_(d, line, &ln.linkId);
+                    if (!ln.linkId) {
+                        /* Invalid formatting. */
+                        type = text_GmLineType;
+                    }
+                }
+                trimLine_Rangecc(&line, type, isNormalized);
+                /* Remember headings for the document outline. */
+                if (type == heading1_GmLineType || type == heading2_GmLineType ||
+                    type == heading3_GmLineType) {
+                    pushBack_Array(
+                        &d->headings,
+                        &(iGmHeading){ .text = line, .level = type - heading1_GmLineType });
+                }
+            }
+        }
+        else {
+            type = preformatted_GmLineType;
+            ln.preId = preId;
+            if (d->format == gemini_SourceFormat &&
+                startsWithSc_Rangecc(line, "```", &iCaseSensitive)) {
+                isPreformat = iFalse;
+                ln.flags |= preEnd_GmLineFlag;
+            }
+            else {
+                ln.flags |= preformat_GmLineFlag;
+            }
+        }
+        ln.type = type;
+        ln.text = line;
+        pushBack_Array(&d->lines, &ln);
+        /* Save the document title (first high-level heading). */
+        if (ln.flags & (hRule_GmLineFlag | preBegin_GmLineFlag | preEnd_GmLineFlag) ||
+            isEmpty_Range(&line)) {
+            continue;
+        }
+        if (type == heading1_GmLineType && isEmpty_String(&d->title)) {
+            setRange_String(&d->title, line);
+            /* Get rid of ANSI escapes. */
+            replaceRegExp_String(&d->title, ansiPattern_, "", NULL, NULL);
+        }
+        else if (type != preformatted_GmLineType && type != heading1_GmLineType &&
+                 isEmpty_String(&firstContentLine) && size_Range(&line) >= 3) {
+            setRange_String(&firstContentLine, line);
+            replaceRegExp_String(&firstContentLine, ansiPattern_, "", NULL, NULL);
+        }
+    }
+    /* If a title wasn't found, use the first content line but truncate it if it's long. */
+    if (isEmpty_String(&d->title)) {
+        set_String(&d->title, &firstContentLine);
+        if (length_String(&d->title) > 40) {
+            truncate_String(&d->title, 40);
+            /* Find a word boundary. */
+            while (size_String(&d->title) > 10 && isAlpha_Char(last_String(&d->title))) {
+                removeEnd_String(&d->title, 1);
+            }
+        }
+        trim_String(&d->title);
+    }
+    deinit_String(&firstContentLine);
+}
+
+static void beginLayout_GmDocument_(iGmDocument *d) {
+    const iPrefs *prefs = prefs_App();
+    initTheme_GmDocument_(d);
+    d->flags.isLayoutInvalidated = iFalse;
+    if (d->flags.isParseInvalidated ||
+        d->flags.isParsedNormalized != shouldBeNormalized_GmDocument_(d)) {
+        parse_GmDocument_(d);
+    }
+    else {
+        updateLinkStates_GmDocument_(d);
+    }
+    clear_Array(&d->layout);
+    clear_Array(&d->runIndex);
+    clear_StringArray(&d->auxText);
+    d->contentWidth = 0;
+    iGmLayoutState *state = &d->layoutState;
+    iZap(*state);
+    if (d->size.x <= 0 || isEmpty_Array(&d->lines)) {
+        state->lineIndex = size_Array(&d->lines); /* nothing to lay out */
+        return;
+    }
+    state->isFirstText      = prefs->bigFirstParagraph && !isForcedMonospace_GmDocument_(d) &&
+                              !isTerminal_Platform();
+    state->addQuoteIcon     = prefs->quoteIcon;
+    state->preFont          = preformatted_FontId;
+    state->prevType         = text_GmLineType;
+    state->prevNonBlankType = undefined_GmLineType;
+    if (isGopher_GmDocument_(d) && !prefs->geminiStyledGopher) {
+        state->isFirstText = iFalse;
+    }
+    if (d->format == plainText_SourceFormat) {
+        state->isFirstText = iFalse;
+    }
+    d->warnings &= ~missingGlyphs_GmDocumentWarning;
+}
+
+static void markWidePreformatted_GmDocument_(iGmDocument *d, size_t firstRun) {
+    /* Go over the preformatted blocks starting from `firstRun` and mark them wide if at least
+       one run is wide. A block that was continued in this batch is checked as a whole. */
+    if (firstRun > 0 && firstRun <= size_Array(&d->layout)) {
+        const uint32_t preId = preId_GmRun(constAt_Array(&d->layout, firstRun - 1));
+        while (preId && firstRun > 0 &&
+               preId_GmRun(constAt_Array(&d->layout, firstRun - 1)) == preId) {
+            firstRun--;
+        }
+    }
+    for (size_t pos = firstRun; pos < size_Array(&d->layout); pos++) {
+        iGmRun *run = at_Array(&d->layout, pos);
+        if (preId_GmRun(run) && run->flags & wide_GmRunFlag) {
+            iGmPreMeta *meta = at_Array(&d->preMeta, preId_GmRun(run) - 1);
+            meta->runRange = findPreformattedRange_GmDocument(d, run);
+            for (const iGmRun *j = meta->runRange.start; j != meta->runRange.end; j++) {
+                iGmRun *jRun = iConstCast(iGmRun *, j);
+                jRun->flags |= wide_GmRunFlag;
+                iChangeFlags(jRun->flags, startOfLine_GmRunFlag, j == meta->runRange.start);
+                iChangeFlags(jRun->flags, endOfLine_GmRunFlag, j + 1 == meta->runRange.end);
+            }
+            /* Skip to the end of the block. */
+            pos = meta->runRange.end - (const iGmRun *) constData_Array(&d->layout) - 1;
+        }
+    }
+}
 
+static void updateRunIndex_GmDocument_(iGmDocument *d) {
+    /* Runs are laid out from top to bottom, so the maximum bottom coordinate is ascending
+       and can be searched. Runs in a partial block at the end are not indexed. */
+    const size_t numBlocks = size_Array(&d->layout) / runIndexBlockSize_GmDocument_;
+    int maxBottom =
+        isEmpty_Array(&d->runIndex) ? INT_MIN : *(const int *) constBack_Array(&d->runIndex);
+    for (size_t block = size_Array(&d->runIndex); block < numBlocks; block++) {
+        const iGmRun *run = constAt_Array(&d->layout, block * runIndexBlockSize_GmDocument_);
+        for (size_t i = 0; i < runIndexBlockSize_GmDocument_; i++, run++) {
+            maxBottom = iMax(maxBottom, bottom_Rect(run->visBounds));
+        }
+        pushBack_Array(&d->runIndex, &maxBottom);
+    }
+}
+
+static size_t firstRunIndexAt_GmDocument_(const iGmDocument *d, int y) {
+    /* Finds the first run whose visual bottom is at or below `y`. All runs before it are
+       above `y`. */
+    size_t lo = 0;
+    size_t hi = size_Array(&d->runIndex);
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (*(const int *) constAt_Array(&d->runIndex, mid) >= y) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+    /* It is in block `lo`, or in the unindexed runs at the end. */
+    const size_t numRuns = size_Array(&d->layout);
+    for (size_t i = lo * runIndexBlockSize_GmDocument_; i < numRuns; i++) {
+        const iGmRun *run = constAt_Array(&d->layout, i);
+        if (bottom_Rect(run->visBounds) >= y) {
+            return i;
+        }
+    }
+    return numRuns;
+}
+
+static iBool isLayoutComplete_GmDocument_(const iGmDocument *d) {
+    return d->layoutState.lineIndex >= size_Array(&d->lines);
+}
+
+static iBool layoutLines_GmDocument_(iGmDocument *d, size_t minLines, int untilY,
+                                     const char *untilLoc) {
+    /* Lays out at least `minLines` lines, and continues until reaching `untilY` or the line
+       containing `untilLoc`. Returns True if any lines were laid out. */
+    if (isLayoutComplete_GmDocument_(d)) {
+        return iFalse;
+    }
+    const size_t  firstNewRun       = size_Array(&d->layout);
     const iPrefs *prefs             = prefs_App();
     const iBool   isMono            = isForcedMonospace_GmDocument_(d);
     const iBool   isGopher          = isGopher_GmDocument_(d);
@@ -734,8 +1042,6 @@ static void doLayout_GmDocument_(iGmDocument *d) {
     const iBool   isExtremelyNarrow = d->size.x <= 60 * gap_Text * aspect_UI;
     const iBool   isFullWidthImages = (d->outsideMargin < 5 * gap_UI * aspect_UI);
 
-    initTheme_GmDocument_(d);
-    d->flags.isLayoutInvalidated = iFalse;
     /* TODO: Collect these parameters into a GmTheme. */
     float indents[max_GmLineType] = { 5, 10, 5, isNarrow ? 5 : 10, 0, 0, 5, 5 };
     if (isExtremelyNarrow) {
@@ -769,147 +1075,86 @@ static void doLayout_GmDocument_(iGmDocument *d) {
     static const char *pointingFinger  = "\U0001f449";
     static const char *uploadArrow     = upload_Icon;
     static const char *image           = photo_Icon;
-    clear_Array(&d->layout);
-    clear_StringArray(&d->auxText);
-    clearLinks_GmDocument_(d);
-    clear_Array(&d->headings);
-    const iArray *oldPreMeta = collect_Array(copy_Array(&d->preMeta)); /* remember fold states */
-    clear_Array(&d->preMeta);
-    clear_String(&d->title);
-    d->contentWidth = 0;
-    if (d->size.x <= 0 || isEmpty_String(&d->source)) {
-        return;
-    }
-    updateOpenURLs_GmDocument_(d);
-    const iRangecc   content       = range_String(&d->source);
-    iRangecc         contentLine   = iNullRange;
-    iInt2            pos           = zero_I2();
-    iBool            isFirstText   = prefs->bigFirstParagraph && !isMono && !isTerminal_Platform();
-    iBool            addQuoteIcon  = prefs->quoteIcon;
+    iGmLayoutState  *state         = &d->layoutState;
+    const size_t     numLines      = size_Array(&d->lines);
+    const size_t     batchEnd      = state->lineIndex + iMin(minLines, numLines - state->lineIndex);
+    iInt2            pos           = state->pos;
+    iBool            isFirstText   = state->isFirstText;
+    iBool            addQuoteIcon  = state->addQuoteIcon;
     iBool            isPreformat   = iFalse;
-    int              preFont       = preformatted_FontId;
-    uint16_t         preId         = 0;
-    iBool            enableIndents = iFalse;
-    const iBool      isNormalized  = shouldBeNormalized_GmDocument_(d);
+    int              preFont       = state->preFont;
+    uint16_t         foldedPreId   = state->foldedPreId;
+    iBool            enableIndents = state->enableIndents;
     const iBool      isJustified   = prefs->justifyParagraph;
-    enum iGmLineType prevType      = text_GmLineType;
-    enum iGmLineType prevNonBlankType = undefined_GmLineType;
-    iBool            followsBlank  = iFalse;
-    iString          firstContentLine; /* may be used as a title if one isn't specified */
-    init_String(&firstContentLine);
-    if (isGopher && !prefs->geminiStyledGopher) {
-        isFirstText = iFalse;
-    }
-    if (d->format == plainText_SourceFormat) {
-        isPreformat = iTrue;
-        isFirstText = iFalse;
-    }
-    d->warnings &= ~missingGlyphs_GmDocumentWarning;
+    enum iGmLineType prevType      = state->prevType;
+    enum iGmLineType prevNonBlankType = state->prevNonBlankType;
+    iBool            followsBlank  = state->followsBlank;
+    size_t           lineIndex;
     checkMissing_Text(); /* clear the flag */
     setAnsiFlags_Text(d->theme.ansiEscapes);
-    while (nextSplit_Rangecc(content, "\n", &contentLine)) {
-        iRangecc line = contentLine; /* `line` will be trimmed; modifying would confuse `nextSplit_Rangecc` */
-        if (*line.end == '\r') {
-            line.end--; /* trim CR always */
+    for (lineIndex = state->lineIndex;
+         lineIndex < numLines &&
+         (lineIndex < batchEnd || pos.y < untilY ||
+          (untilLoc && ((const iGmLine *) constAt_Array(&d->lines, lineIndex))->text.start <= untilLoc));
+         lineIndex++) {
+        const iGmLine   *ln     = constAt_Array(&d->lines, lineIndex);
+        iRangecc         line   = ln->text;
+        enum iGmLineType type   = ln->type;
+        iGmRun           run    = { .color = white_ColorId };
+        float            indent = 0.0f;
+        const uint16_t   preId  = ln->preId;
+        if (foldedPreId && preId == foldedPreId) {
+            continue; /* Skip the rest of a folded block. */
+        }
+        isPreformat = (ln->flags & preformat_GmLineFlag) != 0;
+        if (ln->flags & preEnd_GmLineFlag) {
+            continue;
         }
-        iGmRun run = { .color = white_ColorId };
-        enum iGmLineType type;
-        float indent = 0.0f;
-        /* Detect the type of the line. */
         if (d->flags.isNex) {
-            type = lineType_GmDocument_(d, line);
-            if (type == link_GmLineType) {
-                iGmLinkId linkId = 0;
-                line = addLink_GmDocument_(d, line, &linkId);
-                run.linkId = linkId;
-                if (!run.linkId) {
-                    /* Invalid formatting. */
-                    type = text_GmLineType;
-                }
-            }
+            run.linkId = ln->linkId;
             run.font = d->theme.fonts[type];
             if (type == link_GmLineType) {
                 indent = (float) measure_Text(run.font, "=> ").advance.x / (float) gap_Text;
             }
         }
         else if (!isPreformat) {
-            type = lineType_GmDocument_(d, line);
-            if (d->origFormat == markdown_SourceFormat) {
-                if (isHRule_(line)) {
-                    iGmRun hrule = run;
-                    const int leftIndent = (isVeryNarrow ? 0 : 5) * gap_Text;
-                    const int rightIndent = leftIndent + (isJustified ? -1 : 0) * gap_Text;
-                    hrule.visBounds.pos  = add_I2(pos, init_I2(leftIndent, gap_Text * aspect_UI));
-                    hrule.visBounds.size = init_I2(d->size.x - leftIndent - rightIndent, 0);
-                    hrule.bounds         = zero_Rect(); /* just visual */
-                    hrule.text           = iNullRange;
-                    hrule.flags          = ruler_GmRunFlag | decoration_GmRunFlag;
-                    pushBack_Array(&d->layout, &hrule);
-                    pos.y += gap_Text * (1 + aspect_UI);
-                    continue;
-                }
+            if (ln->flags & hRule_GmLineFlag) {
+                iGmRun hrule = run;
+                const int leftIndent = (isVeryNarrow ? 0 : 5) * gap_Text;
+                const int rightIndent = leftIndent + (isJustified ? -1 : 0) * gap_Text;
+                hrule.visBounds.pos  = add_I2(pos, init_I2(leftIndent, gap_Text * aspect_UI));
+                hrule.visBounds.size = init_I2(d->size.x - leftIndent - rightIndent, 0);
+                clearBounds_GmRun_(&hrule); /* just visual */
+                hrule.text           = iNullRange;
+                hrule.flags          = ruler_GmRunFlag | decoration_GmRunFlag;
+                pushBack_Array(&d->layout, &hrule);
+                pos.y += gap_Text * (1 + aspect_UI);
+                continue;
             }
-            if (contentLine.start == content.start) {
+            if (lineIndex == 0) {
                 prevType = type;
             }
             indent = indents[type];
-            if (type == preformatted_GmLineType) {
-                /* Begin a new preformatted block. */
-                isPreformat = iTrue;
-                const size_t preIndex = preId++;
+            if (ln->flags & preBegin_GmLineFlag) {
+                /* Begin a new preformatted block. The previous layout of the block is
+                   discarded. */
                 preFont = preformatted_FontId;
-                /* Use a smaller font if the block contents are wide. */
-                iGmPreMeta meta = { .bounds = line };
-                meta.pixelRect.size = measurePreformattedBlock_GmDocument_(
-                    d, line.start, preFont, &meta.contents, &meta.bounds.end);
-                /*
-                int overrun = meta.pixelRect.size.x - d->size.x;
-                if (prevNonBlankType == undefined_GmLineType && overrun > 0) {
-                    meta.initialOffset = iMin(overrun / 2, d->outsideMargin - 5 * gap_UI);
-                }
-                */
-                trimLine_Rangecc(&line, type, isNormalized);
-                meta.altText = line; /* without the ``` */
-                /* Reuse previous state. */
-                if (preIndex < size_Array(oldPreMeta)) {
-                    meta.flags = constValue_Array(oldPreMeta, preIndex, iGmPreMeta).flags &
-                                 folded_GmPreMetaFlag;
-                }
-                else if (prefs->collapsePre >= byDefault_Collapse && !isGopher) {
-                    meta.flags |= folded_GmPreMetaFlag;
-                }
-                pushBack_Array(&d->preMeta, &meta);
+                iGmPreMeta *meta = at_Array(&d->preMeta, preId - 1);
+                meta->flags &= folded_GmPreMetaFlag;
+                meta->runRange = (iGmRunRange){ NULL, NULL };
+                meta->initialOffset = 0;
+                meta->pixelRect = (iRect){ zero_I2(),
+                                           measureRange_Text(preFont, meta->contents).bounds.size };
                 continue;
             }
-            else if (type == link_GmLineType) {
-                iGmLinkId linkId = 0;
-                line = addLink_GmDocument_(d, line, &linkId);
-                run.linkId = linkId;
-                if (!run.linkId) {
-                    /* Invalid formatting. */
-                    type = text_GmLineType;
-                }
-            }
-            trimLine_Rangecc(&line, type, isNormalized);
+            run.linkId = ln->linkId;
             run.font = d->theme.fonts[type];
-            /* Remember headings for the document outline. */
-            if (type == heading1_GmLineType || type == heading2_GmLineType || type == heading3_GmLineType) {
-                pushBack_Array(
-                    &d->headings,
-                    &(iGmHeading){ .text = line, .level = type - heading1_GmLineType });
-            }
         }
         else {
             /* Preformatted line. */
-            type = preformatted_GmLineType;
-            if (contentLine.start == content.start) {
+            if (lineIndex == 0) {
                 prevType = type;
             }
-            if (d->format == gemini_SourceFormat &&
-                startsWithSc_Rangecc(line, "```", &iCaseSensitive)) {
-                isPreformat = iFalse;
-                continue;
-            }
             run.mediaType = max_MediaType; /* preformatted block */
             run.mediaId = preId;
             run.font = (d->format == plainText_SourceFormat ? plainText_FontId : preFont);
@@ -919,8 +1164,8 @@ static void doLayout_GmDocument_(iGmDocument *d) {
         if (isEmpty_Range(&line)) {
             if (type == preformatted_GmLineType) {
                 /* Empty lines in a preformatted blocks should functionally be part of the block. */
-                run.bounds = (iRect){ pos, init_I2(1, lineHeight_Text(run.font)) };
-                run.visBounds = run.bounds;
+                run.visBounds = (iRect){ pos, init_I2(1, lineHeight_Text(run.font)) };
+                setBounds_GmRun_(&run, pos.x, 1);
                 run.text = line;
                 pushBack_Array(&d->layout, &run);
             }
@@ -928,7 +1173,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                 /* For quote indicators we still need to produce a run. */
                 run.visBounds.pos  = addX_I2(pos, indents[type] * gap_Text);
                 run.visBounds.size = init_I2(gap_Text, lineHeight_Text(run.font));
-                run.bounds         = zero_Rect(); /* just visual */
+                clearBounds_GmRun_(&run); /* just visual */
                 run.text           = iNullRange;
                 run.flags          = ruler_GmRunFlag | decoration_GmRunFlag;
                 pushBack_Array(&d->layout, &run);
@@ -986,29 +1231,18 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                                              : meta->altText;
                 iInt2 size = measureWrapRange_Text(altText.font, d->size.x - 2 * margin.x,
                                                    altText.text).bounds.size;
-                altText.bounds = altText.visBounds = init_Rect(pos.x, pos.y, d->size.x,
-                                                               size.y + 2 * margin.y);
+                altText.visBounds  = init_Rect(pos.x, pos.y, d->size.x, size.y + 2 * margin.y);
+                setBounds_GmRun_(&altText, pos.x, d->size.x);
                 altText.mediaType = max_MediaType; /* preformatted */
                 altText.mediaId = preId;
                 pushBack_Array(&d->layout, &altText);
-                pos.y += height_Rect(altText.bounds);
-                contentLine = meta->bounds; /* Skip the whole thing. */
+                pos.y += height_Rect(altText.visBounds);
+                foldedPreId = preId; /* Skip the whole thing. */
                 isPreformat = iFalse;
                 prevType = preformatted_GmLineType;
                 continue;
             }
         }
-        /* Save the document title (first high-level heading). */
-        if (type == heading1_GmLineType && isEmpty_String(&d->title)) {
-            setRange_String(&d->title, line);
-            /* Get rid of ANSI escapes. */
-            replaceRegExp_String(&d->title, ansiPattern_, "", NULL, NULL);
-        }
-        else if (type != preformatted_GmLineType && type != heading1_GmLineType &&
-                 isEmpty_String(&firstContentLine) && size_Range(&line) >= 3) {
-            setRange_String(&firstContentLine, line);
-            replaceRegExp_String(&firstContentLine, ansiPattern_, "", NULL, NULL);
-        }
         /* List bullet. */
         if (type == bullet_GmLineType) {
             /* TODO: Literata bullet is broken? */
@@ -1020,7 +1254,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                 init_I2((indents[bullet_GmLineType] - indents[text_GmLineType]) * gap_Text,
                         lineHeight_Text(bulRun.font));
             //            bulRun.visBounds.pos.x -= 4 * gap_Text - width_Rect(bulRun.visBounds) / 2;
-            bulRun.bounds = zero_Rect(); /* just visual */
+            clearBounds_GmRun_(&bulRun); /* just visual */
             bulRun.text   = range_CStr(bullet);
             bulRun.flags |= decoration_GmRunFlag;
             alignDecoration_GmRun_(&bulRun, iTrue);
@@ -1041,7 +1275,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                                !isTerminal_Platform()
                                    ? (lineHeight_Text(quote_FontId) / 2 - bottom_Rect(vis))
                                    : 0));
-            quoteRun.bounds = zero_Rect(); /* just visual */
+            clearBounds_GmRun_(&quoteRun); /* just visual */
             quoteRun.flags |= decoration_GmRunFlag;
             if (isTerminal_Platform()) {
                 quoteRun.font = paragraph_FontId;
@@ -1056,7 +1290,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
             iGmRun icon = run;
             icon.visBounds.pos  = pos;
             icon.visBounds.size = init_I2(indent * gap_Text, lineHeight_Text(run.font));
-            icon.bounds         = zero_Rect(); /* just visual */
+            clearBounds_GmRun_(&icon); /* just visual */
             iGmLink *link = at_PtrArray(&d->links, run.linkId - 1);
             const enum iGmLinkScheme scheme = scheme_GmLinkFlag(link->flags);
             icon.text           = range_CStr(link->flags & query_GmLinkFlag    ? (d->flags.isSpartan ? upload_Icon : magnifyingGlass)
@@ -1098,7 +1332,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                 /* Nex directory link "icons" are actually the => arrows that appear in
                    the source text. */
                 icon.visBounds.size.x = indent * gap_Text; // measureRange_Text(icon.font, icon.text).bounds.size;
-                icon.bounds = icon.visBounds;
+                setBounds_GmRun_(&icon, icon.visBounds.pos.x, icon.visBounds.size.x);
                 //icon.flags &= ~decoration_GmRunFlag;
                 //icon.linkId = run.linkId;
             }
@@ -1183,7 +1417,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                 rts.baseColor = rts.run.color;
                 iWrapText wrapText = { .text     = line,
                                        .maxWidth = rts.isWordWrapped
-                                                       ? d->size.x - run.bounds.pos.x -
+                                                       ? d->size.x - run.boundsLeft -
                                                              rts.indent - rts.rightMargin
                                                        : 0 /* unlimited */,
                                        .mode     = word_WrapTextMode,
@@ -1196,7 +1430,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                         iForEach(Array, pr, &rts.layout) {
                             iGmRun *prun = pr.value;
                             const int offset = rts.rightMargin - rts.indent;
-                            prun->bounds.pos.x    += offset;
+                            prun->boundsLeft      += offset;
                             prun->visBounds.pos.x += offset;
                         }
                         if (type == bullet_GmLineType || type == link_GmLineType ||
@@ -1235,9 +1469,9 @@ static void doLayout_GmDocument_(iGmDocument *d) {
             if (!isEmpty_Range(&link->labelRange)) {
                 const iGmRun *lastRun = constBack_Array(&d->layout);
                 iGmRun label      = *lastRun;
-                label.bounds.pos  = topRight_Rect(lastRun->visBounds);
-                label.bounds.size = measureRange_Text(run.font, link->labelRange).bounds.size;
-                label.visBounds   = label.bounds;
+                label.visBounds   = (iRect){ topRight_Rect(lastRun->visBounds),
+                                             measureRange_Text(run.font, link->labelRange).bounds.size };
+                setBounds_GmRun_(&label, label.visBounds.pos.x, label.visBounds.size.x);
                 label.text        = link->labelRange;
                 label.lineType    = text_GmLineType;
                 label.linkId      = 0;
@@ -1271,24 +1505,21 @@ static void doLayout_GmDocument_(iGmDocument *d) {
             const int margin = lineHeight_Text(paragraph_FontId) / 2;
             if (media.type) {
                 pos.y += margin;
-                run.bounds.size.y = 0;
                 linkContentWasLaidOut_GmDocument_(d, &info, run.linkId);
             }
             switch (media.type) {
                 case image_MediaType: {
                     const iInt2 imgSize = imageSize_Media(d->media, media);
-                    run.bounds.pos = pos;
-                    run.bounds.size.x = d->size.x;
                     const float aspect = (float) imgSize.y / (float) imgSize.x;
-                    run.bounds.size.y = d->size.x * aspect;
+                    iRect bounds = { pos, init_I2(d->size.x, d->size.x * aspect) };
                     /* Extend the image to full width, including outside margin, if the viewport
                        is narrow enough. */
                     if (isFullWidthImages) {
-                        run.bounds.size.x += d->outsideMargin * 2;
-                        run.bounds.size.y += d->outsideMargin * 2 * aspect;
-                        run.bounds.pos.x  -= d->outsideMargin;
+                        bounds.size.x += d->outsideMargin * 2;
+                        bounds.size.y += d->outsideMargin * 2 * aspect;
+                        bounds.pos.x  -= d->outsideMargin;
                     }
-                    run.visBounds = run.bounds;
+                    run.visBounds = bounds;
                     /// XXX: Don't use window pixel ratio, use the UI scaling factor on Window.s
                     const iInt2 maxSize = mulf_I2(
                         imgSize,
@@ -1298,11 +1529,11 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                         run.visBounds.size.y =
                             run.visBounds.size.y * maxSize.x / width_Rect(run.visBounds);
                         run.visBounds.size.x = maxSize.x;
-                        run.visBounds.pos.x  = run.bounds.size.x / 2 - width_Rect(run.visBounds) / 2;
-                        run.bounds.size.y    = run.visBounds.size.y;
+                        run.visBounds.pos.x  = bounds.size.x / 2 - width_Rect(run.visBounds) / 2;
                     }
+                    setBounds_GmRun_(&run, bounds.pos.x, bounds.size.x);
                     pushBack_Array(&d->layout, &run);
-                    pos.y += run.bounds.size.y + margin / 2;
+                    pos.y += run.visBounds.size.y + margin / 2;
                     /* Image metadata caption. */ {
                         run.font = FONT_ID(documentBody_FontId, semiBold_FontStyle, contentSmall_FontSize);
                         run.color = tmQuoteIcon_ColorId;
@@ -1311,7 +1542,7 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                         run.mediaType = 0;
                         run.visBounds.pos.y = pos.y;
                         run.visBounds.size.y = lineHeight_Text(run.font);
-                        run.bounds = zero_Rect();
+                        clearBounds_GmRun_(&run);
                         iString caption;
                         init_String(&caption);
                         const iBool inMegabytes = info.numBytes >= 1000000;
@@ -1334,68 +1565,56 @@ static void doLayout_GmDocument_(iGmDocument *d) {
                     break;
                 }
                 case audio_MediaType: {
-                    run.bounds.pos    = pos;
-                    run.bounds.size.x = d->size.x;
-                    run.bounds.size.y = lineHeight_Text(uiContent_FontId) + 3 * gap_UI;
-                    run.visBounds     = run.bounds;
+                    run.visBounds = init_Rect(
+                        pos.x, pos.y, d->size.x, lineHeight_Text(uiContent_FontId) + 3 * gap_UI);
+                    setBounds_GmRun_(&run, pos.x, d->size.x);
                     pushBack_Array(&d->layout, &run);
+                    pos.y += height_Rect(run.visBounds) + margin;
                     break;
                 }
                 case download_MediaType: {
-                    run.bounds.pos    = pos;
-                    run.bounds.size.x = d->size.x;
-                    run.bounds.size.y = 2 * lineHeight_Text(uiContent_FontId) + 4 * gap_UI;
-                    run.visBounds     = run.bounds;
+                    run.visBounds = init_Rect(
+                        pos.x, pos.y, d->size.x, 2 * lineHeight_Text(uiContent_FontId) + 4 * gap_UI);
+                    setBounds_GmRun_(&run, pos.x, d->size.x);
                     pushBack_Array(&d->layout, &run);
+                    pos.y += height_Rect(run.visBounds) + margin;
                     break;
                 }
                 default:
                     break;
             }
-            if (media.type && run.bounds.size.y) {
-                pos.y += run.bounds.size.y + margin;
-            }
         }
         prevType = type;
         prevNonBlankType = type;
         followsBlank = iFalse;
     }
-    d->size.y = pos.y;
-    d->contentWidth += indents[text_GmLineType] * gap_Text; /* indent not included in run widths */
+    const iBool isProgress = (lineIndex != state->lineIndex);
+    state->lineIndex        = lineIndex;
+    state->pos              = pos;
+    state->isFirstText      = isFirstText;
+    state->addQuoteIcon     = addQuoteIcon;
+    state->preFont          = preFont;
+    state->foldedPreId      = foldedPreId;
+    state->enableIndents    = enableIndents;
+    state->prevType         = prevType;
+    state->prevNonBlankType = prevNonBlankType;
+    state->followsBlank     = followsBlank;
+    if (isLayoutComplete_GmDocument_(d)) {
+        d->size.y = pos.y;
+        d->contentWidth += indents[text_GmLineType] * gap_Text; /* indent not included in run widths */
+    }
+    else if (lineIndex > 0) {
+        /* Estimate the rest based on the average height of the lines laid out so far. */
+        d->size.y = pos.y + (int) ((double) pos.y / lineIndex * (numLines - lineIndex));
+    }
     if (checkMissing_Text()) {
         d->warnings |= missingGlyphs_GmDocumentWarning;
     }
-    /* Go over the preformatted blocks and mark them wide if at least one run is wide. */ {
-        iForEach(Array, i, &d->layout) {
-            iGmRun *run = i.value;
-            if (preId_GmRun(run) && run->flags & wide_GmRunFlag) {
-                iGmPreMeta *meta = at_Array(&d->preMeta, preId_GmRun(run) - 1);
-                meta->runRange = findPreformattedRange_GmDocument(d, run);
-                for (const iGmRun *j = meta->runRange.start; j != meta->runRange.end; j++) {
-                    iGmRun *jRun = iConstCast(iGmRun *, j);
-                    jRun->flags |= wide_GmRunFlag;
-                    iChangeFlags(jRun->flags, startOfLine_GmRunFlag, j == meta->runRange.start);
-                    iChangeFlags(jRun->flags, endOfLine_GmRunFlag, j + 1 == meta->runRange.end);
-                }
-                /* Skip to the end of the block. */
-                i.pos = meta->runRange.end - (const iGmRun *) constData_Array(&d->layout) - 1;
-            }
-        }
+    if (isProgress) {
+        markWidePreformatted_GmDocument_(d, firstNewRun);
+        updateRunIndex_GmDocument_(d);
     }
     setAnsiFlags_Text(allowAll_AnsiFlag);
-    /* If a title wasn't found, use the first content line but truncate it if it's long. */
-    if (isEmpty_String(&d->title)) {
-        set_String(&d->title, &firstContentLine);
-        if (length_String(&d->title) > 40) {
-            truncate_String(&d->title, 40);
-            /* Find a word boundary. */
-            while (size_String(&d->title) > 10 && isAlpha_Char(last_String(&d->title))) {
-                removeEnd_String(&d->title, 1);
-            }
-        }
-        trim_String(&d->title);
-    }
-    deinit_String(&firstContentLine);
 #if  0
     printf("[GmDocument] layout size: %zu runs (%zu bytes), layout width: %d, content width: %d\n",
            size_Array(&d->layout),
@@ -1403,6 +1622,18 @@ static void doLayout_GmDocument_(iGmDocument *d) {
            d->size.x,
            d->contentWidth);
 #endif
+    return isProgress;
+}
+
+static void doLayout_GmDocument_(iGmDocument *d) {
+    beginLayout_GmDocument_(d);
+    /* Very long documents are laid out progressively; the rest is done on demand. */
+    layoutLines_GmDocument_(d,
+                            size_Array(&d->lines) > 2 * layoutBatchSize_GmDocument_
+                                ? layoutBatchSize_GmDocument_
+                                : iInvalidSize,
+                            0,
+                            NULL);
 }
 
 void init_GmDocument(iGmDocument *d) {
@@ -1415,7 +1646,10 @@ void init_GmDocument(iGmDocument *d) {
     init_String(&d->localHost);
     d->outsideMargin = 0;
     d->size = zero_I2();
+    init_Array(&d->lines, sizeof(iGmLine));
     init_Array(&d->layout, sizeof(iGmRun));
+    iZap(d->layoutState);
+    init_Array(&d->runIndex, sizeof(int));
     init_StringArray(&d->auxText);
     init_PtrArray(&d->links);
     init_String(&d->title);
@@ -1431,6 +1665,8 @@ void init_GmDocument(iGmDocument *d) {
     d->flags.isSpartan = iFalse;
     d->flags.isNex = iFalse;
     d->flags.isLayoutInvalidated = iFalse;
+    d->flags.isParseInvalidated = iTrue;
+    d->flags.isParsedNormalized = iFalse;
     d->flags.isPaletteValid = iFalse;
 }
 
@@ -1443,7 +1679,9 @@ void deinit_GmDocument(iGmDocument *d) {
     deinit_Array(&d->preMeta);
     deinit_Array(&d->headings);
     deinit_StringArray(&d->auxText);
+    deinit_Array(&d->runIndex);
     deinit_Array(&d->layout);
+    deinit_Array(&d->lines);
     deinit_String(&d->localHost);
     deinit_String(&d->url);
     deinit_String(&d->source);
@@ -2171,6 +2409,16 @@ void invalidateLayout_GmDocument(iGmDocument *d) {
     d->flags.isLayoutInvalidated = iTrue;
 }
 
+iBool isLayoutComplete_GmDocument(const iGmDocument *d) {
+    return isLayoutComplete_GmDocument_(d);
+}
+
+iBool continueLayout_GmDocument(iGmDocument *d, int untilY, const char *untilLoc) {
+    /* Without a target, just lay out the next batch of lines. */
+    return layoutLines_GmDocument_(
+        d, untilY <= 0 && !untilLoc ? layoutBatchSize_GmDocument_ : 0, untilY, untilLoc);
+}
+
 static void markLinkRunsVisited_GmDocument_(iGmDocument *d, const iIntSet *linkIds) {
     iForEach(Array, r, &d->layout) {
         iGmRun *run = r.value;
@@ -2214,50 +2462,59 @@ iLocalDef iBool isNormalizableSpace_(char ch) {
     return ch == ' ' || ch == '\t';
 }
 
+static const char *skipAnsiCursorForward_(const char *ch, const char *end, int *count_out) {
+    /* Matches "\x1b[<n>C" and returns the position after it, or NULL. */
+    iAssert(*ch == 0x1b);
+    if (end - ch < 4 || ch[1] != '[' || ch[2] < '0' || ch[2] > '9') {
+        return NULL;
+    }
+    int count = 0;
+    for (ch += 2; ch != end && *ch >= '0' && *ch <= '9'; ch++) {
+        count = iMin(count * 10 + (*ch - '0'), 10000);
+    }
+    if (ch == end || *ch != 'C') {
+        return NULL;
+    }
+    *count_out = count;
+    return ch + 1;
+}
+
 static void normalize_GmDocument(iGmDocument *d) {
+    /* Unchanged spans of each line are copied as a whole. */
     iString *normalized = new_String();
+    iBlock *out = &normalized->chars;
     iRangecc src = range_String(&d->source);
-    /* Check for a BOM. In UTF-8, the BOM can just be skipped if present. */ {
-        iChar ch = 0;
-        decodeBytes_MultibyteChar(src.start, src.end, &ch);
-        if (ch == 0xfeff) /* zero-width non-breaking space */ {
-            src.start += 3;
-        }
-    }
     iRangecc line = iNullRange;
     iBool isPreformat = iFalse;
     if (d->format == plainText_SourceFormat) {
         isPreformat = iTrue; /* Cannot be turned off. */
     }
-    iBool wasNormalized = iFalse;
-    iRegExp *ansiCursorFwdPattern = new_RegExp("^\x1b\\[([0-9]+)C", 0);
     while (nextSplit_Rangecc(src, "\n", &line)) {
+        const char *span = line.start;
         if (isPreformat) {
             for (const char *ch = line.start; ch != line.end; ch++) {
-                if (*ch == 0x1b) {
+                if (*ch == '\v') {
+                    appendData_Block(out, span, ch - span);
+                    span = ch + 1;
+                }
+                else if (*ch == 0x1b) {
                     /* We can emulate an ANSI cursor forward sequence by adding spaces. */
-                    iRegExpMatch m;
-                    init_RegExpMatch(&m);
-                    if (matchRange_RegExp(ansiCursorFwdPattern, (iRangecc){ ch, line.end }, &m)) {
-                        int num = strtoul(capturedRange_RegExpMatch(&m, 1).start, NULL, 10);
+                    int num = 0;
+                    const char *seqEnd = skipAnsiCursorForward_(ch, line.end, &num);
+                    if (seqEnd) {
+                        appendData_Block(out, span, ch - span);
                         if (num > 0 && num < 200 /* arbitrary sanity limit */) {
                             for (int i = 0; i < num; i++) {
-                                appendData_Block(&normalized->chars, " ", 1);
+                                pushBack_Block(out, ' ');
                             }
                         }
-                        ch = end_RegExpMatch(&m) - 1;
-                        wasNormalized = iTrue;
-                        continue;
+                        ch = seqEnd - 1;
+                        span = seqEnd;
                     }
                 }
-                if (*ch != '\v') {
-                    appendCStrN_String(normalized, ch, 1);
-                }
-                else {
-                    wasNormalized = iTrue;
-                }
             }
-            appendCStr_String(normalized, "\n");
+            appendData_Block(out, span, line.end - span);
+            pushBack_Block(out, '\n');
             if (d->format == gemini_SourceFormat &&
                 lineType_GmDocument_(d, line) == preformatted_GmLineType) {
                 isPreformat = iFalse;
@@ -2266,47 +2523,44 @@ static void normalize_GmDocument(iGmDocument *d) {
         }
         if (lineType_GmDocument_(d, line) == preformatted_GmLineType) {
             isPreformat = iTrue;
-            appendRange_String(normalized, line);
-            appendCStr_String(normalized, "\n");
+            appendData_Block(out, line.start, size_Range(&line));
+            pushBack_Block(out, '\n');
             continue;
         }
         iBool isPrevSpace = iFalse;
         int spaceCount = 0;
         for (const char *ch = line.start; ch != line.end; ch++) {
-            char c = *ch;
-            if (c == '\v') {
-                wasNormalized = iTrue;
-                continue;
-            }
-            if (isNormalizableSpace_(c)) {
+            const char c = *ch;
+            if (c == '\v' || (isNormalizableSpace_(c) && (isPrevSpace || c != ' '))) {
+                /* This character is dropped or replaced. */
+                appendData_Block(out, span, ch - span);
+                span = ch + 1;
+                if (c == '\v') {
+                    continue;
+                }
                 if (isPrevSpace) {
                     if (++spaceCount == 8) {
                         /* There are several consecutive space characters. The author likely
                            really wants to have some space here, so normalize to a tab stop. */
-                        popBack_Block(&normalized->chars);
-                        pushBack_Block(&normalized->chars, '\t');
+                        popBack_Block(out);
+                        pushBack_Block(out, '\t');
                     }
-                    wasNormalized = iTrue;
                     continue; /* skip repeated spaces */
                 }
-                if (c != ' ') {
-                    c = ' ';
-                    wasNormalized = iTrue;
-                }
+                pushBack_Block(out, ' ');
+                isPrevSpace = iTrue;
+            }
+            else if (c == ' ') {
                 isPrevSpace = iTrue;
             }
             else {
                 isPrevSpace = iFalse;
                 spaceCount = 0;
             }
-            appendCStrN_String(normalized, &c, 1);
         }
-        appendCStr_String(normalized, "\n");
+        appendData_Block(out, span, line.end - span);
+        pushBack_Block(out, '\n');
     }
-    iUnused(wasNormalized);
-    iRelease(ansiCursorFwdPattern);
-//    printf("wasNormalized: %d\n", wasNormalized);
-//    fflush(stdout);
     set_String(&d->source, collect_String(normalized));
     //normalize_String(&d->source); /* NFC */
 //    printf("orig:%zu norm:%zu\n", size_String(&d->origSource), size_String(&d->source));
@@ -2320,7 +2574,7 @@ void setUrl_GmDocument(iGmDocument *d, const iString *url) {
     init_Url(&parts, url);
     setRange_String(&d->localHost, parts.host);
     updateIconBasedOnUrl_GmDocument_(d);
-    if (!cmp_String(url, "about:fonts")) {
+    if (!cmp_String(url, "about:fonts") || !cmp_String(url, "about:profiler")) {
         /* This is an interactive internal page. */
         d->flags.enableCommandLinks = iTrue;
     }
@@ -2329,6 +2583,7 @@ void setUrl_GmDocument(iGmDocument *d, const iString *url) {
                          (isEmpty_Range(&parts.path) || endsWith_Rangecc(parts.path, "/"));
     d->flags.isGopherMenu = equalCase_Rangecc(parts.scheme, "gopher") &&
                             startsWith_Rangecc(parts.path, "/1");
+    d->flags.isParseInvalidated = iTrue; /* links are relative to the URL */
 }
 
 iDeclareType(PendingLink)
@@ -2487,28 +2742,68 @@ static void convertMarkdownToGemtext_GmDocument_(iGmDocument *d) {
     d->format = gemini_SourceFormat;
 }
 
+static iBool isAnsiEscape_(const char *ch, const char *end) {
+    /* Equivalent to the pattern: \x1b[[()]([0-9;AB]*?)[ABCDEFGHJKSTfimn] */
+    iAssert(*ch == 0x1b);
+    if (++ch == end || (*ch != '[' && *ch != '(' && *ch != ')')) {
+        return iFalse;
+    }
+    for (ch++; ch != end; ch++) {
+        if (*ch && strchr("ABCDEFGHJKSTfimn", *ch)) {
+            return iTrue;
+        }
+        if ((*ch < '0' || *ch > '9') && *ch != ';') {
+            return iFalse;
+        }
+    }
+    return iFalse;
+}
+
+static void importSource_GmDocument_(iGmDocument *d) {
+    /* Copies the original source in a single pass: a UTF-8 BOM is skipped, CRLF is folded
+       to LF, null characters are removed, and ANSI escapes are detected. Spans that need no
+       changes are copied as a whole. The result is never longer than the original. */
+    const char *pos = constBegin_String(&d->origSource);
+    const char *end = constEnd_String(&d->origSource);
+    iBlock     *out = &d->source.chars;
+    iBool       hasAnsiEscapes = iFalse;
+    resize_Block(out, end - pos);
+    char *dst = data_Block(out);
+    if (end - pos >= 3 && !memcmp(pos, "\xef\xbb\xbf", 3)) {
+        pos += 3;
+    }
+    while (pos != end) {
+        const char *special = pos;
+        while (special != end && *special != '\r' && *special != 0 && *special != 0x1b) {
+            special++;
+        }
+        memcpy(dst, pos, special - pos);
+        dst += special - pos;
+        pos = special;
+        if (pos == end) {
+            break;
+        }
+        if (*pos == 0) {
+            pos++;
+            continue;
+        }
+        if (*pos == '\r' && pos + 1 != end && pos[1] == '\n') {
+            pos++; /* the newline is copied with the next span */
+            continue;
+        }
+        if (*pos == 0x1b && !hasAnsiEscapes) {
+            hasAnsiEscapes = isAnsiEscape_(pos, end);
+        }
+        *dst++ = *pos++;
+    }
+    truncate_Block(out, dst - (const char *) data_Block(out));
+    iChangeFlags(d->warnings, ansiEscapes_GmDocumentWarning, hasAnsiEscapes);
+}
+
 static void import_GmDocument_(iGmDocument *d) {
+    d->flags.isParseInvalidated = iTrue;
     d->format = d->origFormat;
-    set_String(&d->source, &d->origSource);
-    replace_String(&d->source, "\r\n", "\n");
-    /* Remove any null characters. */ {
-        const char *ch = constBegin_String(&d->source);
-        for (size_t pos = 0; pos < size_String(&d->source); pos++, ch++) {
-            if (*ch == 0) {
-                remove_Block(&d->source.chars, pos, 1);
-                pos--;
-                ch--;
-            }
-        }
-    }
-    /* Detect use of ANSI escapes. */ {
-        iRegExp *ansiEsc = new_RegExp("\x1b[[()]([0-9;AB]*?)[ABCDEFGHJKSTfimn]", 0);
-        iRegExpMatch m;
-        init_RegExpMatch(&m);
-        const iBool found = matchString_RegExp(ansiEsc, &d->origSource, &m);
-        iChangeFlags(d->warnings, ansiEscapes_GmDocumentWarning, found);
-        iRelease(ansiEsc);
-    }
+    importSource_GmDocument_(d);
     if (d->viewFormat == plainText_SourceFormat) {
         d->format = plainText_SourceFormat;
         d->theme.ansiEscapes = allowAll_AnsiFlag;
@@ -2586,21 +2881,15 @@ const iGmPreMeta *preMeta_GmDocument(const iGmDocument *d, uint16_t preId) {
 
 void render_GmDocument(const iGmDocument *d, iRangei visRangeY, iGmDocumentRenderFunc render,
                        void *context) {
-    iBool isInside = iFalse;
     setAnsiFlags_Text(d->theme.ansiEscapes);
-    /* TODO: Check lookup table for quick starting position. */
-    iConstForEach(Array, i, &d->layout) {
-        const iGmRun *run = i.value;
-        if (isInside) {
-            if (top_Rect(run->visBounds) > visRangeY.end) {
-                break;
-            }
-            render(context, run);
-        }
-        else if (bottom_Rect(run->visBounds) >= visRangeY.start) {
-            isInside = iTrue;
-            render(context, run);
+    const size_t numRuns = size_Array(&d->layout);
+    const size_t first   = firstRunIndexAt_GmDocument_(d, visRangeY.start);
+    for (size_t i = first; i < numRuns; i++) {
+        const iGmRun *run = constAt_Array(&d->layout, i);
+        if (i > first && top_Rect(run->visBounds) > visRangeY.end) {
+            break;
         }
+        render(context, run);
     }
     setAnsiFlags_Text(allowAll_AnsiFlag);
 }
@@ -2682,7 +2971,9 @@ iGmRunRange runRange_GmDocument(const iGmDocument *d) {
 size_t memorySize_GmDocument(const iGmDocument *d) {
     return size_String(&d->origSource) +
            size_String(&d->source) +
+           size_Array(&d->lines)  * sizeof(iGmLine) +
            size_Array(&d->layout) * sizeof(iGmRun) +
+           size_Array(&d->runIndex) * sizeof(int) +
            size_Array(&d->links)  * sizeof(iGmLink) +
            memorySize_Media(d->media);
 }
@@ -2737,25 +3028,34 @@ iGmRunRange findPreformattedRange_GmDocument(const iGmDocument *d, const iGmRun
 }
 
 const iGmRun *findRun_GmDocument(const iGmDocument *d, iInt2 pos) {
-    /* TODO: Perf optimization likely needed; use a block map? */
-    const iGmRun *last = NULL;
-    iBool isFirstNonDecoration = iTrue;
-    iConstForEach(Array, i, &d->layout) {
-        const iGmRun *run = i.value;
+    /* Runs ending above the point can be skipped, apart from the last non-decoration one. */
+    const size_t  first = firstRunIndexAt_GmDocument_(d, pos.y);
+    const iGmRun *last  = NULL;
+    for (size_t i = first; i-- > 0; ) {
+        const iGmRun *run = constAt_Array(&d->layout, i);
+        if (~run->flags & decoration_GmRunFlag) {
+            last = run;
+            break;
+        }
+    }
+    iBool isFirstNonDecoration = (last == NULL);
+    for (size_t i = first; i < size_Array(&d->layout); i++) {
+        const iGmRun *run = constAt_Array(&d->layout, i);
         if (run->flags & decoration_GmRunFlag) {
             continue;
         }
-        const iRangei span = ySpan_Rect(run->bounds);
+        const iRect   bounds = bounds_GmRun(run);
+        const iRangei span   = ySpan_Rect(bounds);
         if (contains_Range(&span, pos.y) &&
-            pos.x >= left_Rect(run->bounds) && pos.x < right_Rect(run->bounds)) {
+            pos.x >= left_Rect(bounds) && pos.x < right_Rect(bounds)) {
             last = run;
             break;
         }
-        if (isFirstNonDecoration && pos.y < top_Rect(run->bounds)) {
+        if (isFirstNonDecoration && pos.y < top_Rect(bounds)) {
             last = run;
             break;
         }
-        if (top_Rect(run->bounds) >= pos.y) {
+        if (top_Rect(bounds) >= pos.y) {
             break; /* Below the point. */
         }
         last = run;
@@ -2935,21 +3235,22 @@ iBool isJustified_GmRun(const iGmRun *d) {
 }
 
 int drawBoundWidth_GmRun(const iGmRun *d) {
-    return (d->isRTL ? -1 : 1) * width_Rect(isJustified_GmRun(d) ? d->bounds : d->visBounds);
+    return (d->isRTL ? -1 : 1) * width_Rect(isJustified_GmRun(d) ? bounds_GmRun(d) : d->visBounds);
 }
 
 iRangecc findLoc_GmRun(const iGmRun *d, iInt2 pos) {
-    if (pos.y < top_Rect(d->bounds)) {
+    const iRect bounds = bounds_GmRun(d);
+    if (pos.y < top_Rect(bounds)) {
         return (iRangecc){ d->text.start, d->text.start };
     }
-    if (pos.y > bottom_Rect(d->bounds)) {
+    if (pos.y > bottom_Rect(bounds)) {
         return (iRangecc){ d->text.end, d->text.end };
     }
-    const int x = pos.x - left_Rect(d->bounds);
+    const int x = pos.x - left_Rect(bounds);
     if (x <= 0) {
         return (iRangecc){ d->text.start, d->text.start };
     }
-    if (x > d->bounds.size.x) {
+    if (x > bounds.size.x) {
         return (iRangecc){ d->text.end, d->text.end };
     }
     iRangecc loc;
@@ -124,8 +124,9 @@ enum iGmRunFlags {
    a large number of GmRuns. */
 struct Impl_GmRun {
     iRangecc  text;
-    iRect     bounds;    /* used for hit testing, may extend to edges */
-    iRect     visBounds; /* actual visual bounds */
+    iRect     visBounds;   /* actual visual bounds */
+    int32_t   boundsLeft;  /* hit testing bounds may extend to the edges, but only */
+    int32_t   boundsWidth; /* horizontally; negative if none (see bounds_GmRun) */
     struct {
         uint32_t linkId    : 16; /* GmLinkId; zero for non-links */
         uint32_t flags     : 8; /* GmRunFlags */
@@ -147,6 +148,14 @@ struct Impl_GmRunRange {
     const iGmRun *end;
 };
 
+iLocalDef iRect bounds_GmRun(const iGmRun *d) {
+    /* Used for hit testing. Decorations have no bounds. */
+    if (d->boundsWidth < 0) {
+        return zero_Rect();
+    }
+    return (iRect){ init_I2(d->boundsLeft, d->visBounds.pos.y),
+                    init_I2(d->boundsWidth, d->visBounds.size.y) };
+}
 iLocalDef iBool isMedia_GmRun(const iGmRun *d) {
     return d->mediaType > 0 && d->mediaType < max_MediaType;
 }
@@ -206,6 +215,8 @@ void    setWidth_GmDocument     (iGmDocument *, int width, int canvasWidth);
 iBool   updateWidth_GmDocument  (iGmDocument *, int width, int canvasWidth);
 void    redoLayout_GmDocument   (iGmDocument *);
 void    invalidateLayout_GmDocument(iGmDocument *); /* will have to be redone later */
+iBool   isLayoutComplete_GmDocument(const iGmDocument *); /* long documents are laid out in parts */
+iBool   continueLayout_GmDocument(iGmDocument *, int untilY, const char *untilLoc); /* returns True if runs were added; may reallocate runs */
 int     contentWidth_GmDocument (const iGmDocument *); /* may exceed the layout width; unwrappable lines */
 iBool   updateOpenURLs_GmDocument(iGmDocument *);
 void    setUrl_GmDocument       (iGmDocument *, const iString *url);
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "mimehooks.h"
 #include "feeds.h"
 #include "bookmarks.h"
+#include "ui/profiler.h"
 #include "ui/text.h"
 #include "resources.h"
 #include "sitespec.h"
@@ -38,10 +39,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include <the_Foundation/fileinfo.h>
 #include <the_Foundation/mutex.h>
 #include <the_Foundation/path.h>
+#include <the_Foundation/ptrarray.h>
 #include <the_Foundation/regexp.h>
 #include <the_Foundation/socket.h>
 #include <the_Foundation/tlsrequest.h>
 
+#include <SDL_thread.h>
 #include <SDL_timer.h>
 
 iDefineTypeConstruction(GmResponse)
@@ -167,6 +170,16 @@ enum iGmRequestState {
     failure_GmRequestState,
 };
 
+enum iGmRequestScheduleState {
+    none_GmRequestScheduleState,
+    queued_GmRequestScheduleState,
+    active_GmRequestScheduleState,
+    unlimited_GmRequestScheduleState, /* running, but not counted against the limits */
+    released_GmRequestScheduleState,
+};
+
+typedef void (*iGmRequestBeginFunc)(iGmRequest *, const iString *host, uint16_t port);
+
 struct Impl_GmRequest {
     iObject              object;
     uint32_t             id;
@@ -188,12 +201,326 @@ struct Impl_GmRequest {
     iAudience *          updated;
     iAudience *          finished;
     iGmRequestProgressFunc sendProgress;
+    enum iGmRequestPriority priority;
+    enum iGmRequestScheduleState schedState;
+    iGmRequestBeginFunc  schedBegin;
+    iString              schedHost;
+    uint16_t             schedPort;
+    uint32_t             submittedAt; /* SDL ticks */
 };
 
 iDefineObjectConstructionArgs(GmRequest, (iGmCerts *certs), certs)
 iDefineAudienceGetter(GmRequest, updated)
 iDefineAudienceGetter(GmRequest, finished)
 
+/*----------------------------------------------------------------------------------------------*/
+
+/* All network requests go through the scheduler so that background work (feeds, remote
+   bookmarks) cannot starve the page being loaded. Each priority class has a per-host and
+   a total limit of concurrently active requests; zero means unlimited. Host slots are
+   counted separately for each class, so background requests never use up the slots of
+   foreground ones. Startable requests of higher classes are started first, and within a
+   class, requests are started in submission order, skipping hosts that are currently
+   saturated.
+
+   The limits are meant for page loads and inline images. Uploads are never counted, and a
+   request stops being counted once its response turns out to be something else (audio,
+   video, or a file to download), because such transfers may go on for a long time. */
+
+static const int maxPerHost_RequestScheduler_[max_GmRequestPriority] = { 2, 4, 6 };
+static const int maxTotal_RequestScheduler_[max_GmRequestPriority]   = { 4, 8, 0 };
+
+iDeclareType(RequestScheduler)
+iDeclareType(SchedulerHost)
+
+struct Impl_SchedulerHost {
+    iString  host;
+    uint16_t port;
+    int      numActive[max_GmRequestPriority];
+};
+
+struct Impl_RequestScheduler {
+    iMutex *  mtx;
+    iPtrArray queued[max_GmRequestPriority];
+    iArray    hosts; /* hosts with active requests */
+    int       numActive[max_GmRequestPriority];
+    int       numUnlimited[max_GmRequestPriority];
+    iBool     isDispatching;
+    SDL_threadID dispatchThread;
+    iGmRequest *beginning; /* begin func running without the lock; not released meanwhile */
+    iCondition  begun;
+    /* Statistics. */
+    size_t    numStarted[max_GmRequestPriority];
+    size_t    numFinished[max_GmRequestPriority];
+    size_t    maxQueued[max_GmRequestPriority];
+    uint64_t  totalWaitMs[max_GmRequestPriority];
+    uint32_t  maxWaitMs[max_GmRequestPriority];
+    uint64_t  totalDurationMs[max_GmRequestPriority];
+};
+
+static iRequestScheduler scheduler_;
+
+void init_RequestScheduler(void) {
+    iRequestScheduler *d = &scheduler_;
+    d->mtx = new_Mutex();
+    iForIndices(i, d->queued) {
+        init_PtrArray(&d->queued[i]);
+    }
+    init_Array(&d->hosts, sizeof(iSchedulerHost));
+    d->isDispatching = iFalse;
+    d->dispatchThread = 0;
+    d->beginning = NULL;
+    init_Condition(&d->begun);
+    iZap(d->numActive);
+    iZap(d->numUnlimited);
+    iZap(d->numStarted);
+    iZap(d->numFinished);
+    iZap(d->maxQueued);
+    iZap(d->totalWaitMs);
+    iZap(d->maxWaitMs);
+    iZap(d->totalDurationMs);
+}
+
+void deinit_RequestScheduler(void) {
+    iRequestScheduler *d = &scheduler_;
+    iForEach(Array, i, &d->hosts) {
+        deinit_String(&((iSchedulerHost *) i.value)->host);
+    }
+    deinit_Array(&d->hosts);
+    iForIndices(i, d->queued) {
+        deinit_PtrArray(&d->queued[i]);
+    }
+    deinit_Condition(&d->begun);
+    delete_Mutex(d->mtx);
+}
+
+static size_t findHost_RequestScheduler_(const iRequestScheduler *d, const iString *host,
+                                         uint16_t port) {
+    iConstForEach(Array, i, &d->hosts) {
+        const iSchedulerHost *sh = i.value;
+        if (sh->port == port && equalCase_String(&sh->host, host)) {
+            return index_ArrayConstIterator(&i);
+        }
+    }
+    return iInvalidPos;
+}
+
+static int numActiveForHost_RequestScheduler_(const iRequestScheduler *d, const iString *host,
+                                              uint16_t port, enum iGmRequestPriority priority) {
+    const size_t index = findHost_RequestScheduler_(d, host, port);
+    return index == iInvalidPos
+               ? 0
+               : ((const iSchedulerHost *) constAt_Array(&d->hosts, index))->numActive[priority];
+}
+
+static iBool isUnlimited_GmRequest_(const iGmRequest *d) {
+    return d->upload != NULL;
+}
+
+static iBool canStart_RequestScheduler_(const iRequestScheduler *d, const iGmRequest *req) {
+    if (isUnlimited_GmRequest_(req)) {
+        return iTrue;
+    }
+    const int maxTotal = maxTotal_RequestScheduler_[req->priority];
+    if (maxTotal && d->numActive[req->priority] >= maxTotal) {
+        return iFalse;
+    }
+    return numActiveForHost_RequestScheduler_(d, &req->schedHost, req->schedPort, req->priority) <
+           maxPerHost_RequestScheduler_[req->priority];
+}
+
+static iGmRequest *takeStartable_RequestScheduler_(iRequestScheduler *d) {
+    for (int prio = max_GmRequestPriority - 1; prio >= 0; prio--) {
+        iForEach(PtrArray, i, &d->queued[prio]) {
+            iGmRequest *req = i.ptr;
+            if (canStart_RequestScheduler_(d, req)) {
+                remove_PtrArrayIterator(&i);
+                return req;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void start_RequestScheduler_(iRequestScheduler *d, iGmRequest *req) {
+    const uint32_t waitMs = SDL_GetTicks() - req->submittedAt;
+    d->numStarted[req->priority]++;
+    d->totalWaitMs[req->priority] += waitMs;
+    d->maxWaitMs[req->priority] = iMax(d->maxWaitMs[req->priority], waitMs);
+    if (isUnlimited_GmRequest_(req)) {
+        d->numUnlimited[req->priority]++;
+        req->schedState = unlimited_GmRequestScheduleState;
+        return;
+    }
+    const size_t index = findHost_RequestScheduler_(d, &req->schedHost, req->schedPort);
+    if (index == iInvalidPos) {
+        iSchedulerHost sh;
+        initCopy_String(&sh.host, &req->schedHost);
+        sh.port = req->schedPort;
+        iZap(sh.numActive);
+        sh.numActive[req->priority] = 1;
+        pushBack_Array(&d->hosts, &sh);
+    }
+    else {
+        ((iSchedulerHost *) at_Array(&d->hosts, index))->numActive[req->priority]++;
+    }
+    d->numActive[req->priority]++;
+    req->schedState = active_GmRequestScheduleState;
+}
+
+static void freeSlot_RequestScheduler_(iRequestScheduler *d, const iGmRequest *req) {
+    const size_t index = findHost_RequestScheduler_(d, &req->schedHost, req->schedPort);
+    if (index != iInvalidPos) {
+        iSchedulerHost *sh = at_Array(&d->hosts, index);
+        sh->numActive[req->priority]--;
+        iBool isIdle = iTrue;
+        iForIndices(i, sh->numActive) {
+            if (sh->numActive[i]) {
+                isIdle = iFalse;
+            }
+        }
+        if (isIdle) {
+            deinit_String(&sh->host);
+            remove_Array(&d->hosts, index);
+        }
+    }
+    d->numActive[req->priority]--;
+}
+
+static void dispatch_RequestScheduler_(iRequestScheduler *d) {
+    lock_Mutex(d->mtx);
+    if (d->isDispatching) {
+        /* The dispatching thread checks the queues again after each started request. */
+        unlock_Mutex(d->mtx);
+        return;
+    }
+    d->isDispatching  = iTrue;
+    d->dispatchThread = SDL_ThreadID();
+    iGmRequest *req;
+    while ((req = takeStartable_RequestScheduler_(d)) != NULL) {
+        start_RequestScheduler_(d, req);
+        /* Begin funcs may block and may finish the request synchronously, so they are called
+           without holding the lock. Other threads wait in release before freeing `req`. */
+        d->beginning = req;
+        unlock_Mutex(d->mtx);
+        req->schedBegin(req, &req->schedHost, req->schedPort);
+        lock_Mutex(d->mtx);
+        d->beginning = NULL;
+        signalAll_Condition(&d->begun);
+    }
+    d->isDispatching = iFalse;
+    unlock_Mutex(d->mtx);
+}
+
+static void schedule_RequestScheduler_(iRequestScheduler *d, iGmRequest *req) {
+    lock_Mutex(d->mtx);
+    req->submittedAt = SDL_GetTicks();
+    req->schedState  = queued_GmRequestScheduleState;
+    pushBack_PtrArray(&d->queued[req->priority], req);
+    d->maxQueued[req->priority] =
+        iMax(d->maxQueued[req->priority], size_PtrArray(&d->queued[req->priority]));
+    unlock_Mutex(d->mtx);
+    dispatch_RequestScheduler_(d);
+}
+
+static void release_RequestScheduler_(iRequestScheduler *d, iGmRequest *req) {
+    lock_Mutex(d->mtx);
+    if (d->beginning == req) {
+        if (d->dispatchThread == SDL_ThreadID()) {
+            d->beginning = NULL; /* finished synchronously; the dispatcher must not touch it */
+        }
+        else {
+            while (d->beginning == req) {
+                wait_Condition(&d->begun, d->mtx);
+            }
+        }
+    }
+    const iBool wasScheduled = (req->schedState == queued_GmRequestScheduleState ||
+                                req->schedState == active_GmRequestScheduleState);
+    if (req->schedState == queued_GmRequestScheduleState) {
+        removeOne_PtrArray(&d->queued[req->priority], req);
+    }
+    else if (req->schedState == active_GmRequestScheduleState ||
+             req->schedState == unlimited_GmRequestScheduleState) {
+        if (req->schedState == active_GmRequestScheduleState) {
+            freeSlot_RequestScheduler_(d, req);
+        }
+        else {
+            d->numUnlimited[req->priority]--;
+        }
+        d->numFinished[req->priority]++;
+        d->totalDurationMs[req->priority] += SDL_GetTicks() - req->submittedAt;
+    }
+    if (req->schedState != none_GmRequestScheduleState) {
+        req->schedState = released_GmRequestScheduleState;
+    }
+    unlock_Mutex(d->mtx);
+    if (wasScheduled) {
+        dispatch_RequestScheduler_(d);
+    }
+}
+
+static void unlimit_RequestScheduler_(iRequestScheduler *d, iGmRequest *req) {
+    lock_Mutex(d->mtx);
+    const iBool wasActive = (req->schedState == active_GmRequestScheduleState);
+    if (wasActive) {
+        freeSlot_RequestScheduler_(d, req);
+        d->numUnlimited[req->priority]++;
+        req->schedState = unlimited_GmRequestScheduleState;
+    }
+    unlock_Mutex(d->mtx);
+    if (wasActive) {
+        dispatch_RequestScheduler_(d);
+    }
+}
+
+static iBool unqueue_RequestScheduler_(iRequestScheduler *d, iGmRequest *req) {
+    iBool wasQueued = iFalse;
+    lock_Mutex(d->mtx);
+    if (req->schedState == queued_GmRequestScheduleState) {
+        removeOne_PtrArray(&d->queued[req->priority], req);
+        req->schedState = released_GmRequestScheduleState;
+        wasQueued = iTrue;
+    }
+    unlock_Mutex(d->mtx);
+    if (wasQueued) {
+        dispatch_RequestScheduler_(d);
+    }
+    return wasQueued;
+}
+
+const iString *debugInfo_RequestScheduler(void) {
+    static const char *names[max_GmRequestPriority] = { "Background", "Media", "Foreground" };
+    iRequestScheduler *d = &scheduler_;
+    iString *info = collectNew_String();
+    lock_Mutex(d->mtx);
+    for (int prio = max_GmRequestPriority - 1; prio >= 0; prio--) {
+        const size_t started = d->numStarted[prio];
+        const size_t finished = d->numFinished[prio];
+        appendFormat_String(info,
+                            "* %s: %d active (%d unlimited), %zu queued (max %zu), %zu started; "
+                            "queue wait avg %u ms, max %u ms; duration avg %u ms\n",
+                            names[prio],
+                            d->numActive[prio] + d->numUnlimited[prio],
+                            d->numUnlimited[prio],
+                            size_PtrArray(&d->queued[prio]),
+                            d->maxQueued[prio],
+                            started,
+                            started ? (unsigned) (d->totalWaitMs[prio] / started) : 0,
+                            d->maxWaitMs[prio],
+                            finished ? (unsigned) (d->totalDurationMs[prio] / finished) : 0);
+    }
+    appendFormat_String(info, "* Hosts with active requests: %zu\n", size_Array(&d->hosts));
+    unlock_Mutex(d->mtx);
+    return info;
+}
+
+static void notifyFinished_GmRequest_(iGmRequest *d) {
+    /* Free the scheduler slot before the owner gets to react to the result. */
+    release_RequestScheduler_(&scheduler_, d);
+    iNotifyAudience(d, finished, GmRequestFinished);
+}
+
 static uint16_t port_GmRequest_(iGmRequest *d) {
     return urlPort_String(&d->url);
 }
@@ -226,9 +553,15 @@ static void checkServerCertificate_GmRequest_(iGmRequest *d) {
     }
 }
 
+static iBool isPageContent_(const iString *mime) {
+    /* Pages and inline images; anything else may be a long transfer. */
+    return startsWithCase_String(mime, "text/") || startsWithCase_String(mime, "image/");
+}
+
 static int processIncomingData_GmRequest_(iGmRequest *d, const iBlock *data) {
     iBool        notifyUpdate = iFalse;
     iBool        notifyDone   = iFalse;
+    iBool        isUnlimited  = iFalse;
     iGmResponse *resp         = d->resp;
     if (d->state == receivingHeader_GmRequestState) {
         appendCStrN_String(&resp->meta, constData_Block(data), size_Block(data));
@@ -270,6 +603,9 @@ static int processIncomingData_GmRequest_(iGmRequest *d, const iBlock *data) {
                 if (d->isFilterEnabled && willTryFilter_MimeHooks(mimeHooks_App(), &resp->meta)) {
                     d->isRespFiltered = iTrue;
                 }
+                if (code == success_GmStatusCode && !isPageContent_(&resp->meta)) {
+                    isUnlimited = iTrue;
+                }
             }
             checkServerCertificate_GmRequest_(d);
             iRelease(metaPattern);
@@ -279,7 +615,7 @@ static int processIncomingData_GmRequest_(iGmRequest *d, const iBlock *data) {
         append_Block(&resp->body, data);
         notifyUpdate = iTrue;
     }
-    return (notifyUpdate ? 1 : 0) | (notifyDone ? 2 : 0);
+    return (notifyUpdate ? 1 : 0) | (notifyDone ? 2 : 0) | (isUnlimited ? 4 : 0);
 }
 
 static void readIncoming_GmRequest_(iGmRequest *d, iTlsRequest *req) {
@@ -298,6 +634,9 @@ static void readIncoming_GmRequest_(iGmRequest *d, iTlsRequest *req) {
     initCurrent_Time(&resp->when);
     delete_Block(data);
     unlock_Mutex(d->mtx);
+    if (ubits & 4) {
+        unlimit_RequestScheduler_(&scheduler_, d);
+    }
     if (notifyUpdate && !d->isRespFiltered) {
         const iBool allowed = exchange_Atomic(&d->allowUpdate, iFalse);
         if (allowed) {
@@ -305,7 +644,7 @@ static void readIncoming_GmRequest_(iGmRequest *d, iTlsRequest *req) {
         }
     }
     if (notifyDone) {
-        iNotifyAudience(d, finished, GmRequestFinished);
+        notifyFinished_GmRequest_(d);
     }
 }
 
@@ -366,7 +705,7 @@ static void requestFinished_GmRequest_(iGmRequest *d, iTlsRequest *req) {
     if (d->isRespFiltered && d->state == finished_GmRequestState) {
         applyFilter_GmRequest_(d);
     }
-    iNotifyAudience(d, finished, GmRequestFinished);
+    notifyFinished_GmRequest_(d);
 }
 
 static const iBlock *aboutPageSource_(iRangecc path, iRangecc query) {
@@ -391,6 +730,9 @@ static const iBlock *aboutPageSource_(iRangecc path, iRangecc query) {
     if (equalCase_Rangecc(path, "fonts")) {
         return utf8_String(infoPage_Fonts(query));
     }
+    if (equalCase_Rangecc(path, "profiler")) {
+        return utf8_String(infoPage_Profiler());
+    }
     if (equalCase_Rangecc(path, "feeds")) {
         return utf8_String(entryListPage_Feeds());
     }
@@ -464,7 +806,7 @@ static void plainSocketDisconnected_GmRequest_(iGmRequest *d, iSocket *socket) {
     }
     unlock_Mutex(d->mtx);
     if (notify) {
-        iNotifyAudience(d, finished, GmRequestFinished);
+        notifyFinished_GmRequest_(d);
     }
 }
 
@@ -476,7 +818,7 @@ static void plainSocketError_GmRequest_(iGmRequest *d, iSocket *socket, int erro
     format_String(&d->resp->meta, "%s (errno %d)", msg, error);
     clear_Block(&d->resp->body);
     unlock_Mutex(d->mtx);
-    iNotifyAudience(d, finished, GmRequestFinished);
+    notifyFinished_GmRequest_(d);
 }
 
 static void gopherRead_GmRequest_(iGmRequest *d, iSocket *socket) {
@@ -511,7 +853,7 @@ static void beginGopherConnection_GmRequest_(iGmRequest *d, const iString *host,
         resp->statusCode = input_GmStatusCode;
         setCStr_String(&resp->meta, "Enter query:");
         d->state = finished_GmRequestState;
-        iNotifyAudience(d, finished, GmRequestFinished);
+        notifyFinished_GmRequest_(d);
     }
 }
 
@@ -563,6 +905,7 @@ static void beginNexConnection_GmRequest_(iGmRequest *d, const iString *host, ui
 static void spartanRead_GmRequest_(iGmRequest *d, iSocket *socket) {
     iBool notifyUpdate = iFalse;
     iBool notifyDone   = iFalse;
+    iBool isUnlimited  = iFalse;
     lock_Mutex(d->mtx);
     iBlock *data = readAll_Socket(socket);
     if (!isEmpty_Block(data)) {
@@ -585,6 +928,7 @@ static void spartanRead_GmRequest_(iGmRequest *d, iSocket *socket) {
                         case 2:
                             d->resp->statusCode = success_GmStatusCode;
                             set_String(&d->resp->meta, collect_String(captured_RegExpMatch(&m, 2)));
+                            isUnlimited = !isPageContent_(&d->resp->meta);
                             break;
                         case 3:
                             d->resp->statusCode = redirectTemporary_GmStatusCode;
@@ -626,11 +970,14 @@ static void spartanRead_GmRequest_(iGmRequest *d, iSocket *socket) {
     }
     delete_Block(data);
     unlock_Mutex(d->mtx);
+    if (isUnlimited) {
+        unlimit_RequestScheduler_(&scheduler_, d);
+    }
     if (notifyUpdate) {
         iNotifyAudience(d, updated, GmRequestUpdated);
     }
     if (notifyDone) {
-        iNotifyAudience(d, finished, GmRequestFinished);
+        notifyFinished_GmRequest_(d);
     }
 }
 
@@ -686,9 +1033,17 @@ void init_GmRequest(iGmRequest *d, iGmCerts *certs) {
     d->finished     = NULL;
     d->sendProgress = NULL;
     d->state        = initialized_GmRequestState;
+    d->priority     = foreground_GmRequestPriority;
+    d->schedState   = none_GmRequestScheduleState;
+    d->schedBegin   = NULL;
+    init_String(&d->schedHost);
+    d->schedPort    = 0;
+    d->submittedAt  = 0;
 }
 
 void deinit_GmRequest(iGmRequest *d) {
+    /* Must be first: the scheduler may be starting the request in another thread. */
+    release_RequestScheduler_(&scheduler_, d);
     if (d->req) {
         iDisconnectObject(TlsRequest, d->req, sent, d);
         iDisconnectObject(TlsRequest, d->req, readyRead, d);
@@ -710,6 +1065,7 @@ void deinit_GmRequest(iGmRequest *d) {
     delete_Audience(d->finished);
     delete_Audience(d->updated);
     delete_GmResponse(d->resp);
+    deinit_String(&d->schedHost);
     deinit_String(&d->url);
     delete_Mutex(d->mtx);
 }
@@ -772,6 +1128,11 @@ void setSendProgressFunc_GmRequest(iGmRequest *d, iGmRequestProgressFunc func) {
     d->sendProgress = func;
 }
 
+void setPriority_GmRequest(iGmRequest *d, enum iGmRequestPriority priority) {
+    iAssert(d->state == initialized_GmRequestState);
+    d->priority = priority;
+}
+
 static void bytesSent_GmRequest_(iGmRequest *d, iTlsRequest *req, size_t sent, size_t toSend) {
     iUnused(req);
     if (d->sendProgress) {
@@ -809,7 +1170,7 @@ static void aboutRequest_GmRequest_(iGmRequest *d) {
         resp->statusCode = invalidLocalResource_GmStatusCode;
     }
     d->state = finished_GmRequestState;
-    iNotifyAudience(d, finished, GmRequestFinished);
+    notifyFinished_GmRequest_(d);
 }
 
 void dataRequest_GmRequest_(iGmRequest *d) {
@@ -843,7 +1204,7 @@ void dataRequest_GmRequest_(iGmRequest *d) {
     d->state = receivingBody_GmRequestState;
     iNotifyAudience(d, updated, GmRequestUpdated);
     d->state = finished_GmRequestState;
-    iNotifyAudience(d, finished, GmRequestFinished);
+    notifyFinished_GmRequest_(d);
 }
 
 static void composeTitanRequest_GmRequest_(iGmRequest *d) {
@@ -1105,11 +1466,54 @@ static void fileRequest_GmRequest_(iGmRequest *d) {
         /* TODO: Use a background thread, the hook may take some time to run. */
         applyFilter_GmRequest_(d);
     }
-    iNotifyAudience(d, finished, GmRequestFinished);
+    notifyFinished_GmRequest_(d);
 }
 
 /*----------------------------------------------------------------------------------------------*/
 
+static void beginGeminiConnection_GmRequest_(iGmRequest *d, const iString *host, uint16_t port) {
+    iGmResponse *resp = d->resp;
+    d->state = receivingHeader_GmRequestState;
+    d->req = new_TlsRequest();
+    if (d->identity) {
+        setCertificate_TlsRequest(d->req, d->identity->cert);
+        set_Block(&resp->identityFingerprint, &d->identity->fingerprint);
+    }
+    /* Site-specific settings. */ {
+        iString siteRoot;
+        initRange_String(&siteRoot, urlRoot_String(&d->url));
+        /* TODO: Keep TLS sessions over restarts. TlsRequest needs a way to export and
+           import its cached sessions first. */
+        setSessionCacheEnabled_TlsRequest(
+            d->req, value_SiteSpec(&siteRoot, tlsSessionCache_SiteSpeckey) != 0);
+        deinit_String(&siteRoot);
+    }
+    iConnect(TlsRequest, d->req, readyRead, d, readIncoming_GmRequest_);
+    iConnect(TlsRequest, d->req, sent, d, bytesSent_GmRequest_);
+    iConnect(TlsRequest, d->req, finished, d, requestFinished_GmRequest_);
+    setHost_TlsRequest(d->req, host, port);
+    if (isTitan_GmRequest_(d)) {
+        composeTitanRequest_GmRequest_(d);
+    }
+    else if (isMisfin_GmRequest_(d)) {
+        composeMisfinRequest_GmRequest_(d);
+    }
+    else {
+        /* Normal Gemini request. */
+        setContent_TlsRequest(d->req,
+                              utf8_String(collectNewFormat_String("%s\r\n", cstr_String(&d->url))));
+    }
+    submit_TlsRequest(d->req);
+}
+
+static void schedule_GmRequest_(iGmRequest *d, iGmRequestBeginFunc begin, const iString *host,
+                                uint16_t port) {
+    d->schedBegin = begin;
+    set_String(&d->schedHost, host);
+    d->schedPort = port;
+    schedule_RequestScheduler_(&scheduler_, d);
+}
+
 void submit_GmRequest(iGmRequest *d) {
     iAssert(d->state == initialized_GmRequestState);
     if (d->state != initialized_GmRequestState) {
@@ -1144,19 +1548,19 @@ void submit_GmRequest(iGmRequest *d) {
         d->isProxy = iTrue;
     }
     else if (equalCase_Rangecc(url.scheme, "gopher")) {
-        beginGopherConnection_GmRequest_(d, host, port ? port : 70);
+        schedule_GmRequest_(d, beginGopherConnection_GmRequest_, host, port ? port : 70);
         return;
     }
     else if (equalCase_Rangecc(url.scheme, "finger")) {
-        beginGopherConnection_GmRequest_(d, host, port ? port : 79);
+        schedule_GmRequest_(d, beginGopherConnection_GmRequest_, host, port ? port : 79);
         return;
     }
     else if (equalCase_Rangecc(url.scheme, "spartan")) {
-        beginSpartanConnection_GmRequest_(d, host, port ? port : 300);
+        schedule_GmRequest_(d, beginSpartanConnection_GmRequest_, host, port ? port : 300);
         return;
     }
     else if (equalCase_Rangecc(url.scheme, "nex")) {
-        beginNexConnection_GmRequest_(d, host, port ? port : 1900);
+        schedule_GmRequest_(d, beginNexConnection_GmRequest_, host, port ? port : 1900);
         return;
     }
     else if (!equalCase_Rangecc(url.scheme, "gemini") &&
@@ -1165,45 +1569,23 @@ void submit_GmRequest(iGmRequest *d) {
         /* This scheme is unrecognized so cannot submit the request. */
         resp->statusCode = unsupportedProtocol_GmStatusCode;
         d->state = finished_GmRequestState;
-        iNotifyAudience(d, finished, GmRequestFinished);
+        notifyFinished_GmRequest_(d);
         return;
     }
-    /* Submitting a Gemini-compatible request. */
-    d->state = receivingHeader_GmRequestState;
-    d->req = new_TlsRequest();
-    if (d->identity) {
-        setCertificate_TlsRequest(d->req, d->identity->cert);
-        set_Block(&resp->identityFingerprint, &d->identity->fingerprint);
-    }
-    /* Site-specific settings. */ {
-        iString siteRoot;
-        initRange_String(&siteRoot, urlRoot_String(&d->url));
-        setSessionCacheEnabled_TlsRequest(
-            d->req, value_SiteSpec(&siteRoot, tlsSessionCache_SiteSpeckey) != 0);
-        deinit_String(&siteRoot);
-    }
-    iConnect(TlsRequest, d->req, readyRead, d, readIncoming_GmRequest_);
-    iConnect(TlsRequest, d->req, sent, d, bytesSent_GmRequest_);
-    iConnect(TlsRequest, d->req, finished, d, requestFinished_GmRequest_);
     if (port == 0) {
         port = isMisfin_GmRequest_(d) ? MISFIN_DEFAULT_PORT : GEMINI_DEFAULT_PORT;
     }
-    setHost_TlsRequest(d->req, host, port);
-    if (isTitan_GmRequest_(d)) {
-        composeTitanRequest_GmRequest_(d);
-    }
-    else if (isMisfin_GmRequest_(d)) {
-        composeMisfinRequest_GmRequest_(d);
-    }
-    else {
-        /* Normal Gemini request. */
-        setContent_TlsRequest(d->req,
-                              utf8_String(collectNewFormat_String("%s\r\n", cstr_String(&d->url))));
-    }
-    submit_TlsRequest(d->req);
+    schedule_GmRequest_(d, beginGeminiConnection_GmRequest_, host, port);
 }
 
 void cancel_GmRequest(iGmRequest *d) {
+    if (unqueue_RequestScheduler_(&scheduler_, d)) {
+        /* Never started, so there is nothing to abort, but the owner still expects to hear
+           that the request is done. */
+        iGuardMutex(d->mtx, d->state = failure_GmRequestState);
+        notifyFinished_GmRequest_(d);
+        return;
+    }
     if (d->req) {
         cancel_TlsRequest(d->req);
     }
@@ -70,12 +70,23 @@ iDeclareAudienceGetter(GmRequest, finished)
 
 typedef void (*iGmRequestProgressFunc)(iGmRequest *, size_t current, size_t total);
 
+/* Network requests are started by a shared scheduler. Higher priority classes are
+   dispatched first, and each class has its own per-host and total concurrency limits.
+   Uploads and responses that are not pages or images are not limited. */
+enum iGmRequestPriority {
+    background_GmRequestPriority, /* feeds, remote bookmarks, prefetching */
+    media_GmRequestPriority,      /* inline images and audio */
+    foreground_GmRequestPriority, /* the document being viewed (default) */
+    max_GmRequestPriority
+};
+
 void                enableFilters_GmRequest     (iGmRequest *, iBool enable);
 void                setUrl_GmRequest            (iGmRequest *, const iString *url);
 void                setIdentity_GmRequest       (iGmRequest *, const iGmIdentity *id);
 void                setUploadData_GmRequest     (iGmRequest *, const iString *mime,
                                                  const iBlock *payload, const iString *token);
 void                setSendProgressFunc_GmRequest(iGmRequest *, iGmRequestProgressFunc func);
+void                setPriority_GmRequest       (iGmRequest *, enum iGmRequestPriority priority);
 void                submit_GmRequest            (iGmRequest *);
 void                cancel_GmRequest            (iGmRequest *);
 
@@ -95,3 +106,7 @@ const iAddress *    address_GmRequest           (const iGmRequest *);
 
 int                 certFlags_GmRequest         (const iGmRequest *);
 iDate               certExpirationDate_GmRequest(const iGmRequest *);
+
+void                init_RequestScheduler       (void);
+void                deinit_RequestScheduler     (void);
+const iString *     debugInfo_RequestScheduler  (void); /* queue depths and latencies */
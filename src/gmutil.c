@@ -33,8 +33,34 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include <the_Foundation/regexp.h>
 #include <the_Foundation/regexp.h>
 
-iRegExp *newGemtextLink_RegExp(void) {
-    return new_RegExp("=>\\s*([^\\s]+)(\\s.*)?", 0);
+static iBool isPatternSpace_(char ch) {
+    /* Same as `\s` in a regular expression. */
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\v' || ch == '\f' || ch == '\r';
+}
+
+iBool parseGemtextLink_Rangecc(iRangecc line, const char *marker, iRangecc *url_out,
+                               iRangecc *label_out) {
+    /* Equivalent to the pattern: <marker>\s*([^\s]+)(\s.*)? */
+    iAssert(strlen(marker) == 2);
+    for (const char *pos = line.start; pos && pos + 1 < line.end; pos++) {
+        if (pos[0] != marker[0] || pos[1] != marker[1]) {
+            continue;
+        }
+        const char *url = pos + 2;
+        while (url != line.end && isPatternSpace_(*url)) {
+            url++;
+        }
+        const char *urlEnd = url;
+        while (urlEnd != line.end && !isPatternSpace_(*urlEnd)) {
+            urlEnd++;
+        }
+        if (urlEnd != url) {
+            *url_out   = (iRangecc){ url, urlEnd };
+            *label_out = (iRangecc){ urlEnd, line.end };
+            return iTrue;
+        }
+    }
+    return iFalse;
 }
 
 void init_Url(iUrl *d, const iString *text) {
@@ -100,7 +100,8 @@ struct Impl_GmError {
 iBool               isDefined_GmError   (enum iGmStatusCode code);
 const iGmError *    get_GmError         (enum iGmStatusCode code);
 
-iRegExp *       newGemtextLink_RegExp   (void);
+iBool           parseGemtextLink_Rangecc(iRangecc line, const char *marker, iRangecc *url_out,
+                                         iRangecc *label_out); /* marker: "=>" or "=:" */
 
 #define GEMINI_DEFAULT_PORT         ((uint16_t) 1965)
 #define GEMINI_DEFAULT_PORT_CSTR    "1965"
@@ -25,17 +25,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "app.h"
 
 #include <ctype.h>
+#include <string.h>
 
 iDefineTypeConstruction(Gopher)
 
-iLocalDef iBool isCRLFLineTerminator_(const char *str) {
-    return str[0] == '\r' && str[1] == '\n';
-}
-
-iLocalDef iBool isLineTerminator_(const char *str) {
-    return isCRLFLineTerminator_(str) || str[0] == '\n';
-}
-
 iLocalDef iBool isDiagram_(char ch) {
     return strchr("^*_-=~/|\\<>()[]{}", ch) != NULL;
 }
@@ -112,94 +105,149 @@ static void appendEscapedLineToOutput_Gopher_(iGopher *d, iRangecc text, size_t
     appendCStr_Block(d->output, "\n");
 }
 
+static void appendEncodedPath_Gopher_(iGopher *d, iRangecc path) {
+    /* Same as urlEncodeExclude_String(path, "/%"), without the intermediate strings. */
+    static const char hex_[] = "0123456789ABCDEF";
+    const char *run = path.start; /* characters that don't need escaping */
+    for (const char *ch = path.start; ch != path.end; ch++) {
+        const unsigned char c = *ch;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+            c == '-' || c == '_' || c == '.' || c == '~' || c == '/' || c == '%') {
+            continue;
+        }
+        const char enc[3] = { '%', hex_[c >> 4], hex_[c & 15] };
+        appendData_Block(d->output, run, ch - run);
+        appendData_Block(d->output, enc, 3);
+        run = ch + 1;
+    }
+    appendData_Block(d->output, run, path.end - run);
+}
+
+static void appendSpacesEncoded_Gopher_(iGopher *d, iRangecc url) {
+    if (startsWithCase_Rangecc(url, "data:")) {
+        appendData_Block(d->output, url.start, size_Range(&url));
+        return;
+    }
+    const char *run = url.start;
+    for (const char *ch = url.start; ch != url.end; ch++) {
+        if (*ch == ' ') {
+            appendData_Block(d->output, run, ch - run);
+            appendCStr_Block(d->output, "%20");
+            run = ch + 1;
+        }
+    }
+    appendData_Block(d->output, run, url.end - run);
+}
+
+static iBool splitMenuLine_Gopher_(iRangecc line, iRangecc *fields_out) {
+    /* Menu lines have the item type character followed by four tab-separated fields:
+       text, path, domain, and port. Anything after the port (e.g., Gopher+) is ignored. */
+    if (isEmpty_Range(&line)) {
+        return iFalse;
+    }
+    const char *pos = line.start + 1;
+    for (size_t i = 0; i < 3; i++) {
+        const char *tab = memchr(pos, '\t', line.end - pos);
+        if (!tab) {
+            return iFalse;
+        }
+        fields_out[i] = (iRangecc){ pos, tab };
+        pos = tab + 1;
+    }
+    fields_out[3] = (iRangecc){ pos, pos };
+    while (fields_out[3].end < line.end && isdigit((unsigned char) *fields_out[3].end)) {
+        fields_out[3].end++;
+    }
+    return iTrue;
+}
+
 static iBool convertSource_Gopher_(iGopher *d) {
     iBool    converted = iFalse;
     iRangecc body      = range_Block(&d->source);
-    iRegExp *pattern   = new_RegExp("(.)([^\t]*)\t([^\t]*)\t([^\t]*)\t([0-9]+)?", 0);
+    /* Bytes before `scanPos` were already searched for line terminators. */
+    const char *scan = body.start + iMin(d->scanPos, size_Range(&body));
     for (;;) {
         /* Find the end of the line. */
-        iRangecc line = { body.start, body.start };
-        while (line.end < body.end - 1 && !isLineTerminator_(line.end)) {
-            line.end++;
-        }
-        if (line.end >= body.end - 1 || !isLineTerminator_(line.end)) {
+        const char *lineEnd = memchr(scan, '\n', body.end - scan);
+        if (!lineEnd) {
             /* Not a complete line. More may be coming later. */
             break;
         }
-        body.start = line.end + (isCRLFLineTerminator_(line.end) ? 2 : 1);
-        trimEnd_Rangecc(&line);
-        iRegExpMatch m;
-        init_RegExpMatch(&m);
-        if (matchRange_RegExp(pattern, line, &m)) {
-            const char     lineType = *capturedRange_RegExpMatch(&m, 1).start;
-            const iRangecc text     = capturedRange_RegExpMatch(&m, 2);
-            const iRangecc path     = capturedRange_RegExpMatch(&m, 3);
-            const iRangecc domain   = capturedRange_RegExpMatch(&m, 4);
-            const iRangecc port     = capturedRange_RegExpMatch(&m, 5);
-            iString *buf = new_String();
-            switch (lineType) {
-                case 'i':
-                case '3': {
-                    setPre_Gopher_(d, isPreformatted_(text));
-                    appendEscapedLineToOutput_Gopher_(d, text, size_Range(&text));
-                    break;
+        iRangecc line = { body.start, lineEnd };
+        body.start = scan = lineEnd + 1;
+        trimEnd_Rangecc(&line); /* also removes CR */
+        iRangecc fields[4];
+        if (!splitMenuLine_Gopher_(line, fields)) {
+#if !defined (NDEBUG)
+            printf("[Gopher] unrecognized: {%s}\n", cstr_Rangecc(line));
+#endif
+            continue;
+        }
+        const char     lineType = *line.start;
+        const iRangecc text     = fields[0];
+        const iRangecc path     = fields[1];
+        const iRangecc domain   = fields[2];
+        const iRangecc port     = fields[3];
+        iBlock *       out      = d->output;
+        converted = iTrue;
+        switch (lineType) {
+            case 'i':
+            case '3': {
+                setPre_Gopher_(d, isPreformatted_(text));
+                appendEscapedLineToOutput_Gopher_(d, text, size_Range(&text));
+                break;
+            }
+            case '0':
+            case '1':
+            case '7':
+            case '4':
+            case '5':
+            case '9':
+            case 'g':
+            case 'p':
+            case 'I':
+            case 's': {
+                const char typePath[2] = { '/', lineType };
+                setPre_Gopher_(d, iFalse);
+                appendCStr_Block(out, "=> gopher://");
+                appendData_Block(out, domain.start, size_Range(&domain));
+                appendCStr_Block(out, ":");
+                if (isEmpty_Range(&port)) {
+                    appendCStr_Block(out, "70");
                 }
-                case '0':
-                case '1':
-                case '7':
-                case '4':
-                case '5':
-                case '9':
-                case 'g':
-                case 'p':
-                case 'I':
-                case 's': {
-                    iBeginCollect();
-                    setPre_Gopher_(d, iFalse);
-                    format_String(buf,
-                                  "=> gopher://%s:%s/%c%s %s\n",
-                                  cstr_Rangecc(domain),
-                                  isEmpty_Range(&port) ? "70" : cstr_Rangecc(port),
-                                  lineType,
-                                  cstrCollect_String(
-                                      urlEncodeExclude_String(collectNewRange_String(path), "/%")),
-                                  cstr_Rangecc(text));
-                    appendData_Block(d->output, constBegin_String(buf), size_String(buf));
-                    iEndCollect();
-                    break;
+                else {
+                    appendData_Block(out, port.start, size_Range(&port));
                 }
-                case 'h': {
-                    iBeginCollect();
-                    setPre_Gopher_(d, iFalse);
-                    if (startsWith_Rangecc(path, "URL:")) {
-                        format_String(buf,
-                                      "=> %s %s\n",
-                                      cstr_String(withSpacesEncoded_String(collectNewRange_String(
-                                          (iRangecc){ path.start + 4, path.end }))),
-                                      cstr_Rangecc(text));
-                    }
-                    appendData_Block(d->output, constBegin_String(buf), size_String(buf));
-                    iEndCollect();
-                    break;
+                appendData_Block(out, typePath, 2);
+                appendEncodedPath_Gopher_(d, path);
+                appendCStr_Block(out, " ");
+                appendData_Block(out, text.start, size_Range(&text));
+                appendCStr_Block(out, "\n");
+                break;
+            }
+            case 'h': {
+                setPre_Gopher_(d, iFalse);
+                if (startsWith_Rangecc(path, "URL:")) {
+                    appendCStr_Block(out, "=> ");
+                    appendSpacesEncoded_Gopher_(d, (iRangecc){ path.start + 4, path.end });
+                    appendCStr_Block(out, " ");
+                    appendData_Block(out, text.start, size_Range(&text));
+                    appendCStr_Block(out, "\n");
                 }
-                default: /* all unknown types */
-                    setPre_Gopher_(d, iFalse);
-                    appendEscapedLineToOutput_Gopher_(d, text, size_Range(&text));
-                    setPre_Gopher_(d, iTrue);
-                    appendEscapedLineToOutput_Gopher_(d, path, port.end - path.start);
-                    break;
+                break;
             }
-            delete_String(buf);
-        }
-        else {
-#if !defined (NDEBUG)
-            printf("[Gopher] unrecognized: {%s}\n", cstr_Rangecc(line));
-#endif
+            default: /* all unknown types */
+                setPre_Gopher_(d, iFalse);
+                appendEscapedLineToOutput_Gopher_(d, text, size_Range(&text));
+                setPre_Gopher_(d, iTrue);
+                appendEscapedLineToOutput_Gopher_(d, path, port.end - path.start);
+                break;
         }
     }
-    iRelease(pattern);
-    /* Remove the part of the source that was successfully converted. */
+    /* Remove the part of the source that was successfully converted. What remains is
+       an incomplete line, so there is no need to search it again. */
     remove_Block(&d->source, 0, body.start - constBegin_Block(&d->source));
+    d->scanPos = size_Block(&d->source);
     return converted;
 }
 
@@ -207,6 +255,7 @@ void init_Gopher(iGopher *d) {
     d->socket = NULL;
     d->type = 0;
     init_Block(&d->source, 0);
+    d->scanPos = 0;
     d->needQueryArgs = iFalse;
     d->isPre = iFalse;
     d->meta = NULL;
@@ -293,6 +342,7 @@ void open_Gopher(iGopher *d, const iString *url) {
             break;
     }
     d->isPre = iFalse;
+    d->scanPos = 0;
     open_Socket(d->socket);
     writeData_Socket(d->socket, cstr_String(reqPath), size_String(reqPath));
     if (!isEmpty_Range(&parts.query)) {
@@ -32,7 +32,8 @@ iDeclareType(Gopher)
 struct Impl_Gopher {
     iSocket *socket;
     char     type;
-    iBlock   source;
+    iBlock   source;  /* unconverted remainder of the menu */
+    size_t   scanPos; /* no line terminators in `source` before this offset */
     iBool    isPre;
     iBool    needQueryArgs;
     iString *meta;
@@ -36,6 +36,8 @@ void init_RecentUrl(iRecentUrl *d) {
     init_String(&d->url);
     d->normScrollY    = 0;
     d->cachedResponse = NULL;
+    d->contentPos     = 0;
+    d->pendingContentPos = 0;
     d->cachedDoc      = NULL;
     d->flags          = 0;
     init_Block(&d->setIdentity, 0);
@@ -55,12 +57,25 @@ iRecentUrl *copy_RecentUrl(const iRecentUrl *d) {
     set_String(&copy->url, &d->url);
     copy->normScrollY    = d->normScrollY;
     copy->cachedResponse = d->cachedResponse ? copy_GmResponse(d->cachedResponse) : NULL;
+    copy->contentPos     = d->contentPos;
+    copy->pendingContentPos = d->pendingContentPos;
     copy->cachedDoc      = ref_Object(d->cachedDoc);
     copy->flags          = d->flags;
     set_Block(&copy->setIdentity, &d->setIdentity);
     return copy;
 }
 
+static iGmResponse *readSavedContent_RecentUrl_(const iRecentUrl *d) {
+    iStream *ins = savedContent_App();
+    if (!d->contentPos || !ins) {
+        return NULL;
+    }
+    seek_Stream(ins, d->contentPos);
+    iGmResponse *resp = new_GmResponse();
+    deserialize_GmResponse(resp, ins);
+    return resp;
+}
+
 size_t cacheSize_RecentUrl(const iRecentUrl *d) {
     size_t size = 0;
     if (d->cachedResponse) {
@@ -180,6 +195,12 @@ void serialize_History(const iHistory *d, iStream *outs) {
     serializeWithContent_History(d, outs, iTrue);
 }
 
+enum iRecentContent {
+    none_RecentContent,
+    inline_RecentContent,
+    contentStream_RecentContent, /* position in a separate stream */
+};
+
 void serializeWithContent_History(const iHistory *d, iStream *outs, iBool withContent) {
     lock_Mutex(d->mtx);
     writeU16_Stream(outs, d->recentPos);
@@ -190,11 +211,49 @@ void serializeWithContent_History(const iHistory *d, iStream *outs, iBool withCo
         write32_Stream(outs, item->normScrollY * 1.0e6f);
         writeU16_Stream(outs, item->flags);
         if (withContent && item->cachedResponse) {
-            write8_Stream(outs, 1);
+            write8_Stream(outs, inline_RecentContent);
             serialize_GmResponse(item->cachedResponse, outs);
         }
         else {
-            write8_Stream(outs, 0);
+            write8_Stream(outs, none_RecentContent);
+        }
+        serialize_Block(&item->setIdentity, outs);
+    }
+    unlock_Mutex(d->mtx);
+}
+
+void serializeWithContentStream_History(iHistory *d, iStream *outs, iStream *contentOuts,
+                                        size_t contentBase) {
+    /* When appending, responses already in the content stream are only referred to. */
+    const iBool isRewrite = (contentOuts && contentBase == 0);
+    lock_Mutex(d->mtx);
+    writeU16_Stream(outs, d->recentPos);
+    writeU16_Stream(outs, size_Array(&d->recent));
+    iForEach(Array, i, &d->recent) {
+        iRecentUrl *item = i.value;
+        serialize_String(&item->url, outs);
+        write32_Stream(outs, item->normScrollY * 1.0e6f);
+        writeU16_Stream(outs, item->flags);
+        uint32_t contentPos = item->contentPos;
+        if (contentOuts && (isRewrite || !item->contentPos)) {
+            /* Content that was never loaded is copied over from the previously saved stream.
+               The new position is used once the content has been written. */
+            iGmResponse *saved = (item->cachedResponse ? NULL : readSavedContent_RecentUrl_(item));
+            const iGmResponse *content = (saved ? saved : item->cachedResponse);
+            contentPos = 0;
+            if (content) {
+                contentPos = contentBase + pos_Stream(contentOuts);
+                serialize_GmResponse(content, contentOuts);
+            }
+            item->pendingContentPos = contentPos;
+            delete_GmResponse(saved);
+        }
+        if (contentPos) {
+            write8_Stream(outs, contentStream_RecentContent);
+            writeU32_Stream(outs, contentPos);
+        }
+        else {
+            write8_Stream(outs, none_RecentContent);
         }
         serialize_Block(&item->setIdentity, outs);
     }
@@ -215,7 +274,11 @@ void deserialize_History(iHistory *d, iStream *ins) {
         if (version_Stream(ins) >= addedRecentUrlFlags_FileVersion) {
             item.flags = readU16_Stream(ins);
         }
-        if (read8_Stream(ins)) {
+        const uint8_t content = read8_Stream(ins);
+        if (content == contentStream_RecentContent) {
+            item.contentPos = readU32_Stream(ins); /* loaded when needed */
+        }
+        else if (content) {
             item.cachedResponse = new_GmResponse();
             deserialize_GmResponse(item.cachedResponse, ins);
         }
@@ -434,6 +497,8 @@ void setCachedResponse_History(iHistory *d, const iGmResponse *response) {
     if (item) {
         delete_GmResponse(item->cachedResponse);
         item->cachedResponse = NULL;
+        item->contentPos     = 0;
+        item->pendingContentPos = 0;
         if (category_GmStatusCode(response->statusCode) == categorySuccess_GmStatusCode) {
             item->cachedResponse = copy_GmResponse(response);
         }
@@ -493,11 +558,47 @@ void clearCache_History(iHistory *d) {
             delete_GmResponse(url->cachedResponse);
             url->cachedResponse = NULL;
         }
+        url->contentPos = 0;
+        url->pendingContentPos = 0;
         iReleasePtr(&url->cachedDoc); /* release all cached documents and media as well */
     }
     unlock_Mutex(d->mtx);
 }
 
+void commitContent_History(iHistory *d, iBool isWritten, iBool isRewrite) {
+    /* Rewriting replaces all previously saved content, including positions of items that
+       had no content to save. */
+    lock_Mutex(d->mtx);
+    iForEach(Array, i, &d->recent) {
+        iRecentUrl *item = i.value;
+        if (isWritten && (isRewrite || item->pendingContentPos)) {
+            item->contentPos = item->pendingContentPos;
+        }
+        item->pendingContentPos = 0;
+    }
+    unlock_Mutex(d->mtx);
+}
+
+static iBool isContentSaved_RecentUrl_(const iRecentUrl *d) {
+    return d && d->contentPos && !d->cachedResponse;
+}
+
+void loadContent_History(iHistory *d) {
+    iBool isNeeded;
+    iGuardMutex(d->mtx, isNeeded = isContentSaved_RecentUrl_(mostRecentUrl_History(d)));
+    if (!isNeeded) {
+        return;
+    }
+    savedContent_App(); /* finish writing first; positions may change */
+    lock_Mutex(d->mtx);
+    iRecentUrl *url = mostRecentUrl_History(d);
+    if (isContentSaved_RecentUrl_(url)) {
+        /* The position is kept so the response isn't saved again. */
+        url->cachedResponse = readSavedContent_RecentUrl_(url);
+    }
+    unlock_Mutex(d->mtx);
+}
+
 void invalidateCachedLayout_History(iHistory *d) {
     lock_Mutex(d->mtx);
     iForEach(Array, i, &d->recent) {
@@ -533,6 +634,8 @@ size_t pruneLeastImportant_History(iHistory *d) {
         delta = cacheSize_RecentUrl(url);
         delete_GmResponse(url->cachedResponse);
         url->cachedResponse = NULL;
+        url->contentPos     = 0;
+        url->pendingContentPos = 0;
         iReleasePtr(&url->cachedDoc);
     }
     unlock_Mutex(d->mtx);
@@ -38,6 +38,8 @@ struct Impl_RecentUrl {
     iString      url;
     float        normScrollY;    /* normalized to document height */
     iGmResponse *cachedResponse; /* kept in memory for quicker back navigation */
+    uint32_t     contentPos;     /* position of cachedResponse in saved content; 0 if not saved */
+    uint32_t     pendingContentPos; /* position in saved content still being written */
     iGmDocument *cachedDoc;      /* cached copy of the presentation: layout and media (not serialized) */
     iBlock       setIdentity;    /* fingerprint of identity that was pinned*/
     uint16_t     flags;
@@ -57,6 +59,10 @@ iDeclareTypeConstruction(History)
 iDeclareTypeSerialization(History)
 
 void        serializeWithContent_History(const iHistory *, iStream *outs, iBool withContent);
+void        serializeWithContentStream_History(iHistory *, iStream *outs, iStream *contentOuts,
+                                               size_t contentBase);
+void        commitContent_History       (iHistory *, iBool isWritten, iBool isRewrite);
+void        loadContent_History         (iHistory *); /* read current item's response from saved content */
 
 iHistory *  copy_History                (const iHistory *);
 void        lock_History                (iHistory *);
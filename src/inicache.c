@@ -0,0 +1,137 @@
+/* Copyright 2026 Jaakko Keränen <jaakko.keranen@iki.fi>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+#include "inicache.h"
+#include "app.h"
+
+#include <the_Foundation/file.h>
+#include <the_Foundation/fileinfo.h>
+
+static const char    *magic_IniCache_         = "lgIC";
+static const uint32_t formatVersion_IniCache_ = 1;
+static const size_t   headerSize_IniCache_    = 4 + 4 + 4 + 8 + 8 + 4 + 8 + 4 + 8;
+
+iDeclareType(IniCacheStamp)
+
+/* Identifies the INI file contents the cache was made from. */
+struct Impl_IniCacheStamp {
+    uint64_t size;
+    iTime    modified;
+    uint64_t hash;
+};
+
+static uint64_t hash_IniCache_(const void *data, size_t size) {
+    /* 64-bit FNV-1a */
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint8_t *ptr = data;
+    const uint8_t *end = ptr + size;
+    for (; ptr != end; ptr++) {
+        hash ^= *ptr;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static iBool init_IniCacheStamp(iIniCacheStamp *d, const char *iniPath, const iBlock *iniSource) {
+    iFileInfo *info = new_FileInfo(collectNewCStr_String(iniPath));
+    const iBool exists = exists_FileInfo(info) && !isDirectory_FileInfo(info);
+    if (exists) {
+        d->size     = size_FileInfo(info);
+        d->modified = lastModified_FileInfo(info);
+        d->hash     = hash_IniCache_(constData_Block(iniSource), size_Block(iniSource));
+    }
+    iRelease(info);
+    return exists;
+}
+
+static const char *cachePath_IniCache_(const char *iniPath) {
+    return format_CStr("%s.bin", iniPath);
+}
+
+iBuffer *open_IniCache(const char *iniPath, const iBlock *iniSource, uint32_t version) {
+    iIniCacheStamp stamp;
+    if (!init_IniCacheStamp(&stamp, iniPath, iniSource)) {
+        return NULL;
+    }
+    iBuffer *buf = NULL;
+    iFile   *f   = newCStr_File(cachePath_IniCache_(iniPath));
+    if (open_File(f, readOnly_FileMode)) {
+        const iBlock *data = collect_Block(readAll_File(f));
+        if (size_Block(data) >= headerSize_IniCache_) {
+            buf = new_Buffer();
+            open_Buffer(buf, data);
+            iStream *ins = stream_Buffer(buf);
+            char magic[4];
+            readData_Stream(ins, 4, magic);
+            iBool isValid = !memcmp(magic, magic_IniCache_, 4) &&
+                            readU32_Stream(ins) == formatVersion_IniCache_ &&
+                            readU32_Stream(ins) == version &&
+                            readU64_Stream(ins) == stamp.size &&
+                            (int64_t) readU64_Stream(ins) == (int64_t) stamp.modified.ts.tv_sec &&
+                            readU32_Stream(ins) == (uint32_t) stamp.modified.ts.tv_nsec &&
+                            readU64_Stream(ins) == stamp.hash;
+            if (isValid) {
+                /* The payload must be intact, too. */
+                const size_t   payloadSize = readU32_Stream(ins);
+                const uint64_t payloadHash = readU64_Stream(ins);
+                isValid = (payloadSize == size_Block(data) - headerSize_IniCache_ &&
+                           payloadHash == hash_IniCache_(constBegin_Block(data) +
+                                                             headerSize_IniCache_,
+                                                         payloadSize));
+            }
+            if (!isValid) {
+                iReleasePtr(&buf);
+            }
+        }
+    }
+    iRelease(f);
+    return buf;
+}
+
+void save_IniCache(const char *iniPath, const iBlock *iniSource, uint32_t version,
+                   const iBlock *payload) {
+    iIniCacheStamp stamp;
+    if (!init_IniCacheStamp(&stamp, iniPath, iniSource)) {
+        return;
+    }
+    const char *cachePath = cachePath_IniCache_(iniPath);
+    const char *tempPath  = format_CStr("%s.tmp", cachePath);
+    iFile *f = newCStr_File(tempPath);
+    const iBool isOpen = open_File(f, writeOnly_FileMode);
+    if (isOpen) {
+        iStream *outs = stream_File(f);
+        writeData_Stream(outs, magic_IniCache_, 4);
+        writeU32_Stream(outs, formatVersion_IniCache_);
+        writeU32_Stream(outs, version);
+        writeU64_Stream(outs, stamp.size);
+        writeU64_Stream(outs, stamp.modified.ts.tv_sec);
+        writeU32_Stream(outs, (uint32_t) stamp.modified.ts.tv_nsec);
+        writeU64_Stream(outs, stamp.hash);
+        writeU32_Stream(outs, (uint32_t) size_Block(payload));
+        writeU64_Stream(outs, hash_IniCache_(constData_Block(payload), size_Block(payload)));
+        write_File(f, payload);
+    }
+    iRelease(f);
+    if (isOpen) {
+        commitFile_App(cachePath, tempPath);
+    }
+}
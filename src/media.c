@@ -635,6 +635,7 @@ void init_MediaRequest(iMediaRequest *d, iDocumentWidget *doc, unsigned int link
     d->req    = new_GmRequest(certs_App());
     setUrl_GmRequest(d->req, url);
     enableFilters_GmRequest(d->req, enableFilters);
+    setPriority_GmRequest(d->req, media_GmRequestPriority);
     if (overrideDefaultIdentity) {
         setIdentity_GmRequest(d->req, overrideDefaultIdentity);
     }
@@ -657,6 +658,7 @@ void resubmitWithUrl_MediaRequest(iMediaRequest *d, const iString *url) {
     d->req = new_GmRequest(certs_App());
     setUrl_GmRequest(d->req, url);
     enableFilters_GmRequest(d->req, enableFilters);
+    setPriority_GmRequest(d->req, media_GmRequestPriority);
     iConnect(GmRequest, d->req, updated, d, updated_MediaRequest_);
     iConnect(GmRequest, d->req, finished, d, finished_MediaRequest_);
     submit_GmRequest(d->req);
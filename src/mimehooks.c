@@ -24,14 +24,129 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "defs.h"
 #include "gmutil.h"
 #include "gempub.h"
+#include "xmlfeed.h"
 #include "app.h"
 
 #include <the_Foundation/file.h>
 #include <the_Foundation/fileinfo.h>
+#include <the_Foundation/mutex.h>
 #include <the_Foundation/path.h>
 #include <the_Foundation/process.h>
 #include <the_Foundation/stringlist.h>
-#include <the_Foundation/xml.h>
+#include <the_Foundation/thread.h>
+
+/* Child processes are all started in a single dedicated thread. Forking from multiple
+   background threads at once may confuse the I/O pipe fds of the children. Once started,
+   the filters run concurrently in the requesting threads, up to a limit set in Prefs. */
+
+iDeclareType(FilterLaunch)
+
+struct Impl_FilterLaunch {
+    iProcess *proc;
+    iBool     isDone; /* launcher has tried to start the process */
+    iBool     isStarted;
+};
+
+iDeclareType(FilterExecutor)
+iDeclareTypeConstruction(FilterExecutor)
+
+struct Impl_FilterExecutor {
+    iMutex *   mtx;
+    iCondition launchQueued;
+    iCondition changed;    /* a launch was done, or a running filter finished */
+    iPtrArray  queue;      /* FilterLaunch objects owned by the waiting threads */
+    iThread *  launcher;   /* started when first needed */
+    int        numRunning; /* including the ones being launched */
+    iBool      isStopping;
+};
+
+void init_FilterExecutor(iFilterExecutor *d) {
+    d->mtx = new_Mutex();
+    init_Condition(&d->launchQueued);
+    init_Condition(&d->changed);
+    init_PtrArray(&d->queue);
+    d->launcher   = NULL;
+    d->numRunning = 0;
+    d->isStopping = iFalse;
+}
+
+void deinit_FilterExecutor(iFilterExecutor *d) {
+    if (d->launcher) {
+        iGuardMutex(d->mtx, {
+            d->isStopping = iTrue;
+            signal_Condition(&d->launchQueued);
+        });
+        join_Thread(d->launcher);
+        iRelease(d->launcher);
+    }
+    deinit_PtrArray(&d->queue);
+    deinit_Condition(&d->changed);
+    deinit_Condition(&d->launchQueued);
+    delete_Mutex(d->mtx);
+}
+
+iDefineTypeConstruction(FilterExecutor)
+
+static iThreadResult launch_FilterExecutor_(iThread *thread) {
+    iFilterExecutor *d = userData_Thread(thread);
+    lock_Mutex(d->mtx);
+    while (!d->isStopping) {
+        if (isEmpty_PtrArray(&d->queue)) {
+            wait_Condition(&d->launchQueued, d->mtx);
+            continue;
+        }
+        iFilterLaunch *launch = NULL;
+        take_PtrArray(&d->queue, 0, (void **) &launch);
+        launch->isStarted = start_Process(launch->proc);
+        launch->isDone    = iTrue;
+        broadcast_Condition(&d->changed);
+    }
+    /* Pending launches are abandoned. */
+    iForEach(PtrArray, i, &d->queue) {
+        ((iFilterLaunch *) i.ptr)->isDone = iTrue;
+    }
+    clear_PtrArray(&d->queue);
+    broadcast_Condition(&d->changed);
+    unlock_Mutex(d->mtx);
+    return 0;
+}
+
+static iBool start_FilterExecutor_(iFilterExecutor *d, iProcess *proc) {
+    iFilterLaunch launch = { .proc = proc, .isDone = iFalse, .isStarted = iFalse };
+    lock_Mutex(d->mtx);
+    /* Wait for a free slot. */
+    while (!d->isStopping && d->numRunning >= iMax(1, prefs_App()->maxFilterHooks)) {
+        wait_Condition(&d->changed, d->mtx);
+    }
+    if (!d->isStopping) {
+        d->numRunning++;
+        if (!d->launcher) {
+            d->launcher = new_Thread(launch_FilterExecutor_);
+            setUserData_Thread(d->launcher, d);
+            start_Thread(d->launcher);
+        }
+        pushBack_PtrArray(&d->queue, &launch);
+        signal_Condition(&d->launchQueued);
+        while (!launch.isDone) {
+            wait_Condition(&d->changed, d->mtx);
+        }
+        if (!launch.isStarted) {
+            d->numRunning--;
+            broadcast_Condition(&d->changed);
+        }
+    }
+    unlock_Mutex(d->mtx);
+    return launch.isStarted;
+}
+
+static void finish_FilterExecutor_(iFilterExecutor *d) {
+    iGuardMutex(d->mtx, {
+        d->numRunning--;
+        broadcast_Condition(&d->changed);
+    });
+}
+
+/*----------------------------------------------------------------------------------------------*/
 
 iDefineTypeConstruction(FilterHook)
 
@@ -59,19 +174,21 @@ void setCommand_FilterHook(iFilterHook *d, const iString *command) {
     set_String(&d->command, command);
 }
 
-iBlock *run_FilterHook_(const iFilterHook *d, const iString *mime, const iBlock *body,
-                        const iString *requestUrl) {
-    static iMutex *mtx_;
-    if (!mtx_) {
-        /* Currently we are starting child processes from multiple background threads.
-           This is apparently not a great idea when the processes are created as forks.
-           What we _should_ probably be doing is using a single dedicated thread to
-           launch the child processes, via a queue of some sort, and wait for the output
-           to be returned via a Condition. For now, we will avoid concurrency problems
-           (mostly related to I/O pipe fds getting confused) by only running a single
-           filter process at a time. */
-        mtx_ = new_Mutex();
-    }
+iDeclareType(FilterInput)
+
+struct Impl_FilterInput {
+    iProcess *    proc;
+    const iBlock *body;
+};
+
+static iThreadResult writeInput_FilterHook_(iThread *thread) {
+    iFilterInput *d = userData_Thread(thread);
+    writeInput_Process(d->proc, d->body);
+    return 0;
+}
+
+static iBlock *run_FilterHook_(const iFilterHook *d, iFilterExecutor *exec, const iString *mime,
+                               const iBlock *body, const iString *requestUrl) {
     iStringList *args = new_StringList();
     iRangecc     seg  = iNullRange;
     while (nextSplit_Rangecc(range_String(&d->command), ";", &seg)) {
@@ -80,8 +197,7 @@ iBlock *run_FilterHook_(const iFilterHook *d, const iString *mime, const iBlock
     seg = iNullRange;
     while (nextSplit_Rangecc(range_String(mime), ";", &seg)) {
         pushBackRange_StringList(args, seg);
-    }    
-    lock_Mutex(mtx_);
+    }
     iBlock *output = NULL;
     for (int attempts = 0; attempts < 3; attempts++) {
         iProcess *proc = new_Process();
@@ -92,9 +208,17 @@ iBlock *run_FilterHook_(const iFilterHook *d, const iString *mime, const iBlock
                 iClob(newStrings_StringList(
                     collectNewFormat_String("REQUEST_URL=%s", cstr_String(requestUrl)), NULL)));
         }
-        if (start_Process(proc)) {
-            writeInput_Process(proc, body);
+        if (start_FilterExecutor_(exec, proc)) {
+            /* The body is written in another thread while the output is being read, so
+               neither side gets stuck with a full pipe buffer. */
+            iFilterInput input  = { proc, body };
+            iThread *    writer = new_Thread(writeInput_FilterHook_);
+            setUserData_Thread(writer, &input);
+            start_Thread(writer);
             output = readOutputUntilClosed_Process(proc);
+            join_Thread(writer);
+            iRelease(writer);
+            finish_FilterExecutor_(exec);
             if (!startsWith_Rangecc(range_Block(output), "20")) {
                 /* Didn't produce valid output. */
                 delete_Block(output);
@@ -105,118 +229,58 @@ iBlock *run_FilterHook_(const iFilterHook *d, const iString *mime, const iBlock
         }
         iRelease(proc);
     }
-    unlock_Mutex(mtx_);
     iRelease(args);
     return output;
 }
 
 /*----------------------------------------------------------------------------------------------*/
 
-static iRegExp *xmlMimePattern_(void) {
-    static iRegExp *xmlMime_;
-    if (!xmlMime_) {
-        xmlMime_ = new_RegExp("(application|text)/(atom\\+)?xml", caseInsensitive_RegExpOption);
+static void appendFeedEntry_(void *context, const iXmlFeedEntry *entry) {
+    iString *out = context;
+    if (isEmpty_String(&entry->title) || isEmpty_String(&entry->url) || !entry->date.year) {
+        return;
     }
-    return xmlMime_;
+    appendFormat_String(out, "=> %s %04d-%02d-%02d - %s\n",
+                        cstr_String(&entry->url),
+                        entry->date.year,
+                        entry->date.month,
+                        entry->date.day,
+                        cstr_String(&entry->title));
 }
 
-static iBlock *translateAtomXmlToGeminiFeed_(const iString *mime, const iBlock *source,
+static iBlock *translateXmlFeedToGeminiFeed_(const iString *mime, const iBlock *source,
                                              const iString *requestUrl) {
     iUnused(requestUrl); /* TODO: Use for what? */
-    iRegExpMatch m;
-    init_RegExpMatch(&m);
-    if (!matchString_RegExp(xmlMimePattern_(), mime, &m)) {
+    if (!isXmlMimeType_XmlFeed(mime)) {
         return NULL;
     }
-    iBlock *      output = NULL;
-    iXmlDocument *doc    = new_XmlDocument();
-    iString       src;
-    initBlock_String(&src, source); /* assume it's UTF-8 */
-    if (!parse_XmlDocument(doc, &src)) {
-        goto finished;
-    }
-    const iXmlElement *feed = &doc->root;
-    if (!equal_Rangecc(feed->name, "feed")) {
-        goto finished;
-    }
-    if (!equal_Rangecc(attribute_XmlElement(feed, "xmlns"), "http://www.w3.org/2005/Atom")) {
-        goto finished;
-    }
-    iString *title = collect_String(decodedContent_XmlElement(child_XmlElement(feed, "title")));
-    if (isEmpty_String(title)) {
-        goto finished;
-    }
-    iString *subtitle = collect_String(decodedContent_XmlElement(child_XmlElement(feed, "subtitle")));
-    iString out;
-    init_String(&out);
-    format_String(&out,
-                  "20 text/gemini\r\n"
-                  "# %s\n\n",
-                  cstr_String(title));
-    if (!isEmpty_String(subtitle)) {
-        appendFormat_String(&out, "## %s\n\n", cstr_String(subtitle));
-    }
-    appendCStr_String(&out, cstr_Lang("feeds.atom.translated"));
-    appendCStr_String(&out, "\n\n");
-    iRegExp *datePattern =
-        iClob(new_RegExp("^\\s*([0-9][0-9][0-9][0-9]-[0-1][0-9]-[0-3][0-9])(T|\\s).*",
-                         caseSensitive_RegExpOption));
-    iBeginCollect();
-    iConstForEach(PtrArray, i, &feed->children) {
-        iEndCollect();
-        iBeginCollect();
-        const iXmlElement *entry = i.ptr;
-        if (!equal_Rangecc(entry->name, "entry")) {
-            continue;
-        }
-        title = collect_String(decodedContent_XmlElement(child_XmlElement(entry, "title")));
-        if (isEmpty_String(title)) {
-            continue;
-        }
-        const iString *published =
-            collect_String(decodedContent_XmlElement(child_XmlElement(entry, "published")));
-        const iString *updated =
-            collect_String(decodedContent_XmlElement(child_XmlElement(entry, "updated")));
-        iRegExpMatch m;
-        init_RegExpMatch(&m);
-        if (!matchString_RegExp(datePattern, updated, &m)) {
-            init_RegExpMatch(&m);
-            if (!matchString_RegExp(datePattern, published, &m)) {
-                continue;
-            }
-        }
-        iRangecc url = iNullRange;
-        iConstForEach(PtrArray, j, &entry->children) {
-            const iXmlElement *link = j.ptr;
-            if (!equal_Rangecc(link->name, "link")) {
-                continue;
-            }
-            const iRangecc href = attribute_XmlElement(link, "href");
-            const iRangecc rel  = attribute_XmlElement(link, "rel");
-            const iRangecc type = attribute_XmlElement(link, "type");
-            if (startsWithCase_Rangecc(href, "gemini:")) {
-                url = href;
-                /* We're happy with the first gemini URL. */
-                /* TODO: Are we? */
-                break;
-            }
-            url = href;
-            iUnused(rel, type);
-        }
-        if (isEmpty_Range(&url)) {
-            continue;
+    /* Entries are written out as they are parsed; the header needs the feed title,
+       so it is prepended afterwards. */
+    iBlock *        output  = NULL;
+    iXmlFeedParser *parser  = new_XmlFeedParser();
+    iString         entries;
+    init_String(&entries);
+    setEntryHandler_XmlFeedParser(parser, appendFeedEntry_, &entries);
+    if (parse_XmlFeedParser(parser, range_Block(source)) && /* assume it's UTF-8 */
+        !isEmpty_String(title_XmlFeedParser(parser))) {
+        const iString *subtitle = subtitle_XmlFeedParser(parser);
+        iString out;
+        init_String(&out);
+        format_String(&out,
+                      "20 text/gemini\r\n"
+                      "# %s\n\n",
+                      cstr_String(title_XmlFeedParser(parser)));
+        if (!isEmpty_String(subtitle)) {
+            appendFormat_String(&out, "## %s\n\n", cstr_String(subtitle));
         }
-        appendFormat_String(&out, "=> %s %s - %s\n",
-                            cstr_Rangecc(url),
-                            cstr_Rangecc(capturedRange_RegExpMatch(&m, 1)),
-                            cstr_String(title));
+        appendCStr_String(&out, cstr_Lang("feeds.atom.translated"));
+        appendCStr_String(&out, "\n\n");
+        append_String(&out, &entries);
+        output = copy_Block(utf8_String(&out));
+        deinit_String(&out);
     }
-    iEndCollect();
-    output = copy_Block(utf8_String(&out));
-    deinit_String(&out);
-finished:
-    delete_XmlDocument(doc);
-    deinit_String(&src);
+    deinit_String(&entries);
+    delete_XmlFeedParser(parser);
     return output;
 }
 
@@ -239,16 +303,19 @@ iBlock *translateGemPubCoverPage_(const iBlock *source, const iString *requestUr
 static const char *mimeHooksFilename_MimeHooks_ = "mimehooks.txt";
 
 struct Impl_MimeHooks {
-    iPtrArray filters;
+    iPtrArray        filters;
+    iFilterExecutor *executor;
 };
 
 iDefineTypeConstruction(MimeHooks)
 
 void init_MimeHooks(iMimeHooks *d) {
     init_PtrArray(&d->filters);
+    d->executor = new_FilterExecutor();
 }
 
 void deinit_MimeHooks(iMimeHooks *d) {
+    delete_FilterExecutor(d->executor);
     iForEach(PtrArray, i, &d->filters) {
         delete_FilterHook(i.ptr);
     }
@@ -272,8 +339,7 @@ iBool willTryFilter_MimeHooks(const iMimeHooks *d, const iString *mime) {
         }
     }
     /* Built-in filters. */
-    init_RegExpMatch(&m);
-    if (matchString_RegExp(xmlMimePattern_(), mime, &m)) {
+    if (isXmlMimeType_XmlFeed(mime)) {
         return iTrue;
     }
     return iFalse;
@@ -286,7 +352,7 @@ iBlock *tryFilter_MimeHooks(const iMimeHooks *d, const iString *mime, const iBlo
         const iFilterHook *xc = i.ptr;
         init_RegExpMatch(&m);
         if (matchString_RegExp(xc->mimeRegex, mime, &m)) {
-            iBlock *result = run_FilterHook_(xc, mime, body, requestUrl);
+            iBlock *result = run_FilterHook_(xc, d->executor, mime, body, requestUrl);
             if (result) {
                 return result;
             }
@@ -299,9 +365,8 @@ iBlock *tryFilter_MimeHooks(const iMimeHooks *d, const iString *mime, const iBlo
             return result;
         }
     }
-    init_RegExpMatch(&m);
-    if (matchString_RegExp(xmlMimePattern_(), mime, &m)) {
-        iBlock *result = translateAtomXmlToGeminiFeed_(mime, body, requestUrl);
+    if (isXmlMimeType_XmlFeed(mime)) {
+        iBlock *result = translateXmlFeedToGeminiFeed_(mime, body, requestUrl);
         if (result) {
             return result;
         }
@@ -106,6 +106,7 @@ void init_Prefs(iPrefs *d) {
     d->maxCacheSize      = 10;
     d->maxMemorySize     = 200;
     d->maxUrlSize        = 8192;
+    d->maxFilterHooks    = 2;
     setCStr_String(&d->strings[uiFont_PrefsString], "default");
     setCStr_String(&d->strings[headingFont_PrefsString], "default");
     setCStr_String(&d->strings[bodyFont_PrefsString], "default");
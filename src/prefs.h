@@ -227,6 +227,7 @@ struct Impl_Prefs {
     int              maxCacheSize; /* MB */
     int              maxMemorySize; /* MB */
     int              maxUrlSize; /* bytes; longer ones will be disregarded */
+    int              maxFilterHooks; /* number of MIME filter processes running at once */
     /* Style */
     iStringSet *     disabledFontPacks;
     int              gemtextAnsiEscapes;
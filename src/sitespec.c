@@ -22,7 +22,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 #include "sitespec.h"
 #include "gmutil.h"
+#include "inicache.h"
 
+#include <the_Foundation/buffer.h>
 #include <the_Foundation/file.h>
 #include <the_Foundation/path.h>
 #include <the_Foundation/stringhash.h>
@@ -70,6 +72,27 @@ static size_t findUsedIdentity_SiteParams_(const iSiteParams *d, const iString *
     return iInvalidPos;
 }
 
+static void setUsedIdentities_SiteParams_(iSiteParams *d, const iString *joined) {
+    iRangecc seg = iNullRange;
+    while (nextSplit_Rangecc(range_String(joined), " ", &seg)) {
+        pushBack_StringArray(&d->usedIdentities, collectNewRange_String(seg));
+    }
+}
+
+static void setPromptPaths_SiteParams_(iSiteParams *d, const iString *joined) {
+    iRangecc seg = iNullRange;
+    while (nextSplit_Rangecc(range_String(joined), " ", &seg)) {
+        insert_StringSet(&d->promptPaths, collectNewRange_String(seg));
+    }
+}
+
+static iBool isDefault_SiteParams_(const iSiteParams *d) {
+    /* Default parameters are omitted from sitespec.ini. */
+    return !d->titanPort && isEmpty_String(&d->titanIdentity) && !d->dismissWarnings &&
+           d->tlsSessionCache && isEmpty_StringArray(&d->usedIdentities) &&
+           isEmpty_StringSet(&d->promptPaths) && isEmpty_String(&d->paletteSeed);
+}
+
 iDefineClass(SiteParams)
 iDefineObjectConstruction(SiteParams)
 
@@ -84,6 +107,7 @@ struct Impl_SiteSpec {
 
 static iSiteSpec   siteSpec_;
 static const char *fileName_SiteSpec_ = "sitespec.ini";
+static const uint32_t cacheVersion_SiteSpec_ = 1; /* see `serializeCache_SiteSpec_` */
 
 static void loadOldFormat_SiteSpec_(iSiteSpec *d) {
     clear_StringHash(&d->sites);
@@ -160,27 +184,95 @@ static void handleIniKeyValue_SiteSpec_(void *context, const iString *table, con
         d->loadParams->tlsSessionCache = value->value.boolean;
     }
     else if (!cmp_String(key, "usedIdentities") && value->type == string_TomlType) {
-        iRangecc seg = iNullRange;
-        while (nextSplit_Rangecc(range_String(value->value.string), " ", &seg)) {
-            pushBack_StringArray(&d->loadParams->usedIdentities, collectNewRange_String(seg));
-        }
+        setUsedIdentities_SiteParams_(d->loadParams, value->value.string);
     }
     else if (!cmp_String(key, "paletteSeed") && value->type == string_TomlType) {
         set_String(&d->loadParams->paletteSeed, value->value.string);
     }
     else if (!cmp_String(key, "promptPaths") && value->type == string_TomlType) {
-        iRangecc seg = iNullRange;
-        while (nextSplit_Rangecc(range_String(value->value.string), " ", &seg)) {
-            insert_StringSet(&d->loadParams->promptPaths, collectNewRange_String(seg));
+        setPromptPaths_SiteParams_(d->loadParams, value->value.string);
+    }
+}
+
+static void serializeCache_SiteSpec_(const iSiteSpec *d, iStream *outs) {
+    /* Lists are kept joined like in sitespec.ini, so they get split the same way. */
+    uint32_t count = 0;
+    iConstForEach(StringHash, i, &d->sites) {
+        if (!isDefault_SiteParams_(i.value->object)) {
+            count++;
         }
     }
+    writeU32_Stream(outs, count);
+    iConstForEach(StringHash, j, &d->sites) {
+        const iSiteParams *params = j.value->object;
+        if (isDefault_SiteParams_(params)) {
+            continue;
+        }
+        iBeginCollect();
+        serialize_Block(&j.value->keyBlock, outs);
+        writeU16_Stream(outs, params->titanPort);
+        serialize_String(&params->titanIdentity, outs);
+        write32_Stream(outs, params->dismissWarnings);
+        writeU8_Stream(outs, params->tlsSessionCache ? 1 : 0);
+        serialize_String(collect_String(joinCStr_StringArray(&params->usedIdentities, " ")), outs);
+        serialize_String(collect_String(joinCStr_StringSet(&params->promptPaths, " ")), outs);
+        serialize_String(&params->paletteSeed, outs);
+        iEndCollect();
+    }
+}
+
+static void deserializeCache_SiteSpec_(iSiteSpec *d, iStream *ins) {
+    iString *key    = new_String();
+    iString *joined = new_String();
+    const uint32_t count = readU32_Stream(ins);
+    for (uint32_t i = 0; i < count; i++) {
+        iSiteParams *params = new_SiteParams();
+        deserialize_Block(&key->chars, ins);
+        params->titanPort = readU16_Stream(ins);
+        deserialize_String(&params->titanIdentity, ins);
+        params->dismissWarnings = read32_Stream(ins);
+        params->tlsSessionCache = readU8_Stream(ins) != 0;
+        deserialize_String(joined, ins);
+        setUsedIdentities_SiteParams_(params, joined);
+        deserialize_String(joined, ins);
+        setPromptPaths_SiteParams_(params, joined);
+        deserialize_String(&params->paletteSeed, ins);
+        insert_StringHash(&d->sites, key, params);
+        iRelease(params);
+    }
+    delete_String(joined);
+    delete_String(key);
+}
+
+static void saveCache_SiteSpec_(const iSiteSpec *d, const iString *path, const iBlock *src) {
+    iBuffer *buf = new_Buffer();
+    openEmpty_Buffer(buf);
+    serializeCache_SiteSpec_(d, stream_Buffer(buf));
+    save_IniCache(cstr_String(path), src, cacheVersion_SiteSpec_, data_Buffer(buf));
+    iRelease(buf);
 }
 
 static iBool load_SiteSpec_(iSiteSpec *d) {
     iBool ok = iFalse;
-    iFile *f = new_File(collect_String(concatCStr_Path(&d->saveDir, fileName_SiteSpec_)));
+    const iString *path = collect_String(concatCStr_Path(&d->saveDir, fileName_SiteSpec_));
+    iFile *f = new_File(path);
     if (open_File(f, readOnly_FileMode | text_FileMode)) {
-        ok = deserialize_SiteSpec(stream_File(f), all_ImportMethod);
+        const iBlock *src   = collect_Block(readAll_File(f));
+        iBuffer      *cache = open_IniCache(cstr_String(path), src, cacheVersion_SiteSpec_);
+        if (cache) {
+            deserializeCache_SiteSpec_(d, stream_Buffer(cache));
+            iRelease(cache);
+            ok = iTrue;
+        }
+        else {
+            iBuffer *buf = new_Buffer();
+            open_Buffer(buf, src);
+            ok = deserialize_SiteSpec(stream_Buffer(buf), all_ImportMethod);
+            iRelease(buf);
+            if (ok) {
+                saveCache_SiteSpec_(d, path, src);
+            }
+        }
     }
     iRelease(f);
     iAssert(d->loadParams == NULL);
@@ -247,11 +339,17 @@ void serialize_SiteSpec(iStream *out) {
 }
 
 static void save_SiteSpec_(iSiteSpec *d) {
-    iFile *f = new_File(collect_String(concatCStr_Path(&d->saveDir, fileName_SiteSpec_)));
+    const iString *path = collect_String(concatCStr_Path(&d->saveDir, fileName_SiteSpec_));
+    iBuffer *ini = new_Buffer();
+    openEmpty_Buffer(ini);
+    serialize_SiteSpec(stream_Buffer(ini));
+    iFile *f = new_File(path);
     if (open_File(f, writeOnly_FileMode | text_FileMode)) {
-        serialize_SiteSpec(stream_File(f));
+        write_File(f, data_Buffer(ini));
     }
     iRelease(f);
+    saveCache_SiteSpec_(d, path, data_Buffer(ini));
+    iRelease(ini);
 }
 
 void init_SiteSpec(const char *saveDir) {
@@ -135,6 +135,7 @@ void init_DocumentView(iDocumentView *d) {
 
 void deinit_DocumentView(iDocumentView *d) {
     removeTicker_App(prerender_DocumentView, d);
+    removeTicker_App(continueLayout_DocumentView, d);
     delete_DrawBufs(d->drawBufs);
     delete_VisBuf(d->visBuf);
     free(d->visBufMeta);
@@ -402,7 +403,7 @@ void updateHover_DocumentView(iDocumentView *d, iInt2 mouse) {
         /* Look for any selectable text run. */
         for (const iGmRun *v = d->visibleRuns.start; v && v != d->visibleRuns.end; v++) {
             if (~v->flags & decoration_GmRunFlag && !isEmpty_Range(&v->text) &&
-                contains_Rect(v->bounds, hoverPos)) {
+                contains_Rect(bounds_GmRun(v), hoverPos)) {
                 selectableRun = v;
                 break;
             }
@@ -410,7 +411,7 @@ void updateHover_DocumentView(iDocumentView *d, iInt2 mouse) {
         iConstForEach(PtrArray, i, &d->visibleLinks) {
             const iGmRun *run = i.ptr;
             /* Click targets are slightly expanded so there are no gaps between links. */
-            if (contains_Rect(expanded_Rect(run->bounds, init1_I2(gap_Text / 2)), hoverPos)) {
+            if (contains_Rect(expanded_Rect(bounds_GmRun(run), init1_I2(gap_Text / 2)), hoverPos)) {
                 d->hoverLink = run;
                 break;
             }
@@ -430,7 +431,7 @@ void updateHover_DocumentView(iDocumentView *d, iInt2 mouse) {
     if (isHoverAllowed_DocumentWidget(d->owner) && contains_Widget(w, mouse)) {
         iConstForEach(PtrArray, j, &d->visiblePre) {
             const iGmRun *run = j.ptr;
-            if (contains_Rangei(ySpan_Rect(run->bounds), hoverPos.y) &&
+            if (contains_Rangei(ySpan_Rect(bounds_GmRun(run)), hoverPos.y) &&
                 (run->flags & wide_GmRunFlag || contains_Rangei(xSpan_Rect(docBounds), mouse.x))) {
                 d->hoverPre    = run;
                 d->hoverAltPre = run;
@@ -500,7 +501,41 @@ int updateScrollMax_DocumentView(iDocumentView *d) {
     return scrollMax;
 }
 
+static iBool layoutMore_DocumentView_(iDocumentView *d, int untilY) {
+    const iGmRunRange runs   = runRange_GmDocument(d->doc);
+    const int         oldEnd = (runs.start != runs.end ? bottom_Rect(runs.end[-1].visBounds) : 0);
+    if (!continueLayout_DocumentWidget(d->owner, untilY, NULL)) {
+        return iFalse;
+    }
+    /* Buffers may have been drawn where there were no runs yet. */
+    const iRangei visRange = visibleRange_DocumentView(d);
+    if (oldEnd < visRange.end + 2 * size_Range(&visRange)) {
+        invalidate_DocumentView(d);
+    }
+    return iTrue;
+}
+
+void continueLayout_DocumentView(iAny *context) {
+    iDocumentView *d = context;
+    if (current_Root() == NULL) {
+        return;
+    }
+    if (layoutMore_DocumentView_(d, 0)) {
+        updateVisible_DocumentView(d);
+        refresh_Widget(d->owner);
+    }
+    if (!isLayoutComplete_GmDocument(d->doc)) {
+        addTicker_App(continueLayout_DocumentView, d);
+    }
+}
+
 void updateVisible_DocumentView(iDocumentView *d) {
+    if (!isLayoutComplete_GmDocument(d->doc)) {
+        /* Lay out enough to fill the view and the rest in the background. */
+        const iRangei visRange = visibleRange_DocumentView(d);
+        layoutMore_DocumentView_(d, visRange.end + size_Range(&visRange));
+        addTicker_App(continueLayout_DocumentView, d);
+    }
     const int scrollMax = updateScrollMax_DocumentView(d);
     aboutToScrollView_DocumentWidget(d->owner, scrollMax); /* TODO: A widget may have many views. */
     unhover_DocumentView_(d);
@@ -640,7 +675,7 @@ iBool isWideBlockScrollable_DocumentView(const iDocumentView *d, const iRect doc
     int               maxWidth   = width_Rect(meta->pixelRect);
     const iRect       pageBounds = shrunk_Rect(bounds_Widget(as_Widget(d->owner)),
                                                init1_I2(d->pageMargin * gap_UI));
-    return left_Rect(docBounds) + run->bounds.pos.x + meta->initialOffset + maxWidth >
+    return left_Rect(docBounds) + bounds_GmRun(run).pos.x + meta->initialOffset + maxWidth >
            right_Rect(pageBounds);
 }
 
@@ -657,7 +692,7 @@ iBool scrollWideBlock_DocumentView(iDocumentView *d, iInt2 mousePos, int delta,
     }
     iConstForEach(PtrArray, i, &d->visibleWideRuns) {
         const iGmRun *run = i.ptr;
-        if (contains_Rangei(ySpan_Rect(run->bounds), docPos.y)) {
+        if (contains_Rangei(ySpan_Rect(bounds_GmRun(run)), docPos.y)) {
             /* We can scroll this run. First find out how much is allowed. */
             const iGmPreMeta *meta = preMeta_GmDocument(d->doc, preId_GmRun(run));
             const iGmRunRange range = meta->runRange;
@@ -665,7 +700,7 @@ iBool scrollWideBlock_DocumentView(iDocumentView *d, iInt2 mousePos, int delta,
             if (!isWideBlockScrollable_DocumentView(d, docBounds, run)) {
                 return iFalse;
             }
-            const int maxOffset = maxWidth + run->bounds.pos.x - docWidth;
+            const int maxOffset = maxWidth + bounds_GmRun(run).pos.x - docWidth;
             int *offset = wideRunOffset_DocumentView_(d, preId_GmRun(run));
             const int oldOffset = *offset;
             *offset = iClamp(*offset + delta, 0, maxOffset);
@@ -719,10 +754,10 @@ struct Impl_MiddleRunParams {
 
 static void find_MiddleRunParams_(void *params, const iGmRun *run) {
     iMiddleRunParams *d = params;
-    if (isEmpty_Rect(run->bounds)) {
+    if (isEmpty_Rect(bounds_GmRun(run))) {
         return;
     }
-    const int distance = iAbs(mid_Rect(run->bounds).y - d->midY);
+    const int distance = iAbs(mid_Rect(bounds_GmRun(run)).y - d->midY);
     if (!d->closest || distance < d->distance) {
         d->closest  = run;
         d->distance = distance;
@@ -784,6 +819,9 @@ iBool updateDocumentWidthRetainingScrollPosition_DocumentView(iDocumentView *d,
     setWidth_GmDocument(d->doc, newWidth, width_Widget(d->owner));
     setWidth_Banner(d->banner, newWidth);
     documentRunsInvalidated_DocumentWidget(d->owner);
+    if (runLoc) {
+        continueLayout_GmDocument(d->doc, 0, runLoc);
+    }
     if (runLoc && !keepCenter) {
         run = findRunAtLoc_GmDocument(d->doc, runLoc);
         if (run) {
@@ -794,7 +832,7 @@ iBool updateDocumentWidthRetainingScrollPosition_DocumentView(iDocumentView *d,
     else if (runLoc && keepCenter) {
         run = findRunAtLoc_GmDocument(d->doc, runLoc);
         if (run) {
-            scrollTo_DocumentView(d, mid_Rect(run->bounds).y, iTrue);
+            scrollTo_DocumentView(d, mid_Rect(bounds_GmRun(run)).y, iTrue);
         }
     }
     return iTrue;
@@ -802,7 +840,7 @@ iBool updateDocumentWidthRetainingScrollPosition_DocumentView(iDocumentView *d,
 
 iRect runRect_DocumentView(const iDocumentView *d, const iGmRun *run) {
     const iRect docBounds = documentBounds_DocumentView(d);
-    return moved_Rect(run->bounds, addY_I2(topLeft_Rect(docBounds), viewPos_DocumentView(d)));
+    return moved_Rect(bounds_GmRun(run), addY_I2(topLeft_Rect(docBounds), viewPos_DocumentView(d)));
 }
 
 iDeclareType(DrawContext)
@@ -864,8 +902,8 @@ static void fillRange_DrawContext_(iDrawContext *d, const iGmRun *run, enum iCol
         }
         if (~run->flags & decoration_GmRunFlag) {
             const iInt2 visPos =
-                add_I2(run->bounds.pos, addY_I2(d->viewPos, viewPos_DocumentView(d->view)));
-            const iRect rangeRect = { addX_I2(visPos, x), init_I2(w, height_Rect(run->bounds)) };
+                add_I2(bounds_GmRun(run).pos, addY_I2(d->viewPos, viewPos_DocumentView(d->view)));
+            const iRect rangeRect = { addX_I2(visPos, x), init_I2(w, height_Rect(bounds_GmRun(run))) };
             if (rangeRect.size.x) {
                 fillRect_Paint(&d->paint, rangeRect, color);
                 /* Keep track of the first and last marked rects. */
@@ -1172,11 +1210,11 @@ static void drawRun_DrawContext_(void *context, const iGmRun *run) {
             if (size.x) {
                 fillRect_Paint(
                     &d->paint,
-                    (iRect){ add_I2(origin, addX_I2(topRight_Rect(run->bounds), -size.x - gap_UI)),
+                    (iRect){ add_I2(origin, addX_I2(topRight_Rect(bounds_GmRun(run)), -size.x - gap_UI)),
                             addX_I2(size, 2 * gap_UI) },
                     tmBackground_ColorId);
                 drawAlign_Text(metaFont,
-                               add_I2(topRight_Rect(run->bounds), origin),
+                               add_I2(topRight_Rect(bounds_GmRun(run)), origin),
                                fg,
                                right_Alignment,
                                "%s", cstr_String(&text));
@@ -1201,7 +1239,7 @@ static void drawRun_DrawContext_(void *context, const iGmRun *run) {
     }
     /* Debug. */
     if (0) {
-        drawRect_Paint(&d->paint, (iRect){ visPos, run->bounds.size }, green_ColorId);
+        drawRect_Paint(&d->paint, (iRect){ visPos, bounds_GmRun(run).size }, green_ColorId);
         drawRect_Paint(&d->paint, (iRect){ visPos, run->visBounds.size },
                        run->linkId ? orange_ColorId : red_ColorId);
     }
@@ -118,4 +118,5 @@ size_t  visibleLinkOrdinal_DocumentView (const iDocumentView *, iGmLinkId linkId
 
 uint32_t lastRenderTime_DocumentView    (const iDocumentView *);
 void    prerender_DocumentView          (iAny *); /* ticker */
+void    continueLayout_DocumentView     (iAny *); /* ticker */
 void    draw_DocumentView               (const iDocumentView *, int horizOffset);
@@ -92,7 +92,9 @@ iDeclareTypeConstruction(PersistentDocumentState)
 iDeclareTypeSerialization(PersistentDocumentState)
 
 static void serializeWithContent_PersistentDocumentState_(const iPersistentDocumentState *,
-                                                          iStream *outs, iBool withContent);
+                                                          iStream *outs, iBool withContent,
+                                                          iStream *contentOuts,
+                                                          size_t contentBase);
 
 enum iReloadInterval {
     never_RelodPeriod,
@@ -151,11 +153,12 @@ void deinit_PersistentDocumentState(iPersistentDocumentState *d) {
 }
 
 void serialize_PersistentDocumentState(const iPersistentDocumentState *d, iStream *outs) {
-    serializeWithContent_PersistentDocumentState_(d, outs, iTrue);
+    serializeWithContent_PersistentDocumentState_(d, outs, iTrue, NULL, 0);
 }
 
 void serializeWithContent_PersistentDocumentState_(const iPersistentDocumentState *d, iStream *outs,
-                                                   iBool withContent) {
+                                                   iBool withContent, iStream *contentOuts,
+                                                   size_t contentBase) {
     serialize_String(d->url, outs);
     uint16_t params = (d->reloadInterval & 7) | (iClamp(d->generation, 0, 15) << 4);
     writeU16_Stream(outs, params);
@@ -165,7 +168,12 @@ void serializeWithContent_PersistentDocumentState_(const iPersistentDocumentStat
         serialize_Block(d->setIdentity ? d->setIdentity : &empty, outs);
         deinit_Block(&empty);
     }
-    serializeWithContent_History(d->history, outs, withContent);
+    if (withContent) {
+        serializeWithContent_History(d->history, outs, iTrue);
+    }
+    else {
+        serializeWithContentStream_History(d->history, outs, contentOuts, contentBase);
+    }
 }
 
 void deserialize_PersistentDocumentState(iPersistentDocumentState *d, iStream *ins) {
@@ -207,6 +215,7 @@ enum iDocumentWidgetFlag {
     showLinkNumbers_DocumentWidgetFlag       = iBit(3),
     setHoverViaKeys_DocumentWidgetFlag       = iBit(4),
     newTabViaHomeKeys_DocumentWidgetFlag     = iBit(5),
+    pendingRestore_DocumentWidgetFlag        = iBit(6), /* restored from saved state, not shown yet */
     selectWords_DocumentWidgetFlag           = iBit(7),
     selectLines_DocumentWidgetFlag           = iBit(8),
     pinchZoom_DocumentWidgetFlag             = iBit(9),
@@ -289,6 +298,7 @@ struct Impl_DocumentWidget {
     /* Document: */
     iPersistentDocumentState mod;
     iString *      titleUser;
+    iString *      placeholderTitle; /* saved title of a restored tab until it is shown */
     enum iGmStatusCode sourceStatus;
     iString        sourceHeader;
     iString        sourceMime;
@@ -498,6 +508,47 @@ void documentRunsInvalidated_DocumentWidget(iDocumentWidget *d) {
     documentRunsInvalidated_DocumentView(d->view);
 }
 
+static size_t runIndex_DocumentWidget_(const iGmRun *runs, const iGmRun *run) {
+    return run ? (size_t) (run - runs) : iInvalidPos;
+}
+
+static const iGmRun *rebasedRun_DocumentWidget_(const iGmRun *runs, size_t index) {
+    return index != iInvalidPos ? runs + index : NULL;
+}
+
+iBool continueLayout_DocumentWidget(iDocumentWidget *d, int untilY, const char *untilLoc) {
+    /* Laying out more of the document may reallocate the runs. Source ranges like the
+       selection remain valid, but pointers to runs must be updated. */
+    iDocumentView *view          = d->view;
+    const iGmRun  *runs          = runRange_GmDocument(view->doc).start;
+    const size_t   linkIndex     = runIndex_DocumentWidget_(runs, d->contextLink);
+    const size_t   playerIndex   = runIndex_DocumentWidget_(runs, d->grabbedPlayer);
+    const size_t   animWideStart = runIndex_DocumentWidget_(runs, view->animWideRunRange.start);
+    const size_t   animWideEnd   = runIndex_DocumentWidget_(runs, view->animWideRunRange.end);
+    iArray         invalidIndices;
+    init_Array(&invalidIndices, sizeof(size_t));
+    iConstForEach(PtrSet, r, view->invalidRuns) {
+        const size_t index = runIndex_DocumentWidget_(runs, *r.value);
+        pushBack_Array(&invalidIndices, &index);
+    }
+    const iBool isProgress = continueLayout_GmDocument(view->doc, untilY, untilLoc);
+    if (isProgress) {
+        runs = runRange_GmDocument(view->doc).start;
+        d->contextLink   = rebasedRun_DocumentWidget_(runs, linkIndex);
+        d->grabbedPlayer = rebasedRun_DocumentWidget_(runs, playerIndex);
+        view->animWideRunRange.start = rebasedRun_DocumentWidget_(runs, animWideStart);
+        view->animWideRunRange.end   = rebasedRun_DocumentWidget_(runs, animWideEnd);
+        clear_PtrSet(view->invalidRuns);
+        iConstForEach(Array, i, &invalidIndices) {
+            insert_PtrSet(view->invalidRuns,
+                          rebasedRun_DocumentWidget_(runs, *(const size_t *) i.value));
+        }
+        documentRunsInvalidated_DocumentView(view);
+    }
+    deinit_Array(&invalidIndices);
+    return isProgress;
+}
+
 static void enableActions_DocumentWidget_(iDocumentWidget *d, iBool enable) {
     /* Actions are invisible child widgets of the DocumentWidget. */
     iForEach(ObjectList, i, children_Widget(d)) {
@@ -698,6 +749,9 @@ static void updateWindowTitle_DocumentWidget_(const iDocumentWidget *d) {
     if (!isEmpty_String(title_GmDocument(d->view->doc))) {
         pushBack_StringArray(title, title_GmDocument(d->view->doc));
     }
+    else if (d->placeholderTitle && !isEmpty_String(d->placeholderTitle)) {
+        pushBack_StringArray(title, d->placeholderTitle);
+    }
     if (!isEmpty_String(d->titleUser)) {
         pushBack_StringArray(title, d->titleUser);
     }
@@ -1828,6 +1882,7 @@ static void updateFromCachedResponse_DocumentWidget_(iDocumentWidget *d, float n
 }
 
 static iBool updateFromHistory_DocumentWidget_(iDocumentWidget *d, iBool useCachedDoc) {
+    loadContent_History(d->mod.history);
     const iRecentUrl *recent = constMostRecentUrl_History(d->mod.history);
     setIdentity_DocumentWidget(d, recent ? &recent->setIdentity : NULL);
     if (recent && recent->cachedResponse && equalCase_String(&recent->url, d->mod.url)) {
@@ -2905,6 +2960,13 @@ static iBool handleCommand_DocumentWidget_(iDocumentWidget *d, const char *cmd)
     else if (equal_Command(cmd, "tabs.changed")) {
         setLinkNumberMode_DocumentWidget_(d, iFalse);
         if (cmp_String(id_Widget(w), suffixPtr_Command(cmd, "id")) == 0) {
+            if (d->flags & pendingRestore_DocumentWidgetFlag) {
+                /* Restored tabs are only loaded when they are first shown. */
+                d->flags &= ~pendingRestore_DocumentWidgetFlag;
+                delete_String(d->placeholderTitle);
+                d->placeholderTitle = NULL;
+                updateFromHistory_DocumentWidget_(d, iTrue);
+            }
             /* Set palette for our document. */
             updateTheme_DocumentWidget_(d);
             updateTrust_DocumentWidget_(d, NULL);
@@ -3397,6 +3459,25 @@ static iBool handleCommand_DocumentWidget_(iDocumentWidget *d, const char *cmd)
             }
         }
     }
+    else if (equal_Command(cmd, "media.player.seeked")) {
+        if (!argLabel_Command(cmd, "ok") && argLabel_Command(cmd, "start")) {
+            /* Rewinding failed, so play again from the beginning. */
+            const iPlayer *seekedPlr = pointerLabel_Command(cmd, "player");
+            const iMedia * media     = media_GmDocument(d->view->doc);
+            const size_t   num       = numAudio_Media(media);
+            for (size_t id = 1; id <= num; id++) {
+                iPlayer *plr = audioPlayer_Media(media, (iMediaId){ audio_MediaType, id });
+                if (plr == seekedPlr) {
+                    stop_Player(plr);
+                    start_Player(plr);
+                    setPaused_Player(plr, iTrue);
+                    refresh_Widget(d);
+                    break;
+                }
+            }
+        }
+        return iFalse;
+    }
 #endif
     else if (equal_Command(cmd, "media.player.update")) {
         updateMedia_DocumentWidget_(d);
@@ -3665,6 +3746,9 @@ static iBool handleCommand_DocumentWidget_(iDocumentWidget *d, const char *cmd)
             return iTrue;
         }
         const char *loc = pointerLabel_Command(cmd, "loc");
+        if (loc) {
+            continueLayout_DocumentWidget(d, 0, loc);
+        }
         const iGmRun *run = findRunAtLoc_GmDocument(d->view->doc, loc);
         if (run) {
             scrollTo_DocumentView(d->view, run->visBounds.pos.y, iFalse);
@@ -3690,8 +3774,9 @@ static iBool handleCommand_DocumentWidget_(iDocumentWidget *d, const char *cmd)
             }
             if (d->foundMark.start) {
                 const iGmRun *found;
+                continueLayout_DocumentWidget(d, 0, d->foundMark.start);
                 if ((found = findRunAtLoc_GmDocument(d->view->doc, d->foundMark.start)) != NULL) {
-                    scrollTo_DocumentView(d->view, mid_Rect(found->bounds).y, iTrue);
+                    scrollTo_DocumentView(d->view, mid_Rect(bounds_GmRun(found)).y, iTrue);
                     updateVisible_DocumentView(d->view);
                 }
             }
@@ -4006,8 +4091,10 @@ static iBool processMediaEvents_DocumentWidget_(iDocumentWidget *d, const SDL_Ev
             }
             else if (contains_Rect(ui.rewindRect, mouse)) {
                 if (isStarted_Player(plr) && time_Player(plr) > 0.5f) {
-                    stop_Player(plr);
-                    start_Player(plr);
+                    if (!seek_Player(plr, 0.0f)) {
+                        stop_Player(plr);
+                        start_Player(plr);
+                    }
                     setPaused_Player(plr, iTrue);
                 }
                 refresh_Widget(d);
@@ -4040,6 +4127,15 @@ static iBool processMediaEvents_DocumentWidget_(iDocumentWidget *d, const SDL_Ev
                 openMenu_Widget(d->playerMenu, bottomLeft_Rect(ui.menuRect));
                 return iTrue;
             }
+            else if (contains_Rect(ui.scrubberRect, mouse)) {
+                const float seekTime = seekTime_PlayerUI(&ui, mouse);
+                if (isStarted_Player(plr) && seekTime >= 0) {
+                    seek_Player(plr, seekTime);
+                    animateMedia_DocumentWidget_(d);
+                }
+                refresh_Widget(d);
+                return iTrue;
+            }
         }
 #endif /* LAGRANGE_ENABLE_AUDIO */
     }
@@ -5239,6 +5335,7 @@ void init_DocumentWidget(iDocumentWidget *d) {
     d->certSubject         = new_String();
     d->state               = blank_RequestState;
     d->titleUser           = new_String();
+    d->placeholderTitle    = NULL;
     d->request             = NULL;
     d->requestLinkId       = 0;
     d->media               = new_ObjectList();
@@ -5324,6 +5421,7 @@ void deinit_DocumentWidget(iDocumentWidget *d) {
     delete_Block(d->certFullFingerprint);
     delete_Block(d->certFingerprint);
     delete_String(d->certSubject);
+    delete_String(d->placeholderTitle);
     delete_String(d->titleUser);
     deinit_PersistentDocumentState(&d->mod);
 }
@@ -5422,21 +5520,32 @@ const iString *bookmarkTitle_DocumentWidget(const iDocumentWidget *d) {
     return collect_String(joinCStr_StringArray(title, " \u2014 "));
 }
 
-void serializeState_DocumentWidget(const iDocumentWidget *d, iStream *outs, iBool withContent) {
-    serializeWithContent_PersistentDocumentState_(&d->mod, outs, withContent);
+void serializeState_DocumentWidget(const iDocumentWidget *d, iStream *outs, iStream *contentOuts,
+                                   size_t contentBase) {
+    serializeWithContent_PersistentDocumentState_(&d->mod, outs, iFalse, contentOuts, contentBase);
+    serialize_String(d->placeholderTitle ? d->placeholderTitle : title_GmDocument(d->view->doc),
+                     outs);
 }
 
 void deserializeState_DocumentWidget(iDocumentWidget *d, iStream *ins) {
+    iPersistentDocumentState *mod   = (d ? &d->mod : new_PersistentDocumentState());
+    iString                  *title = new_String();
+    deserialize_PersistentDocumentState(mod, ins);
+    if (version_Stream(ins) >= separateContentFile_FileVersion) {
+        deserialize_String(title, ins);
+    }
     if (d) {
-        deserialize_PersistentDocumentState(&d->mod, ins);
         parseUser_DocumentWidget_(d);
-        updateFromHistory_DocumentWidget_(d, iTrue);
+        /* The tab is a placeholder until it is shown, and only then is the content loaded. */
+        d->flags |= pendingRestore_DocumentWidgetFlag;
+        delete_String(d->placeholderTitle);
+        d->placeholderTitle = title;
+        updateWindowTitle_DocumentWidget_(d);
     }
     else {
         /* Read and throw away the data. */
-        iPersistentDocumentState *dummy = new_PersistentDocumentState();
-        deserialize_PersistentDocumentState(dummy, ins);
-        delete_PersistentDocumentState(dummy);
+        delete_PersistentDocumentState(mod);
+        delete_String(title);
     }
 }
 
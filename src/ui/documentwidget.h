@@ -39,7 +39,8 @@ iDeclareObjectConstruction(DocumentWidget)
 iDocumentWidget *   duplicate_DocumentWidget        (const iDocumentWidget *);
 void                cancelAllRequests_DocumentWidget(iDocumentWidget *);
 
-void    serializeState_DocumentWidget   (const iDocumentWidget *, iStream *outs, iBool withContent);
+void    serializeState_DocumentWidget   (const iDocumentWidget *, iStream *outs, iStream *contentOuts,
+                                         size_t contentBase);
 void    deserializeState_DocumentWidget (iDocumentWidget *, iStream *ins);
 
 iHistory *          history_DocumentWidget          (iDocumentWidget *);
@@ -103,6 +104,7 @@ void    setSource_DocumentWidget        (iDocumentWidget *, const iString *sourc
 void    takeRequest_DocumentWidget      (iDocumentWidget *, iGmRequest *finishedRequest); /* ownership given */
 
 void    documentRunsInvalidated_DocumentWidget  (iDocumentWidget *);
+iBool   continueLayout_DocumentWidget           (iDocumentWidget *, int untilY, const char *untilLoc);
 void    updateSize_DocumentWidget               (iDocumentWidget *);
 void    updateHoverLinkInfo_DocumentWidget      (iDocumentWidget *, uint16_t linkId);
 void    scrollBegan_DocumentWidget              (iAnyObject *, int, uint32_t); /* SmoothScroll callback */
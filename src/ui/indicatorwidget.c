@@ -62,6 +62,7 @@ void init_IndicatorWidget(iIndicatorWidget *d) {
     init_Widget(w);
     init_Anim(&d->pos, 0);
     setFlags_Widget(w, unhittable_WidgetFlag, iTrue);
+    w->flags2 |= drawsWithinBounds_WidgetFlag2;
 }
 
 void deinit_IndicatorWidget(iIndicatorWidget *d) {
@@ -96,17 +96,21 @@ iDeclareType(InputLine)
 struct Impl_InputLine {
     iString text;
     iRanges range;      /* byte offset inside the entire content; for marking */
-    iRangei wrapLines;  /* range of visual wrapped lines */
+    int     numWraps;   /* number of visual wrapped lines; the first one is found via `wrapSums` */
+    iInputWidgetHighlight highlight;
+    unsigned              highlightGen; /* `highlight` is valid if matches the widget's */
 };
 
 static void init_InputLine(iInputLine *d) {
     iZap(d->range);
     init_String(&d->text);
-    d->wrapLines = (iRangei){ 0, 1 };
+    d->numWraps = 1;
+    iZap(d->highlight);
+    d->highlightGen = 0;
 }
 
 iLocalDef int numWrapLines_InputLine_(const iInputLine *d) {
-    return size_Range(&d->wrapLines);
+    return d->numWraps;
 }
 
 static void deinit_InputLine(iInputLine *d) {
@@ -195,19 +199,27 @@ iDefineTypeConstruction(InputLine)
 
 iDeclareType(InputUndo)
 
+/* Undo entries store the edits as deltas instead of copies of the entire text. Consecutive
+   entries are grouped: undoing restores the text as it was at the start of the group. */
 struct Impl_InputUndo {
-    iString text;
-    iInt2 cursor;
+    size_t  pos;         /* byte offset of the edit */
+    iString removed;     /* text that was deleted or overwritten at `pos` */
+    size_t  numInserted; /* bytes inserted at `pos` */
+    iBool   isGroupStart;
+    iInt2   cursor;      /* position before the group of edits */
 };
 
-static void init_InputUndo_(iInputUndo *d, const iArray *lines, iInt2 cursor) {
-    init_String(&d->text);
-    mergeLines_(lines, &d->text);
-    d->cursor = cursor;
+static void init_InputUndo_(iInputUndo *d, size_t pos, const iString *removed,
+                            size_t numInserted) {
+    d->pos = pos;
+    initCopy_String(&d->removed, removed);
+    d->numInserted = numInserted;
+    d->isGroupStart = iFalse;
+    d->cursor = zero_I2();
 }
 
 static void deinit_InputUndo_(iInputUndo *d) {
-    deinit_String(&d->text);
+    deinit_String(&d->removed);
 }
 
 #endif /* USE_SYSTEM_TEXT_INPUT */
@@ -232,6 +244,9 @@ enum iInputWidgetFlag {
     dragMarkerEnd_InputWidgetFlag        = iBit(16),
     omitDefaultSchemeIfNarrow_InputWidgetFlag = iBit(17),
     arrowFocusNavigable_InputWidgetFlag  = iBit(18),
+    newUndoGroup_InputWidgetFlag         = iBit(19), /* next recorded edit begins a group */
+    isUndoing_InputWidgetFlag            = iBit(20),
+    needWrapSums_InputWidgetFlag         = iBit(21), /* lines were added or removed */
 };
 
 /*----------------------------------------------------------------------------------------------*/
@@ -266,11 +281,14 @@ struct Impl_InputWidget {
     iRangei         pendingSelectionRange;
 #else
     iArray          lines;        /* iInputLine[] */
+    iArray          wrapSums;     /* int[]; Fenwick tree of the lines' wrap counts */
     iInt2           cursor;       /* cursor position: x = byte offset, y = line index */
     iInt2           prevCursor;   /* previous cursor position */
     iRanges         mark;         /* TODO: would likely simplify things to use two Int2's for marking; no conversions needed */
     iRanges         initialMark;
-    iArray          undoStack;
+    iArray          undoStack;    /* iInputUndo[] */
+    unsigned        highlightGen; /* incremented when cached line highlights become invalid */
+    iInt2           undoCursor;   /* cursor position for the next undo group */
     uint32_t        tapStartTime;
     uint32_t        lastTapTime;
     iInt2           lastTapPos;
@@ -306,10 +324,9 @@ static void saveBackup_InputWidget_(iInputWidget *d) {
 #if LAGRANGE_USE_SYSTEM_TEXT_INPUT
         write_File(f, utf8_String(&d->text));
 #else
-        iConstForEach(Array, i, &d->lines) {
-            const iInputLine *line = i.value;
-            write_File(f, utf8_String(&line->text));
-        }
+        iString *text = text_InputWidget_(d); /* written all at once */
+        write_File(f, utf8_String(text));
+        delete_String(text);
 #   if !defined (NDEBUG)
         iConstForEach(Array, j, &d->lines) {
             iAssert(endsWith_String(&((const iInputLine *) j.value)->text, "\n") ||
@@ -383,6 +400,7 @@ static void clearUndo_InputWidget_(iInputWidget *d) {
         deinit_InputUndo_(i.value);
     }
     clear_Array(&d->undoStack);
+    d->inFlags &= ~newUndoGroup_InputWidgetFlag;
 }
 
 static const iInputLine *line_InputWidget_(const iInputWidget *d, size_t index) {
@@ -442,8 +460,71 @@ iLocalDef const iInputLine *lastLine_InputWidget_(const iInputWidget *d) {
     return constBack_Array(&d->lines);
 }
 
+/* The index of a line's first wrap is the sum of the wrap counts of the preceding lines.
+   The counts are kept in a Fenwick tree so that the sum, and the line containing a given
+   wrap, can be found in logarithmic time regardless of the length of the text. The tree is
+   rebuilt only when lines are added or removed. */
+
+static void rebuildWrapSums_InputWidget_(iInputWidget *d) {
+    const size_t numLines = size_Array(&d->lines);
+    resize_Array(&d->wrapSums, numLines + 1);
+    int *tree = data_Array(&d->wrapSums);
+    tree[0] = 0;
+    for (size_t i = 1; i <= numLines; i++) {
+        tree[i] = numWrapLines_InputLine_(constAt_Array(&d->lines, i - 1));
+    }
+    for (size_t i = 1; i <= numLines; i++) {
+        const size_t parent = i + (i & (~i + 1));
+        if (parent <= numLines) {
+            tree[parent] += tree[i];
+        }
+    }
+    d->inFlags &= ~needWrapSums_InputWidgetFlag;
+}
+
+static void addWrapSum_InputWidget_(iInputWidget *d, size_t index, int delta) {
+    int *        tree = data_Array(&d->wrapSums);
+    const size_t size = size_Array(&d->wrapSums);
+    for (size_t i = index + 1; i < size; i += i & (~i + 1)) {
+        tree[i] += delta;
+    }
+}
+
+static int wrapSum_InputWidget_(const iInputWidget *d, size_t numLines) {
+    /* Total number of wraps in the first `numLines` lines. */
+    iAssert(~d->inFlags & needWrapSums_InputWidgetFlag);
+    const int *tree = constData_Array(&d->wrapSums);
+    int        sum  = 0;
+    for (size_t i = iMin(numLines, size_Array(&d->wrapSums) - 1); i > 0; i &= i - 1) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+static int firstWrap_InputWidget_(const iInputWidget *d, int y) {
+    return wrapSum_InputWidget_(d, y);
+}
+
 static int numWrapLines_InputWidget_(const iInputWidget *d) {
-    return lastLine_InputWidget_(d)->wrapLines.end;
+    return wrapSum_InputWidget_(d, size_Array(&d->lines));
+}
+
+static int lineIndexAtWrap_InputWidget_(const iInputWidget *d, int wrapY) {
+    /* Out-of-bounds wraps are clamped to the first or last line. */
+    const int *  tree     = constData_Array(&d->wrapSums);
+    const size_t numLines = size_Array(&d->wrapSums) - 1;
+    size_t       pos      = 0;
+    size_t       step     = 1;
+    while (step * 2 <= numLines) {
+        step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+        if (pos + step <= numLines && tree[pos + step] <= wrapY) {
+            pos += step;
+            wrapY -= tree[pos];
+        }
+    }
+    return (int) iMin(pos, numLines - 1);
 }
 
 static const iString *lineString_InputWidget_(const iInputWidget *d, int y) {
@@ -529,38 +610,19 @@ static iRangecc rangeSize_String(const iString *d, size_t size) {
     };
 }
 
-static const iInputLine *findLineByWrapY_InputWidget_(const iInputWidget *d, int wrapY) {
-    iConstForEach(Array, i, &d->lines) {
-        const iInputLine *line = i.value;
-        if (contains_Range(&line->wrapLines, wrapY)) {
-            return line;
-        }
-    }
-    iAssert(iFalse); /* wrap y is out of bounds */
-    return wrapY < 0 ? constFront_Array(&d->lines) : constBack_Array(&d->lines);
-}
-
 static int visLineOffsetY_InputWidget_(const iInputWidget *d) {
-    const iInputLine *line = findLineByWrapY_InputWidget_(d, d->visWrapLines.start);
-    return (line->wrapLines.start - d->visWrapLines.start) * lineHeight_Text(d->font) -
+    const int y = lineIndexAtWrap_InputWidget_(d, d->visWrapLines.start);
+    return (firstWrap_InputWidget_(d, y) - d->visWrapLines.start) * lineHeight_Text(d->font) -
            d->wheelAccum;
 }
 
 static iRangei visibleLineRange_InputWidget_(const iInputWidget *d) {
-    iRangei vis = { -1, -1 };
     /* Determine which lines are in the potentially visible range. */
-    for (int i = 0; i < size_Array(&d->lines); i++) {
-        const iInputLine *line = constAt_Array(&d->lines, i);
-        if (vis.start < 0 && line->wrapLines.end > d->visWrapLines.start) {
-            vis.start = vis.end = i;
-        }
-        if (line->wrapLines.start < d->visWrapLines.end) {
-            vis.end = i + 1;
-        }
-        else break;
+    const int first = lineIndexAtWrap_InputWidget_(d, d->visWrapLines.start);
+    if (isEmpty_Range(&d->visWrapLines)) {
+        return (iRangei){ first, first };
     }
-    iAssert(isEmpty_Range(&vis) || (vis.start >= 0 && vis.end >= vis.start));
-    return vis;
+    return (iRangei){ first, lineIndexAtWrap_InputWidget_(d, d->visWrapLines.end - 1) + 1 };
 }
 
 static iInt2 relativeCoordOnLine_InputWidget_(const iInputWidget *d, iInt2 pos) {
@@ -604,8 +666,7 @@ static void updateVisible_InputWidget_(iInputWidget *d) {
     d->visWrapLines.end = d->visWrapLines.start + visWraps;
     /* Determine which wraps are currently visible. */
     d->cursor.y = iMin(d->cursor.y, size_Array(&d->lines) - 1);
-    const iInputLine *curLine = constAt_Array(&d->lines, d->cursor.y);
-    const int cursorY = curLine->wrapLines.start +
+    const int cursorY = firstWrap_InputWidget_(d, d->cursor.y) +
         relativeCursorCoord_InputWidget_(d).y / lineHeight_Text(d->font);
     /* Scroll to cursor. */
     int delta = 0;
@@ -698,14 +759,21 @@ static size_t length_InputWidget_(const iInputWidget *d) {
 
 static void updateLine_InputWidget_(iInputWidget *d, iInputLine *line) {
     iAssert(endsWith_String(&line->text, "\n") || isLastLine_InputWidget_(d, line));
-    iWrapText wrapText = wrap_InputWidget_(d, indexOf_Array(&d->lines, line));
-    if (wrapText.maxWidth <= minWidth_InputWidget_) {
-        line->wrapLines.end = line->wrapLines.start + 1;
-        return;
+    const size_t index    = indexOf_Array(&d->lines, line);
+    iWrapText    wrapText = wrap_InputWidget_(d, index);
+    int          numWraps = 1;
+    if (wrapText.maxWidth > minWidth_InputWidget_) {
+        const iTextMetrics tm = measure_WrapText(&wrapText, d->font);
+        numWraps = height_Rect(tm.bounds) / lineHeight_Text(d->font);
+    }
+    iAssert(numWraps > 0);
+    line->highlightGen = 0; /* text has changed */
+    if (numWraps != line->numWraps) {
+        if (~d->inFlags & needWrapSums_InputWidgetFlag) {
+            addWrapSum_InputWidget_(d, index, numWraps - line->numWraps);
+        }
+        line->numWraps = numWraps;
     }
-    const iTextMetrics tm = measure_WrapText(&wrapText, d->font);
-    line->wrapLines.end = line->wrapLines.start + height_Rect(tm.bounds) / lineHeight_Text(d->font);
-    iAssert(!isEmpty_Range(&line->wrapLines));
 }
 
 static void updateLineRangesStartingFrom_InputWidget_(iInputWidget *d, int y) {
@@ -715,13 +783,11 @@ static void updateLineRangesStartingFrom_InputWidget_(iInputWidget *d, int y) {
         iInputLine *next  = at_Array(&d->lines, i);
         next->range.start = line->range.end;
         next->range.end   = next->range.start + size_String(&next->text);
-        /* Update wrap line range as well. */
-        next->wrapLines = (iRangei){
-            line->wrapLines.end,
-            line->wrapLines.end + numWrapLines_InputLine_(next)
-        };
         line = next;
     }
+    if (d->inFlags & needWrapSums_InputWidgetFlag) {
+        rebuildWrapSums_InputWidget_(d);
+    }
 }
 
 static void updateAllLinesAndResizeHeight_InputWidget_(iInputWidget *d) {
@@ -852,8 +918,12 @@ void init_InputWidget(iInputWidget *d, size_t maxLen) {
     init_String(&d->text);
     d->pendingSelectionRange = (iRangei){ -1, -1 };
 #else
+    w->flags2 |= drawsWithinBounds_WidgetFlag2; /* selection pins fit in the damage margin */
     init_Array(&d->lines, sizeof(iInputLine));
+    init_Array(&d->wrapSums, sizeof(int));
     init_Array(&d->undoStack, sizeof(iInputUndo));
+    d->highlightGen = 1;
+    d->undoCursor   = zero_I2();
     d->cursor       = zero_I2();
     d->prevCursor   = zero_I2();
     d->lastTapTime  = 0;
@@ -861,6 +931,7 @@ void init_InputWidget(iInputWidget *d, size_t maxLen) {
     d->cursorVis    = 0;
     iZap(d->mark);
     splitToLines_(&iStringLiteral(""), &d->lines);
+    rebuildWrapSums_InputWidget_(d);
 #endif
     init_String(&d->oldText);
     init_String(&d->srcHint);
@@ -909,6 +980,7 @@ void deinit_InputWidget(iInputWidget *d) {
     deactivateInputMode_InputWidget_(d);
     clearUndo_InputWidget_(d);
     deinit_Array(&d->undoStack);
+    deinit_Array(&d->wrapSums);
     deinit_Array(&d->lines);
 #endif
 }
@@ -932,32 +1004,94 @@ static void updateAfterVisualOffsetChange_InputWidget_(iInputWidget *d, iRoot *r
 void setFont_InputWidget(iInputWidget *d, int fontId) {
     d->font = fontId;
     d->lastUpdateWidth = 0; /* force a rewrapping */
+#if !LAGRANGE_USE_SYSTEM_TEXT_INPUT
+    d->highlightGen++; /* highlighter may use a related font */
+#endif
     updateMetrics_InputWidget_(d);
 }
 
 #if !LAGRANGE_USE_SYSTEM_TEXT_INPUT
 static void pushUndo_InputWidget_(iInputWidget *d) {
-    iInputUndo undo;
-    init_InputUndo_(&undo, &d->lines, d->cursor);
-    pushBack_Array(&d->undoStack, &undo);
-    if (size_Array(&d->undoStack) > maxUndo_InputWidget_) {
+    /* Nothing is stored yet; the edits recorded after this are undone together. */
+    d->inFlags |= newUndoGroup_InputWidgetFlag;
+    d->undoCursor = d->cursor;
+}
+
+static size_t numUndoGroups_InputWidget_(const iInputWidget *d) {
+    size_t count = 0;
+    iConstForEach(Array, i, &d->undoStack) {
+        count += ((const iInputUndo *) i.value)->isGroupStart ? 1 : 0;
+    }
+    return count;
+}
+
+static void popOldestUndoGroup_InputWidget_(iInputWidget *d) {
+    do {
         deinit_InputUndo_(front_Array(&d->undoStack));
         popFront_Array(&d->undoStack);
+    } while (!isEmpty_Array(&d->undoStack) &&
+             !((const iInputUndo *) constFront_Array(&d->undoStack))->isGroupStart);
+}
+
+static iInt2 indexToCursor_InputWidget_(const iInputWidget *d, size_t index);
+
+static void recordUndo_InputWidget_(iInputWidget *d, size_t pos, const iString *removed,
+                                    size_t numInserted) {
+    /* Called after an edit has been made. */
+    if (d->inFlags & isUndoing_InputWidgetFlag || (isEmpty_String(removed) && !numInserted)) {
+        return;
+    }
+    iInputUndo undo;
+    init_InputUndo_(&undo, pos, removed, numInserted);
+    if (d->inFlags & newUndoGroup_InputWidgetFlag || isEmpty_Array(&d->undoStack)) {
+        if (numUndoGroups_InputWidget_(d) >= maxUndo_InputWidget_) {
+            popOldestUndoGroup_InputWidget_(d);
+        }
+        undo.isGroupStart = iTrue;
+        undo.cursor = (d->inFlags & newUndoGroup_InputWidgetFlag
+                           ? d->undoCursor
+                           : indexToCursor_InputWidget_(d, pos));
+        d->inFlags &= ~newUndoGroup_InputWidgetFlag;
     }
+    pushBack_Array(&d->undoStack, &undo);
 }
 
+static void deleteIndexRange_InputWidget_(iInputWidget *d, iRanges deleted);
+static void insertRange_InputWidget_(iInputWidget *d, iRangecc range);
+static void showCursor_InputWidget_(iInputWidget *d);
+
 static iBool popUndo_InputWidget_(iInputWidget *d) {
-    if (!isEmpty_Array(&d->undoStack)) {
+    if (isEmpty_Array(&d->undoStack)) {
+        return iFalse;
+    }
+    /* Revert the edits of the latest group in reverse order. Only the affected lines
+       need to be rewrapped. */
+    const enum iInputMode oldMode = d->mode;
+    d->mode = insert_InputMode;
+    d->inFlags |= isUndoing_InputWidgetFlag;
+    d->inFlags &= ~newUndoGroup_InputWidgetFlag;
+    iBool isGroupStart;
+    do {
         iInputUndo *undo = back_Array(&d->undoStack);
-        splitToLines_(&undo->text, &d->lines);
-        d->cursor = undo->cursor;
+        if (undo->numInserted) {
+            deleteIndexRange_InputWidget_(d, (iRanges){ undo->pos, undo->pos + undo->numInserted });
+        }
+        if (!isEmpty_String(&undo->removed)) {
+            d->cursor = indexToCursor_InputWidget_(d, undo->pos);
+            insertRange_InputWidget_(d, range_String(&undo->removed));
+        }
+        isGroupStart = undo->isGroupStart;
+        if (isGroupStart) {
+            d->cursor = undo->cursor;
+        }
         deinit_InputUndo_(undo);
         popBack_Array(&d->undoStack);
-        iZap(d->mark);
-        updateAllLinesAndResizeHeight_InputWidget_(d);
-        return iTrue;
-    }
-    return iFalse;
+    } while (!isGroupStart && !isEmpty_Array(&d->undoStack));
+    d->inFlags &= ~isUndoing_InputWidgetFlag;
+    d->mode = oldMode;
+    iZap(d->mark);
+    showCursor_InputWidget_(d);
+    return iTrue;
 }
 
 iLocalDef iInputLine *cursorLine_InputWidget_(iInputWidget *d) {
@@ -1075,6 +1209,9 @@ void setHighlighter_InputWidget(iInputWidget *d, iInputWidgetHighlighterFunc hig
                                 void *context) {
     d->highlighter = highlighter;
     d->highlighterContext = context;
+#if !LAGRANGE_USE_SYSTEM_TEXT_INPUT
+    d->highlightGen++;
+#endif
     invalidateBuffered_InputWidget_(d);
 }
 
@@ -1202,8 +1339,10 @@ void setText_InputWidget(iInputWidget *d, const iString *text) {
 void setTextUndoable_InputWidget(iInputWidget *d, const iString *text, iBool isUndoable) {
     if (!d) return;
 #if !LAGRANGE_USE_SYSTEM_TEXT_INPUT
+    iString *oldText = NULL;
     if (isUndoable) {
         pushUndo_InputWidget_(d);
+        oldText = text_InputWidget_(d);
     }
 #endif
     if (d->inFlags & isUrl_InputWidgetFlag) {
@@ -1233,11 +1372,16 @@ void setTextUndoable_InputWidget(iInputWidget *d, const iString *text, iBool isU
         clearUndo_InputWidget_(d);
     }
     splitToLines_(nfcText, &d->lines);
+    d->inFlags |= needWrapSums_InputWidgetFlag;
     iAssert(!isEmpty_Array(&d->lines));
     iForEach(Array, i, &d->lines) {
         updateLine_InputWidget_(d, i.value); /* count number of visible lines */
     }
     updateLineRangesStartingFrom_InputWidget_(d, 0);
+    if (oldText) {
+        recordUndo_InputWidget_(d, 0, oldText, lastLine_InputWidget_(d)->range.end);
+        delete_String(oldText);
+    }
     d->cursor = cursorMax_InputWidget_(d);
     if (!isFocused_Widget(d)) {
         iZap(d->mark);
@@ -1362,6 +1506,7 @@ static void begin_InputWidget_(iInputWidget *d, iBool allowSelectAll) {
     refresh_Widget(d); /* ensure buffered panels hide the static text */
 #else
     mergeLines_(&d->lines, &d->oldText);
+    d->highlightGen++; /* highlights may depend on focus */
     if (d->mode == overwrite_InputMode) {
         d->cursor = zero_I2();
     }
@@ -1418,8 +1563,12 @@ void end_InputWidget(iInputWidget *d, iBool accept) {
     if (!accept) {
         /* Overwrite the edited lines. */
         splitToLines_(&d->oldText, &d->lines);
+        rebuildWrapSums_InputWidget_(d);
+        clearUndo_InputWidget_(d); /* edits no longer apply */
+        updateAllLinesAndResizeHeight_InputWidget_(d);
     }
     d->inFlags &= ~isMarking_InputWidgetFlag;
+    d->highlightGen++;
     deactivateInputMode_InputWidget_(d);
     startOrStopCursorTimer_InputWidget_(d, iFalse);
     window_Widget(w)->keyPriority = NULL;
@@ -1471,6 +1620,24 @@ static void textOfLinesWasChanged_InputWidget_(iInputWidget *d, iRangei lineRang
 static void insertRange_InputWidget_(iInputWidget *d, iRangecc range) {
     iRangecc nextRange = { range.end, range.end };
     const int firstModified = d->cursor.y;
+    /* Remember what gets replaced, for undoing. */
+    size_t  undoPos     = cursorToIndex_InputWidget_(d, d->cursor);
+    size_t  numInserted = size_Range(&range);
+    iString removed;
+    init_String(&removed);
+    if (d->maxLen > 0) {
+        /* The end may get cut off, so the whole text is replaced. */
+        mergeLines_(&d->lines, &removed);
+        undoPos = 0;
+    }
+    else if (d->mode == overwrite_InputMode) {
+        const iString *lineText = &constCursorLine_InputWidget_(d)->text;
+        const size_t   end      = iMin(size_String(lineText), d->cursor.x + numInserted);
+        if (end > (size_t) d->cursor.x) {
+            setRange_String(&removed, (iRangecc){ constBegin_String(lineText) + d->cursor.x,
+                                                  constBegin_String(lineText) + end });
+        }
+    }
     for (; !isEmpty_Range(&range); range = nextRange) {
         /* If there's a newline, we'll need to break and begin a new line. */
         const char *newline = iStrStrN(range.start, "\n", size_Range(&range));
@@ -1501,6 +1668,7 @@ static void insertRange_InputWidget_(iInputWidget *d, iRangecc range) {
             appendCStr_String(&line->text, "\n");
         }
         insert_Array(&d->lines, ++d->cursor.y, &split);
+        d->inFlags |= needWrapSums_InputWidgetFlag;
         d->cursor.x = 0;
     }
     if (d->maxLen > 0) {
@@ -1514,6 +1682,11 @@ static void insertRange_InputWidget_(iInputWidget *d, iRangecc range) {
         }
     }
     textOfLinesWasChanged_InputWidget_(d, (iRangei){ firstModified, d->cursor.y + 1 });
+    if (d->maxLen > 0) {
+        numInserted = lastLine_InputWidget_(d)->range.end;
+    }
+    recordUndo_InputWidget_(d, undoPos, &removed, numInserted);
+    deinit_String(&removed);
     showCursor_InputWidget_(d);
     refresh_Widget(as_Widget(d));
 }
@@ -1611,6 +1784,9 @@ static iRanges mark_InputWidget_(const iInputWidget *d) {
 
 static void deleteIndexRange_InputWidget_(iInputWidget *d, iRanges deleted) {
     size_t firstModified = iInvalidPos;
+    iString removed;
+    init_String(&removed);
+    mergeLinesRange_(&d->lines, deleted, &removed);
     restartBackupTimer_InputWidget_(d);
     for (int i = size_Array(&d->lines) - 1; i >= 0; i--) {
         iInputLine *line = at_Array(&d->lines, i);
@@ -1642,6 +1818,7 @@ static void deleteIndexRange_InputWidget_(iInputWidget *d, iRanges deleted) {
             append_String(&line->text, &nextLine->text);
             deinit_InputLine(nextLine);
             remove_Array(&d->lines, i + 1);
+            d->inFlags |= needWrapSums_InputWidgetFlag;
         }
     }
     if (isEmpty_Array(&d->lines)) {
@@ -1649,6 +1826,7 @@ static void deleteIndexRange_InputWidget_(iInputWidget *d, iRanges deleted) {
         iInputLine empty;
         init_InputLine(&empty);
         pushBack_Array(&d->lines, &empty);
+        d->inFlags |= needWrapSums_InputWidgetFlag;
     }
     iZap(d->mark);
     /* Update lines. */
@@ -1660,6 +1838,8 @@ static void deleteIndexRange_InputWidget_(iInputWidget *d, iRanges deleted) {
         }
         updateLineRangesStartingFrom_InputWidget_(d, firstModified);
     }
+    recordUndo_InputWidget_(d, deleted.start, &removed, 0);
+    deinit_String(&removed);
     updateVisible_InputWidget_(d);
     updateMetrics_InputWidget_(d);
 }
@@ -1825,10 +2005,6 @@ static void extendRange_InputWidget_(iInputWidget *d, size_t *index, int dir) {
     *index = cursorToIndex_InputWidget_(d, pos);
 }
 
-static void lineTextWasChanged_InputWidget_(iInputWidget *d, iInputLine *line) {
-    const int y = indexOf_Array(&d->lines, line);
-    textOfLinesWasChanged_InputWidget_(d, (iRangei){ y, y + 1 });
-}
 #endif
 
 void setSensitiveContent_InputWidget(iInputWidget *d, iBool isSensitive) {
@@ -2718,9 +2894,7 @@ static iBool processEvent_InputWidget_(iInputWidget *d, const SDL_Event *ev) {
                 }
                 else if (isEqual_I2(d->cursor, zero_I2()) && d->maxLen == 1) {
                     pushUndo_InputWidget_(d);
-                    iInputLine *line = cursorLine_InputWidget_(d);
-                    clear_String(&line->text);
-                    lineTextWasChanged_InputWidget_(d, line);
+                    deleteIndexRange_InputWidget_(d, constCursorLine_InputWidget_(d)->range);
                     contentsWereChanged_InputWidget_(d);
                 }
                 showCursor_InputWidget_(d);
@@ -2761,12 +2935,11 @@ static iBool processEvent_InputWidget_(iInputWidget *d, const SDL_Event *ev) {
                     }
                     else {
                         pushUndo_InputWidget_(d);
-                        iInputLine *line = cursorLine_InputWidget_(d);
-                        truncate_String(&line->text, d->cursor.x);
-                        if (!isLastLine_InputWidget_(d, line)) {
-                            appendCStr_String(&line->text, "\n"); /* must have a newline */
-                        }
-                        lineTextWasChanged_InputWidget_(d, line);
+                        /* Delete to the end of the line, keeping the newline. */
+                        deleteIndexRange_InputWidget_(d, (iRanges){
+                            cursorToIndex_InputWidget_(d, d->cursor),
+                            cursorToIndex_InputWidget_(d, init_I2(endX_InputWidget_(d, d->cursor.y),
+                                                                  d->cursor.y)) });
                         contentsWereChanged_InputWidget_(d);
                     }
                     showCursor_InputWidget_(d);
@@ -2926,6 +3099,20 @@ static iBool draw_MarkPainter_(iWrapText *wrapText, iRangecc wrappedText, iTextA
 }
 #endif
 
+#if !LAGRANGE_USE_SYSTEM_TEXT_INPUT
+static iInputWidgetHighlight lineHighlight_InputWidget_(const iInputWidget *d,
+                                                        const iInputLine *line) {
+    /* Highlights are cached until the line is edited, or the highlighter's output may
+       have changed for all lines. */
+    if (line->highlightGen != d->highlightGen) {
+        iInputLine *mutLine   = iConstCast(iInputLine *, line);
+        mutLine->highlight    = d->highlighter(d, range_String(&line->text), d->highlighterContext);
+        mutLine->highlightGen = d->highlightGen;
+    }
+    return line->highlight;
+}
+#endif
+
 static void draw_InputWidget_(const iInputWidget *d) {
     const iWidget *w         = constAs_Widget(d);
     iRect          bounds    = adjusted_Rect(bounds_InputWidget_(d), padding_(), neg_I2(padding_()));
@@ -3021,7 +3208,7 @@ static void draw_InputWidget_(const iInputWidget *d) {
             marker.pos    = drawPos;
             iInputWidgetHighlight highlight = { .font = d->font, .color = fg };
             if (d->highlighter) {
-                highlight = d->highlighter(d, wrapText.text, d->highlighterContext);
+                highlight = lineHighlight_InputWidget_(d, line);
             }
             addv_I2(&drawPos,
                     draw_WrapText(&wrapText, highlight.font, drawPos, highlight.color)
@@ -711,6 +711,7 @@ static void replaceVariables_LabelWidget_(iLabelWidget *d) {
 void init_LabelWidget(iLabelWidget *d, const char *label, const char *cmd) {
     iWidget *w = &d->widget;
     init_Widget(w);
+    w->flags2 |= drawsWithinBounds_WidgetFlag2; /* clipped to bounds */
     iZap(d->flags);
     d->font = uiLabel_FontId;
     d->forceFg = none_ColorId;
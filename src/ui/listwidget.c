@@ -88,6 +88,7 @@ void init_ListWidget(iListWidget *d) {
     setId_Widget(w, "list");
     setBackgroundColor_Widget(w, uiBackground_ColorId); /* needed for filling visbuffer */
     setFlags_Widget(w, hover_WidgetFlag | focusable_WidgetFlag, iTrue);
+    w->flags2 |= drawsWithinBounds_WidgetFlag2; /* clipped to bounds */
     addChild_Widget(w, iClob(d->scroll = new_ScrollWidget()));
     setThumb_ScrollWidget(d->scroll, 0, 0);
     init_SmoothScroll(&d->scrollY, w, scrollBegan_ListWidget_);
@@ -140,6 +141,19 @@ void addItem_ListWidget(iListWidget *d, iAnyObject *item) {
     pushBack_PtrArray(&d->items, ref_Object(item));
 }
 
+void insertItem_ListWidget(iListWidget *d, size_t index, iAnyObject *item) {
+    insert_PtrArray(&d->items, index, ref_Object(item));
+    d->hoverItem = iInvalidPos;
+}
+
+void removeItems_ListWidget(iListWidget *d, size_t index, size_t count) {
+    for (size_t i = index; i < index + count; i++) {
+        deref_Object(at_PtrArray(&d->items, i));
+    }
+    removeN_PtrArray(&d->items, index, count);
+    d->hoverItem = iInvalidPos;
+}
+
 iScrollWidget *scroll_ListWidget(iListWidget *d) {
     return d->scroll;
 }
@@ -84,6 +84,8 @@ void    invalidate_ListWidget       (iListWidget *);
 void    invalidateItem_ListWidget   (iListWidget *, size_t index);
 void    clear_ListWidget            (iListWidget *);
 void    addItem_ListWidget          (iListWidget *, iAnyObject *item);
+void    insertItem_ListWidget       (iListWidget *, size_t index, iAnyObject *item);
+void    removeItems_ListWidget      (iListWidget *, size_t index, size_t count);
 
 iScrollWidget * scroll_ListWidget   (iListWidget *);
 
@@ -86,22 +86,35 @@ static const uint32_t sevenSegmentDigit_ = 0x1fbf0;
 
 static const char *sevenSegmentStr_ = "\U0001fbf0";
 
-static int drawSevenSegmentTime_(iInt2 pos, int color, int align, int seconds) { /* returns width */
+static void sevenSegmentTime_(iString *num, int seconds) {
     const int hours = seconds / 3600;
     const int mins  = (seconds / 60) % 60;
     const int secs  = seconds % 60;
-    const int font  = uiLabelBig_FontId;
-    iString   num;
-    init_String(&num);
     if (hours) {
-        appendChar_String(&num, sevenSegmentDigit_ + (hours % 10));
-        appendChar_String(&num, ':');
+        appendChar_String(num, sevenSegmentDigit_ + (hours % 10));
+        appendChar_String(num, ':');
     }
-    appendChar_String(&num, sevenSegmentDigit_ + (mins / 10) % 10);
-    appendChar_String(&num, sevenSegmentDigit_ + (mins % 10));
-    appendChar_String(&num, ':');
-    appendChar_String(&num, sevenSegmentDigit_ + (secs / 10) % 10);
-    appendChar_String(&num, sevenSegmentDigit_ + (secs % 10));
+    appendChar_String(num, sevenSegmentDigit_ + (mins / 10) % 10);
+    appendChar_String(num, sevenSegmentDigit_ + (mins % 10));
+    appendChar_String(num, ':');
+    appendChar_String(num, sevenSegmentDigit_ + (secs / 10) % 10);
+    appendChar_String(num, sevenSegmentDigit_ + (secs % 10));
+}
+
+static int measureSevenSegmentTime_(int seconds) {
+    iString num;
+    init_String(&num);
+    sevenSegmentTime_(&num, seconds);
+    const int width = measureRange_Text(uiLabelBig_FontId, range_String(&num)).bounds.size.x;
+    deinit_String(&num);
+    return width;
+}
+
+static int drawSevenSegmentTime_(iInt2 pos, int color, int align, int seconds) { /* returns width */
+    const int font = uiLabelBig_FontId;
+    iString   num;
+    init_String(&num);
+    sevenSegmentTime_(&num, seconds);
     iInt2 size = measureRange_Text(font, range_String(&num)).bounds.size;
     if (align == right_Alignment) {
         pos.x -= size.x;
@@ -111,6 +124,38 @@ static int drawSevenSegmentTime_(iInt2 pos, int color, int align, int seconds) {
     return size.x;
 }
 
+static iRangei scrubberSpan_PlayerUI_(const iPlayerUI *d, int leftWidth, int rightWidth) {
+    return (iRangei){ left_Rect(d->scrubberRect) + leftWidth + 6 * gap_UI,
+                      right_Rect(d->scrubberRect) - rightWidth - 6 * gap_UI };
+}
+
+float seekTime_PlayerUI(const iPlayerUI *d, iInt2 coord) {
+#if defined (LAGRANGE_ENABLE_AUDIO)
+    const float totalTime = duration_Player(d->player);
+    if (totalTime <= 0 || !contains_Rect(d->scrubberRect, coord)) {
+        return -1.0f;
+    }
+    /* The time labels are measured the same way they are drawn. */
+    const iRangei span =
+        scrubberSpan_PlayerUI_(d,
+                               measureSevenSegmentTime_(iRound(time_Player(d->player))),
+                               measureSevenSegmentTime_(iRound(totalTime)));
+    if (span.end <= span.start) {
+        return -1.0f;
+    }
+    float normPos = (float) (coord.x - span.start) / (float) size_Range(&span);
+    const float progress = streamProgress_Player(d->player);
+    if (progress > 0) {
+        /* Only the part that has been received can be seeked to. */
+        normPos = iMin(normPos, progress);
+    }
+    return iClamp(normPos, 0.0f, 1.0f) * totalTime;
+#else
+    iUnused(d, coord);
+    return -1.0f;
+#endif
+}
+
 void draw_PlayerUI(iPlayerUI *d, iPaint *p) {
 #if defined (LAGRANGE_ENABLE_AUDIO)
     const int   playerBackground_ColorId = uiBackground_ColorId;
@@ -148,8 +193,9 @@ void draw_PlayerUI(iPlayerUI *d, iPaint *p) {
                                   iRound(totalTime));
     }
     /* Scrubber. */
-    const int   s1       = left_Rect(d->scrubberRect) + leftWidth + 6 * gap_UI;
-    const int   s2       = right_Rect(d->scrubberRect) - rightWidth - 6 * gap_UI;
+    const iRangei span   = scrubberSpan_PlayerUI_(d, leftWidth, rightWidth);
+    const int   s1       = span.start;
+    const int   s2       = span.end;
     const float normPos  = totalTime > 0 ? playTime / totalTime : 0.0f;
     const int   part     = (s2 - s1) * normPos;
     const int   scrubMax = (s2 - s1) * streamProgress_Player(d->player);
@@ -47,6 +47,7 @@ struct Impl_PlayerUI {
 
 void    init_PlayerUI   (iPlayerUI *, const iPlayer *player, iRect bounds);
 void    draw_PlayerUI   (iPlayerUI *, iPaint *p);
+float   seekTime_PlayerUI(const iPlayerUI *, iInt2 coord); /* seconds; negative if none */
 
 /*----------------------------------------------------------------------------------------------*/
 
@@ -27,6 +27,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
 iInt2 origin_Paint;
 
+/* During a partial window redraw, nothing outside the damaged area may be drawn on the
+   window's retained back buffer. SDL forgets the clip rectangle whenever the render target
+   changes, so the current window clip is remembered here. */
+static struct {
+    iBool        isLimited;
+    SDL_Texture *target;
+    iRect        rect;
+    iRect        clip;
+} damage_Paint_;
+
 iLocalDef SDL_Renderer *renderer_Paint_(const iPaint *d) {
     iAssert(d->dst);
     return d->dst->render;
@@ -38,6 +48,20 @@ static void setColor_Paint_(const iPaint *d, int color) {
                            (color & opaque_ColorId ? 255 : clr.a) * d->alpha / 255);
 }
 
+static iBool isDamageLimited_Paint_(const iPaint *d) {
+    return damage_Paint_.isLimited &&
+           SDL_GetRenderTarget(renderer_Paint_(d)) == damage_Paint_.target;
+}
+
+static void setDamageClip_Paint_(const iPaint *d, iRect rect) {
+    rect = intersect_Rect(rect, damage_Paint_.rect);
+    if (isEmpty_Rect(rect)) {
+        rect = (iRect){ damage_Paint_.rect.pos, one_I2() };
+    }
+    damage_Paint_.clip = rect;
+    SDL_RenderSetClipRect(renderer_Paint_(d), (const SDL_Rect *) &rect);
+}
+
 void init_Paint(iPaint *d) {
     d->dst       = get_Window();
     d->setTarget = NULL;
@@ -62,7 +86,7 @@ void beginTarget_Paint(iPaint *d, SDL_Texture *target) {
 
 void endTarget_Paint(iPaint *d) {
     if (d->setTarget) {
-        SDL_SetRenderTarget(renderer_Paint_(d), d->oldTarget);
+        restoreRenderTarget_Paint(renderer_Paint_(d), d->oldTarget);
         origin_Paint = d->oldOrigin;
         d->oldOrigin = zero_I2();
         d->oldTarget = NULL;
@@ -82,6 +106,10 @@ void setClip_Paint(iPaint *d, iRect rect) {
     if (isEqual_I2(zero_I2(), origin_Paint)) {
         rect = intersect_Rect(rect, rect_Root(get_Root()));
     }
+    if (isDamageLimited_Paint_(d)) {
+        setDamageClip_Paint_(d, rect);
+        return;
+    }
     if (isEmpty_Rect(rect)) {
         rect = init_Rect(0, 0, 1, 1);
     }
@@ -93,6 +121,11 @@ void unsetClip_Paint(iPaint *d) {
         setClip_Paint(d, rect_Root(get_Root()));
         return;
     }
+    if (isDamageLimited_Paint_(d)) {
+        setDamageClip_Paint_(d, current_Root() ? rect_Root(get_Root())
+                                               : (iRect){ zero_I2(), d->dst->size });
+        return;
+    }
 #if SDL_VERSION_ATLEAST(2, 0, 12)
     SDL_RenderSetClipRect(renderer_Paint_(d), NULL);
 #else
@@ -102,6 +135,24 @@ void unsetClip_Paint(iPaint *d) {
 #endif
 }
 
+void beginDamage_Paint(SDL_Texture *windowTarget, iRect damage) {
+    damage_Paint_.isLimited = iTrue;
+    damage_Paint_.target    = windowTarget;
+    damage_Paint_.rect      = damage;
+    damage_Paint_.clip      = damage;
+}
+
+void endDamage_Paint(void) {
+    iZap(damage_Paint_);
+}
+
+void restoreRenderTarget_Paint(SDL_Renderer *render, SDL_Texture *target) {
+    SDL_SetRenderTarget(render, target);
+    if (damage_Paint_.isLimited && target == damage_Paint_.target) {
+        SDL_RenderSetClipRect(render, (const SDL_Rect *) &damage_Paint_.clip);
+    }
+}
+
 void drawRect_Paint(const iPaint *d, iRect rect, int color) {
     addv_I2(&rect.pos, origin_Paint);
     iInt2 br = bottomRight_Rect(rect);
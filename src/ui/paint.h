@@ -47,6 +47,10 @@ void    endTarget_Paint     (iPaint *);
 void    setClip_Paint       (iPaint *, iRect rect);
 void    unsetClip_Paint     (iPaint *);
 
+void    beginDamage_Paint           (SDL_Texture *windowTarget, iRect damage); /* clip all window drawing */
+void    endDamage_Paint             (void);
+void    restoreRenderTarget_Paint   (SDL_Renderer *, SDL_Texture *target); /* reapplies damage clip */
+
 void    drawRect_Paint          (const iPaint *, iRect rect, int color);
 void    drawRectThickness_Paint (const iPaint *, iRect rect, int thickness, int color);
 void    fillRect_Paint          (const iPaint *, iRect rect, int color);
@@ -0,0 +1,427 @@
+/* Copyright 2026 Jaakko Keränen <jaakko.keranen@iki.fi>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#include "profiler.h"
+#include "paint.h"
+#include "root.h"
+#include "text.h"
+#include "../gmutil.h"
+
+#include <the_Foundation/file.h>
+#include <SDL_timer.h>
+#include <stdlib.h>
+
+enum {
+    maxDepth_Profiler_      = 64,
+    maxClasses_Profiler_    = 64,
+    numFrames_Profiler_     = 120,
+    maxTraceSpans_Profiler_ = 8192,
+};
+
+static const char *phaseNames_Profiler_[max_ProfilerPhase + 1] = {
+    "Events", "Tickers", "Arrange", "Draw", "Present", "Frame"
+};
+
+iDeclareType(ProfilerFrame)
+iDeclareType(ProfilerClass)
+iDeclareType(ProfilerSpan)
+iDeclareType(ProfilerScope)
+
+struct Impl_ProfilerFrame {
+    uint64_t duration;
+    uint64_t phaseTime[max_ProfilerPhase]; /* exclusive */
+    unsigned numDraws;
+    unsigned numArranged;
+};
+
+struct Impl_ProfilerClass {
+    const iClass *class;
+    uint64_t      time; /* exclusive of child widgets */
+    unsigned      count;
+};
+
+struct Impl_ProfilerSpan {
+    int      phase; /* `max_ProfilerPhase` for entire frames */
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct Impl_ProfilerScope {
+    int      phase; /* -1 for a widget draw */
+    int      classIndex;
+    uint64_t begin;
+    uint64_t childTime;
+};
+
+static struct {
+    iBool            isEnabled;
+    iBool            showOverlay;
+    uint64_t         startTime;
+    uint64_t         frameStart;
+    iBool            isInFrame; /* a phase has begun since the previous frame ended */
+    iProfilerFrame   current;
+    iProfilerFrame   frames[numFrames_Profiler_];
+    size_t           numFrames; /* total since enabled */
+    iProfilerScope   stack[maxDepth_Profiler_];
+    int              depth;
+    iProfilerClass   classes[maxClasses_Profiler_];
+    int              numClasses;
+    iProfilerSpan    spans[maxTraceSpans_Profiler_]; /* ring buffer */
+    size_t           numSpans; /* total since enabled */
+} profiler_;
+
+static iString *lastExportPath_Profiler_;
+
+static double toMs_Profiler_(uint64_t ticks) {
+    return (double) ticks * 1000.0 / (double) SDL_GetPerformanceFrequency();
+}
+
+static double toUs_Profiler_(uint64_t ticks) {
+    return (double) ticks * 1.0e6 / (double) SDL_GetPerformanceFrequency();
+}
+
+static void addSpan_Profiler_(int phase, uint64_t begin, uint64_t end) {
+    profiler_.spans[profiler_.numSpans++ % maxTraceSpans_Profiler_] =
+        (iProfilerSpan){ phase, begin, end };
+}
+
+static void push_Profiler_(int phase, int classIndex) {
+    if (profiler_.depth < maxDepth_Profiler_) {
+        profiler_.stack[profiler_.depth] =
+            (iProfilerScope){ phase, classIndex, SDL_GetPerformanceCounter(), 0 };
+    }
+    profiler_.depth++;
+}
+
+/* Returns the exclusive time of the popped scope. Scopes nested too deeply are not timed.
+   Phases are exclusive only of nested phases, and widget draws only of nested widget draws,
+   so the phase times add up to the frame and each class gets its own drawing time. */
+static uint64_t pop_Profiler_(iProfilerScope *scope_out) {
+    iAssert(profiler_.depth > 0);
+    if (--profiler_.depth >= maxDepth_Profiler_) {
+        scope_out->phase = -1;
+        scope_out->classIndex = -1;
+        return 0;
+    }
+    *scope_out = profiler_.stack[profiler_.depth];
+    const uint64_t elapsed = SDL_GetPerformanceCounter() - scope_out->begin;
+    if (scope_out->phase >= 0) {
+        for (int i = profiler_.depth - 1; i >= 0; i--) {
+            if (profiler_.stack[i].phase >= 0) {
+                profiler_.stack[i].childTime += elapsed;
+                break;
+            }
+        }
+    }
+    else if (profiler_.depth > 0 && profiler_.stack[profiler_.depth - 1].phase < 0) {
+        profiler_.stack[profiler_.depth - 1].childTime += elapsed;
+    }
+    return elapsed > scope_out->childTime ? elapsed - scope_out->childTime : 0;
+}
+
+void setEnabled_Profiler(iBool enable) {
+    if (enable && !profiler_.isEnabled) {
+        iZap(profiler_);
+        profiler_.startTime = profiler_.frameStart = SDL_GetPerformanceCounter();
+    }
+    profiler_.isEnabled = enable;
+    if (!enable) {
+        profiler_.showOverlay = iFalse;
+    }
+}
+
+iBool isEnabled_Profiler(void) {
+    return profiler_.isEnabled;
+}
+
+void setOverlay_Profiler(iBool show) {
+    if (show) {
+        setEnabled_Profiler(iTrue);
+    }
+    profiler_.showOverlay = show;
+}
+
+iBool isOverlayVisible_Profiler(void) {
+    return profiler_.showOverlay;
+}
+
+static void popScope_Profiler_(void) {
+    iProfilerScope scope;
+    const uint64_t time = pop_Profiler_(&scope);
+    if (scope.phase >= 0) {
+        profiler_.current.phaseTime[scope.phase] += time;
+        addSpan_Profiler_(scope.phase, scope.begin, SDL_GetPerformanceCounter());
+    }
+    else if (scope.classIndex >= 0) {
+        iProfilerClass *pc = &profiler_.classes[scope.classIndex];
+        pc->time += time;
+        pc->count++;
+    }
+}
+
+void beginPhase_Profiler(enum iProfilerPhase phase) {
+    if (profiler_.isEnabled) {
+        if (!profiler_.isInFrame) {
+            /* Time spent idle, waiting for events, is not part of the frame. */
+            profiler_.frameStart = SDL_GetPerformanceCounter();
+            profiler_.isInFrame  = iTrue;
+        }
+        push_Profiler_(phase, -1);
+    }
+}
+
+void endPhase_Profiler(enum iProfilerPhase phase) {
+    if (!profiler_.isEnabled) {
+        return;
+    }
+    int index = iMin(profiler_.depth, maxDepth_Profiler_) - 1;
+    while (index >= 0 && profiler_.stack[index].phase != (int) phase) {
+        index--;
+    }
+    if (index < 0) {
+        return; /* not begun */
+    }
+    /* Anything left open inside the phase ends with it. */
+    while (profiler_.depth > index) {
+        popScope_Profiler_();
+    }
+}
+
+void endFrame_Profiler(void) {
+    if (!profiler_.isEnabled) {
+        return;
+    }
+    const uint64_t now = SDL_GetPerformanceCounter();
+    if (!profiler_.isInFrame) {
+        profiler_.frameStart = now;
+    }
+    profiler_.current.duration = now - profiler_.frameStart;
+    addSpan_Profiler_(max_ProfilerPhase, profiler_.frameStart, now);
+    profiler_.frames[profiler_.numFrames++ % numFrames_Profiler_] = profiler_.current;
+    iZap(profiler_.current);
+    profiler_.isInFrame = iFalse;
+}
+
+static int classIndex_Profiler_(const iClass *class) {
+    for (int i = 0; i < profiler_.numClasses; i++) {
+        if (profiler_.classes[i].class == class) {
+            return i;
+        }
+    }
+    if (profiler_.numClasses == maxClasses_Profiler_) {
+        return -1;
+    }
+    profiler_.classes[profiler_.numClasses] = (iProfilerClass){ class, 0, 0 };
+    return profiler_.numClasses++;
+}
+
+void beginDraw_Profiler(const iClass *widgetClass) {
+    if (profiler_.isEnabled) {
+        push_Profiler_(-1, classIndex_Profiler_(widgetClass));
+    }
+}
+
+void endDraw_Profiler(void) {
+    if (!profiler_.isEnabled || profiler_.depth == 0) {
+        return;
+    }
+    popScope_Profiler_();
+    profiler_.current.numDraws++;
+}
+
+void countArranged_Profiler(void) {
+    if (profiler_.isEnabled) {
+        profiler_.current.numArranged++;
+    }
+}
+
+static size_t numRecentFrames_Profiler_(void) {
+    return iMin(profiler_.numFrames, numFrames_Profiler_);
+}
+
+static void recentAverage_Profiler_(iProfilerFrame *avg_out, iProfilerFrame *max_out) {
+    const size_t count = numRecentFrames_Profiler_();
+    iZap(*avg_out);
+    iZap(*max_out);
+    for (size_t i = 0; i < count; i++) {
+        const iProfilerFrame *f = &profiler_.frames[i];
+        avg_out->duration += f->duration;
+        max_out->duration = iMax(max_out->duration, f->duration);
+        for (int p = 0; p < max_ProfilerPhase; p++) {
+            avg_out->phaseTime[p] += f->phaseTime[p];
+            max_out->phaseTime[p] = iMax(max_out->phaseTime[p], f->phaseTime[p]);
+        }
+        avg_out->numDraws += f->numDraws;
+        max_out->numDraws = iMax(max_out->numDraws, f->numDraws);
+        avg_out->numArranged += f->numArranged;
+        max_out->numArranged = iMax(max_out->numArranged, f->numArranged);
+    }
+    if (count) {
+        avg_out->duration /= count;
+        for (int p = 0; p < max_ProfilerPhase; p++) {
+            avg_out->phaseTime[p] /= count;
+        }
+        avg_out->numDraws /= count;
+        avg_out->numArranged /= count;
+    }
+}
+
+void drawOverlay_Profiler(void) {
+    if (!profiler_.showOverlay || !profiler_.numFrames) {
+        return;
+    }
+    const iProfilerFrame *last =
+        &profiler_.frames[(profiler_.numFrames - 1) % numFrames_Profiler_];
+    iProfilerFrame avg, max;
+    recentAverage_Profiler_(&avg, &max);
+    const int   font   = uiLabel_FontId;
+    const int   lineHt = lineHeight_Text(font);
+    const iRect rect   = safeRect_Root(get_Root());
+    iInt2       pos    = init_I2(right_Rect(rect) - gap_UI, top_Rect(rect) + gap_UI);
+    iPaint      p;
+    init_Paint(&p);
+    p.alpha = 0xc0;
+    SDL_SetRenderDrawBlendMode(renderer_Window(get_Window()), SDL_BLENDMODE_BLEND);
+    fillRect_Paint(&p,
+                   (iRect){ init_I2(pos.x - 30 * gap_UI, pos.y - gap_UI / 2),
+                            init_I2(31 * gap_UI, (max_ProfilerPhase + 3) * lineHt + gap_UI) },
+                   black_ColorId);
+    SDL_SetRenderDrawBlendMode(renderer_Window(get_Window()), SDL_BLENDMODE_NONE);
+    drawAlign_Text(font, pos, white_ColorId, right_Alignment, "Frame: %.2f ms (avg %.2f, max %.2f)",
+                   toMs_Profiler_(last->duration), toMs_Profiler_(avg.duration),
+                   toMs_Profiler_(max.duration));
+    pos.y += lineHt;
+    for (int i = 0; i < max_ProfilerPhase; i++) {
+        drawAlign_Text(font, pos, gray75_ColorId, right_Alignment, "%s: %.2f ms (avg %.2f)",
+                       phaseNames_Profiler_[i], toMs_Profiler_(last->phaseTime[i]),
+                       toMs_Profiler_(avg.phaseTime[i]));
+        pos.y += lineHt;
+    }
+    drawAlign_Text(font, pos, gray75_ColorId, right_Alignment, "Widgets drawn: %u (avg %u)",
+                   last->numDraws, avg.numDraws);
+    pos.y += lineHt;
+    drawAlign_Text(font, pos, gray75_ColorId, right_Alignment, "Widgets arranged: %u (avg %u)",
+                   last->numArranged, avg.numArranged);
+}
+
+static int cmpTime_ProfilerClass_(const void *a, const void *b) {
+    const iProfilerClass *x = a, *y = b;
+    return x->time < y->time ? 1 : x->time > y->time ? -1 : 0;
+}
+
+const iString *infoPage_Profiler(void) {
+    iString *str = collectNewCStr_String("# Profiler\n");
+    appendFormat_String(str, "=> about:command?profiler.toggle  %s\n",
+                        profiler_.isEnabled ? "Stop profiling" : "Start profiling");
+    appendFormat_String(str, "=> about:command?profiler.overlay  %s\n",
+                        profiler_.showOverlay ? "Hide overlay" : "Show overlay");
+    if (profiler_.numSpans) {
+        appendCStr_String(str, "=> about:command?profiler.export  Export Chrome trace\n");
+    }
+    if (lastExportPath_Profiler_) {
+        appendFormat_String(str, "=> %s  Last exported trace\n",
+                            cstrCollect_String(makeFileUrl_String(lastExportPath_Profiler_)));
+    }
+    appendCStr_String(str, profiler_.isEnabled
+                               ? "\nReload this page to see the latest statistics.\n"
+                               : "\nProfiling is not enabled.\n");
+    if (profiler_.numFrames) {
+        iProfilerFrame avg, max;
+        recentAverage_Profiler_(&avg, &max);
+        appendFormat_String(str, "## Frame timing\nAverages of the last %zu frames "
+                                 "(%zu frames drawn in total).\n```\n",
+                            numRecentFrames_Profiler_(), profiler_.numFrames);
+        appendFormat_String(str, "%-10s %10s %10s\n", "Phase", "Avg ms", "Max ms");
+        for (int i = 0; i < max_ProfilerPhase; i++) {
+            appendFormat_String(str, "%-10s %10.3f %10.3f\n", phaseNames_Profiler_[i],
+                                toMs_Profiler_(avg.phaseTime[i]), toMs_Profiler_(max.phaseTime[i]));
+        }
+        appendFormat_String(str, "%-10s %10.3f %10.3f\n", phaseNames_Profiler_[max_ProfilerPhase],
+                            toMs_Profiler_(avg.duration), toMs_Profiler_(max.duration));
+        appendFormat_String(str, "```\nWidgets arranged per frame: avg %u, max %u.\n",
+                            avg.numArranged, max.numArranged);
+        appendFormat_String(str, "## Widget drawing\nTime excludes child widgets.\n```\n");
+        appendFormat_String(str, "%-24s %12s %12s %10s\n", "Class", "Draws/frame", "μs/frame",
+                            "Total ms");
+        iProfilerClass sorted[maxClasses_Profiler_];
+        memcpy(sorted, profiler_.classes, sizeof(sorted[0]) * profiler_.numClasses);
+        qsort(sorted, profiler_.numClasses, sizeof(sorted[0]), cmpTime_ProfilerClass_);
+        for (int i = 0; i < profiler_.numClasses; i++) {
+            const iProfilerClass *pc = &sorted[i];
+            appendFormat_String(str, "%-24s %12.1f %12.1f %10.3f\n", pc->class->name,
+                                (double) pc->count / profiler_.numFrames,
+                                toUs_Profiler_(pc->time) / profiler_.numFrames,
+                                toMs_Profiler_(pc->time));
+        }
+        appendCStr_String(str, "```\n");
+    }
+    /* Text caches are always tracked. */ {
+        iTextCacheStats stats;
+        cacheStats_Text(&stats);
+        appendCStr_String(str, "## Text caches\n");
+        appendFormat_String(str, "* Glyph lookups: %u, misses: %u (%.1f%%)\n",
+                            stats.glyphLookups, stats.glyphMisses,
+                            stats.glyphLookups ? 100.0 * stats.glyphMisses / stats.glyphLookups : 0.0);
+        appendFormat_String(str, "* Glyph cache: %d/%d pixel rows used of %dx%d texture, "
+                                 "reset %u times\n",
+                            stats.glyphCacheUsed, stats.glyphCacheSize.y,
+                            stats.glyphCacheSize.x, stats.glyphCacheSize.y,
+                            stats.glyphCacheResets);
+        appendFormat_String(str, "* FontRun lookups: %u, hits: %u (%.1f%%)\n",
+                            stats.fontRunLookups, stats.fontRunHits,
+                            stats.fontRunLookups ? 100.0 * stats.fontRunHits / stats.fontRunLookups : 0.0);
+    }
+    return str;
+}
+
+iBool exportTrace_Profiler(const iString *path) {
+    iFile *f = new_File(path);
+    if (!open_File(f, writeOnly_FileMode | text_FileMode)) {
+        iRelease(f);
+        return iFalse;
+    }
+    /* Chrome's Trace Event Format; can be viewed with Perfetto or chrome://tracing. */
+    iStream *out = stream_File(f);
+    printf_Stream(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    const size_t count = iMin(profiler_.numSpans, maxTraceSpans_Profiler_);
+    for (size_t i = 0; i < count; i++) {
+        const iProfilerSpan *span =
+            &profiler_.spans[(profiler_.numSpans - count + i) % maxTraceSpans_Profiler_];
+        printf_Stream(out,
+                      "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                      "\"ts\":%.1f,\"dur\":%.1f}%s\n",
+                      phaseNames_Profiler_[span->phase],
+                      span->phase == max_ProfilerPhase ? "frame" : "phase",
+                      toUs_Profiler_(span->begin - profiler_.startTime),
+                      toUs_Profiler_(span->end - span->begin),
+                      i + 1 < count ? "," : "");
+    }
+    printf_Stream(out, "]}\n");
+    close_File(f);
+    iRelease(f);
+    if (!lastExportPath_Profiler_) {
+        lastExportPath_Profiler_ = new_String();
+    }
+    set_String(lastExportPath_Profiler_, path);
+    return iTrue;
+}
@@ -0,0 +1,56 @@
+/* Copyright 2026 Jaakko Keränen <jaakko.keranen@iki.fi>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#pragma once
+
+#include <the_Foundation/string.h>
+#include <the_Foundation/class.h>
+
+/* Profiler collects frame timing and drawing statistics while enabled. Time spent in
+nested phases is only counted in the innermost phase. The statistics are shown in
+"about:profiler", and recent frames can be exported as a Chrome trace. */
+
+enum iProfilerPhase {
+    events_ProfilerPhase,
+    tickers_ProfilerPhase,
+    arrange_ProfilerPhase,
+    draw_ProfilerPhase,
+    present_ProfilerPhase,
+    max_ProfilerPhase
+};
+
+void    setEnabled_Profiler     (iBool enable);
+iBool   isEnabled_Profiler      (void);
+void    setOverlay_Profiler     (iBool show);
+iBool   isOverlayVisible_Profiler(void);
+
+void    beginPhase_Profiler     (enum iProfilerPhase phase);
+void    endPhase_Profiler       (enum iProfilerPhase phase); /* also ends scopes opened inside it */
+void    endFrame_Profiler       (void);
+void    beginDraw_Profiler      (const iClass *widgetClass);
+void    endDraw_Profiler        (void);
+void    countArranged_Profiler  (void);
+
+void            drawOverlay_Profiler    (void); /* top right corner of the current root */
+const iString * infoPage_Profiler       (void);
+iBool           exportTrace_Profiler    (const iString *path);
@@ -52,6 +52,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #   include "ios.h"
 #endif
 
+#include <the_Foundation/math.h>
 #include <SDL_timer.h>
 
 static const iMenuItem desktopNavMenuItems_[] = {
@@ -221,6 +222,17 @@ iDefineTypeConstruction(Root)
 iDefineAudienceGetter(Root, arrangementChanged)
 iDefineAudienceGetter(Root, visualOffsetsChanged)
 
+iDeclareType(WidgetIdNode)
+
+struct Impl_WidgetIdNode {
+    iHashNode node;
+    iPtrArray widgets; /* all widgets whose ID has the same hash */
+};
+
+static uint32_t widgetIdKey_(const char *id, size_t len) {
+    return iCrc32(id, len);
+}
+
 void init_Root(iRoot *d) {
     iZap(*d);
     init_String(&d->tabInsertId);
@@ -229,6 +241,14 @@ void init_Root(iRoot *d) {
 void deinit_Root(iRoot *d) {
     iRecycle();
     iReleasePtr(&d->widget);
+    if (d->widgetIds) {
+        iForEach(Hash, i, d->widgetIds) {
+            iWidgetIdNode *node = (iWidgetIdNode *) remove_HashIterator(&i);
+            deinit_PtrArray(&node->widgets);
+            free(node);
+        }
+        delete_Hash(d->widgetIds);
+    }
     delete_PtrArray(d->onTop);
     delete_PtrSet(d->pendingDestruction);
     delete_Audience(d->visualOffsetsChanged);
@@ -319,6 +339,51 @@ iPtrArray *onTop_Root(iRoot *d) {
     return d->onTop;
 }
 
+void insertWidgetId_Root(iRoot *d, iWidget *widget) {
+    if (!d) {
+        return; /* not yet part of a root; indexed when added to one */
+    }
+    const iString *id  = id_Widget(widget);
+    const uint32_t key = widgetIdKey_(cstr_String(id), size_String(id));
+    if (!d->widgetIds) {
+        d->widgetIds = new_Hash();
+    }
+    iWidgetIdNode *node = (iWidgetIdNode *) value_Hash(d->widgetIds, key);
+    if (!node) {
+        node = iZapMalloc(WidgetIdNode);
+        node->node.key = key;
+        init_PtrArray(&node->widgets);
+        insert_Hash(d->widgetIds, &node->node);
+    }
+    pushBack_PtrArray(&node->widgets, widget);
+}
+
+void removeWidgetId_Root(iRoot *d, const iWidget *widget) {
+    if (!d) {
+        return;
+    }
+    const iString *id  = id_Widget(widget);
+    const uint32_t key = widgetIdKey_(cstr_String(id), size_String(id));
+    iWidgetIdNode *node = d->widgetIds ? (iWidgetIdNode *) value_Hash(d->widgetIds, key) : NULL;
+    if (node) {
+        removeOne_PtrArray(&node->widgets, widget);
+        if (isEmpty_PtrArray(&node->widgets)) {
+            remove_Hash(d->widgetIds, key);
+            deinit_PtrArray(&node->widgets);
+            free(node);
+        }
+    }
+}
+
+const iPtrArray *widgetsWithId_Root(const iRoot *d, const char *id) {
+    if (!d || !d->widgetIds) {
+        return NULL;
+    }
+    const iWidgetIdNode *node =
+        (const iWidgetIdNode *) value_Hash(d->widgetIds, widgetIdKey_(id, strlen(id)));
+    return node ? &node->widgets : NULL;
+}
+
 static iWidget *makeIdentityMenu_(iWidget *parent) {
     iArray items;
     init_Array(&items, sizeof(iMenuItem));
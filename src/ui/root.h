@@ -3,6 +3,7 @@
 #include "widget.h"
 #include "color.h"
 #include <the_Foundation/audience.h>
+#include <the_Foundation/hash.h>
 #include <the_Foundation/ptrset.h>
 #include <the_Foundation/vec2.h>
 
@@ -18,6 +19,7 @@ struct Impl_Root {
     iWidget *  widget;
     iWindow *  window;
     iPtrArray *onTop; /* order is important; last one is topmost */
+    iHash *    widgetIds; /* widgets that have an ID, for fast lookups */
     iPtrSet *  pendingDestruction;
     int        pendingArrange; /* incremented counter */
     int        loadAnimTimer;
@@ -47,6 +49,9 @@ iDocumentWidget *   findDocument_Root           (const iRoot *, const iString *u
 iDocumentWidget *   document_Root               (iRoot *);
 
 iPtrArray * onTop_Root                          (iRoot *);
+void        insertWidgetId_Root                 (iRoot *, iWidget *widget);
+void        removeWidgetId_Root                 (iRoot *, const iWidget *widget);
+const iPtrArray *widgetsWithId_Root             (const iRoot *, const char *id); /* may include others; NULL if none */
 void        destroyPending_Root                 (iRoot *);
 
 void        updateMetrics_Root                  (iRoot *);
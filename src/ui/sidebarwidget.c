@@ -133,6 +133,7 @@ struct Impl_SidebarWidget {
     iSidebarItem *    contextItem;  /* list item accessed in the context menu */
     size_t            contextIndex; /* index of list item accessed in the context menu */
     iIntSet *         closedFolders; /* otherwise open */
+    iBool             isItemsPending; /* items are rebuilt when the sidebar is shown */
 };
 
 iDefineObjectConstructionArgs(SidebarWidget, (enum iSidebarSide side), side)
@@ -273,6 +274,44 @@ static const iPtrArray *listFeedEntries_SidebarWidget_(const iSidebarWidget *d)
     return listEntries_Feeds();
 }
 
+static iSidebarItem *newBookmarkItem_SidebarWidget_(const iSidebarWidget *d, const iBookmark *bm) {
+    iSidebarItem *item = new_SidebarItem();
+    item->listItem.isDraggable = iTrue;
+    item->isBold = item->listItem.isDropTarget = isFolder_Bookmark(bm);
+    item->id = id_Bookmark(bm);
+    item->indent = depth_Bookmark(bm);
+    if (isFolder_Bookmark(bm)) {
+        item->icon = contains_IntSet(d->closedFolders, item->id) ? 0x27e9 : 0xfe40;
+    }
+    else {
+        item->icon = bm->icon;
+    }
+    set_String(&item->url, &bm->url);
+    set_String(&item->label, &bm->title);
+    /* Icons for special behaviors. */ {
+        if (bm->flags & subscribed_BookmarkFlag) {
+            appendChar_String(&item->meta, 0x2605);
+        }
+        if (bm->flags & homepage_BookmarkFlag) {
+            appendChar_String(&item->meta, 0x1f3e0);
+        }
+        if (bm->flags & remote_BookmarkFlag) {
+            item->listItem.isDraggable = iFalse;
+        }
+        if (bm->flags & remoteSource_BookmarkFlag) {
+            appendChar_String(&item->meta, 0x2913);
+            item->isBold = iTrue;
+        }
+        if (bm->flags & linkSplit_BookmarkFlag) {
+            appendChar_String(&item->meta, 0x25e7);
+        }
+        if (!isEmpty_String(&bm->identity)) {
+            appendCStr_String(&item->meta, person_Icon);
+        }
+    }
+    return item;
+}
+
 static const iMenuItem bookmarkModeMenuItems_[] = {
     { bookmark_Icon " ${menu.page.bookmark}", SDLK_d, KMOD_PRIMARY, "bookmark.add" },
     { "---" },
@@ -285,6 +324,12 @@ static const iMenuItem bookmarkModeMenuItems_[] = {
 };
 
 static void updateItemsWithFlags_SidebarWidget_(iSidebarWidget *d, iBool keepActions) {
+    if (!isVisible_Widget(d)) {
+        /* Items are rebuilt when the sidebar is shown. */
+        d->isItemsPending = iTrue;
+        return;
+    }
+    d->isItemsPending = iFalse;
     const iBool isMobile = (deviceType_App() != desktop_AppDeviceType);
     clear_ListWidget(d->list);
     releaseChildren_Widget(d->blank);
@@ -486,40 +531,7 @@ static void updateItemsWithFlags_SidebarWidget_(iSidebarWidget *d, iBool keepAct
                 if (isBookmarkFolded_SidebarWidget_(d, bm)) {
                     continue; /* inside a closed folder */
                 }
-                iSidebarItem *item = new_SidebarItem();
-                item->listItem.isDraggable = iTrue;
-                item->isBold = item->listItem.isDropTarget = isFolder_Bookmark(bm);
-                item->id = id_Bookmark(bm);
-                item->indent = depth_Bookmark(bm);
-                if (isFolder_Bookmark(bm)) {
-                    item->icon = contains_IntSet(d->closedFolders, item->id) ? 0x27e9 : 0xfe40;
-                }
-                else {
-                    item->icon = bm->icon;
-                }
-                set_String(&item->url, &bm->url);
-                set_String(&item->label, &bm->title);
-                /* Icons for special behaviors. */ {
-                    if (bm->flags & subscribed_BookmarkFlag) {
-                        appendChar_String(&item->meta, 0x2605);
-                    }
-                    if (bm->flags & homepage_BookmarkFlag) {
-                        appendChar_String(&item->meta, 0x1f3e0);
-                    }
-                    if (bm->flags & remote_BookmarkFlag) {
-                        item->listItem.isDraggable = iFalse;
-                    }
-                    if (bm->flags & remoteSource_BookmarkFlag) {
-                        appendChar_String(&item->meta, 0x2913);
-                        item->isBold = iTrue;
-                    }
-                    if (bm->flags & linkSplit_BookmarkFlag) {
-                        appendChar_String(&item->meta, 0x25e7);
-                    }
-                    if (!isEmpty_String(&bm->identity)) {
-                        appendCStr_String(&item->meta, person_Icon);
-                    }
-                }
+                iSidebarItem *item = newBookmarkItem_SidebarWidget_(d, bm);
                 addItem_ListWidget(d->list, item);
                 iRelease(item);
             }
@@ -729,6 +741,58 @@ static void updateItems_SidebarWidget_(iSidebarWidget *d) {
     updateItemsWithFlags_SidebarWidget_(d, iFalse);
 }
 
+static iBool isInsideFolder_(void *context, const iBookmark *bm) {
+    return hasParent_Bookmark(bm, *(const uint32_t *) context);
+}
+
+static void updateFolderItems_SidebarWidget_(iSidebarWidget *d, size_t folderIndex) {
+    /* Only the contents of the folder change, so the rest of the list is kept as is. */
+    iSidebarItem *folder   = item_ListWidget(d->list, folderIndex);
+    const iBool   isClosed = contains_IntSet(d->closedFolders, folder->id);
+    folder->icon = isClosed ? 0x27e9 : 0xfe40;
+    size_t end = folderIndex + 1;
+    while (end < numItems_ListWidget(d->list) &&
+           ((const iSidebarItem *) constItem_ListWidget(d->list, end))->indent > folder->indent) {
+        end++;
+    }
+    removeItems_ListWidget(d->list, folderIndex + 1, end - folderIndex - 1);
+    if (!isClosed) {
+        size_t pos = folderIndex + 1;
+        iConstForEach(PtrArray, i,
+                      list_Bookmarks(bookmarks_App(), cmpTree_Bookmark, isInsideFolder_, &folder->id)) {
+            const iBookmark *bm = i.ptr;
+            if (isBookmarkFolded_SidebarWidget_(d, bm)) {
+                continue; /* inside a closed subfolder */
+            }
+            iSidebarItem *item = newBookmarkItem_SidebarWidget_(d, bm);
+            insertItem_ListWidget(d->list, pos++, item);
+            iRelease(item);
+        }
+    }
+    updateVisible_ListWidget(d->list);
+    invalidate_ListWidget(d->list);
+    updateMouseHover_ListWidget(d->list);
+}
+
+static void updateFeedSelection_SidebarWidget_(iSidebarWidget *d) {
+    /* The open document is highlighted and opened entries become read; otherwise the listed
+       entries stay the same. */
+    const iString *docUrl = canonicalUrl_String(url_DocumentWidget(document_App()));
+    for (size_t i = 0; i < numItems_ListWidget(d->list); i++) {
+        iSidebarItem *item = item_ListWidget(d->list, i);
+        if (item->listItem.isSeparator) {
+            continue;
+        }
+        const iBool isOpen   = equal_String(docUrl, &item->url);
+        const int   isUnread = item->id ? isUnreadEntry_Feeds(item->id, &item->url) : item->indent;
+        if (item->listItem.isSelected != isOpen || item->indent != isUnread) {
+            item->listItem.isSelected = isOpen;
+            item->indent              = isUnread;
+            invalidateItem_ListWidget(d->list, i);
+        }
+    }
+}
+
 static size_t findItem_SidebarWidget_(const iSidebarWidget *d, int id) {
     /* Note that this is O(n), so only meant for infrequent use. */
     for (size_t i = 0; i < numItems_ListWidget(d->list); i++) {
@@ -874,6 +938,7 @@ void init_SidebarWidget(iSidebarWidget *d, enum iSidebarSide side) {
     d->feedsMode = all_FeedsMode;
     d->midHeight = 0;
     d->isEditing = iFalse;
+    d->isItemsPending = iTrue;
     d->numUnreadEntries = 0;
     d->buttonFont = uiLabel_FontId; /* wiil be changed later */
     d->itemFonts[0] = uiContent_FontId;
@@ -1074,7 +1139,7 @@ static void itemClicked_SidebarWidget_(iSidebarWidget *d, iSidebarItem *item, si
                     insert_IntSet(d->closedFolders, item->id);
                     setRecentFolder_Bookmarks(bookmarks_App(), 0);
                 }
-                updateItems_SidebarWidget_(d);
+                updateFolderItems_SidebarWidget_(d, itemIndex);
                 break;
             }
             else {
@@ -1201,6 +1266,7 @@ iBool handleBookmarkEditorCommands_SidebarWidget_(iWidget *editor, const char *c
         iBookmark *bm = get_Bookmarks(bookmarks_App(), bmId);
         if (bm) {
             set_String(&bm->identity, string_Command(cmd, "fp"));
+            reindex_Bookmarks(bookmarks_App(), bmId);
             updateDropdownSelection_LabelWidget(findChild_Widget(editor, "bmed.setident"),
                                                 format_CStr(" fp:%s", cstr_String(&bm->identity)));
         }
@@ -1237,6 +1303,7 @@ iBool handleBookmarkEditorCommands_SidebarWidget_(iWidget *editor, const char *c
             if (!folder || !hasParent_Bookmark(folder, id_Bookmark(bm))) {
                 bm->parentId = folder ? id_Bookmark(folder) : 0;
             }
+            reindex_Bookmarks(bookmarks_App(), bmId);
             postCommand_App("bookmarks.changed");
         }
         setupSheetTransition_Mobile(editor, dialogTransitionDir_Widget(editor));
@@ -1417,8 +1484,8 @@ static void bookmarkMoved_SidebarWidget_(iSidebarWidget *d, size_t index, size_t
         /* Can't move a folder inside itself, and remote bookmarks cannot be reordered. */
         return;
     }
+    setParent_Bookmarks(bookmarks_App(), movingItem->id, dst->parentId);
     reorder_Bookmarks(bookmarks_App(), movingItem->id, dst->order + (isBefore ? 0 : 1));
-    get_Bookmarks(bookmarks_App(), movingItem->id)->parentId = dst->parentId;
     updateItems_SidebarWidget_(d);
     /* Don't confuse the user: keep the dragged item in hover state. */
     setHoverItem_ListWidget(d->list, dstIndex + (isBefore ? 0 : 1) + (index < dstIndex ? -1 : 0));
@@ -1429,8 +1496,7 @@ static void bookmarkMovedOntoFolder_SidebarWidget_(iSidebarWidget *d, size_t ind
                                                    size_t folderIndex) {
     const iSidebarItem *movingItem = item_ListWidget(d->list, index);
     const iSidebarItem *dstItem    = item_ListWidget(d->list, folderIndex);
-    iBookmark *bm = get_Bookmarks(bookmarks_App(), movingItem->id);
-    bm->parentId = dstItem->id;
+    setParent_Bookmarks(bookmarks_App(), movingItem->id, dstItem->id);
     postCommand_App("bookmarks.changed");
 }
 
@@ -1536,8 +1602,16 @@ static iBool processEvent_SidebarWidget_(iSidebarWidget *d, const SDL_Event *ev)
         if ((equal_Command(cmd, "tabs.changed") &&
              startsWith_Rangecc(range_Command(cmd, "id"), "doc")) ||
             equal_Command(cmd, "document.changed")) {
-            updateItems_SidebarWidget_(d);
-            scrollOffset_ListWidget(d->list, 0);
+            /* Bookmarks do not depend on the open document. History is rebuilt because
+               visiting a page does not post "visited.changed". */
+            if (d->mode == feeds_SidebarMode && d->feedsMode == all_FeedsMode &&
+                !d->isItemsPending) {
+                updateFeedSelection_SidebarWidget_(d);
+            }
+            else if (d->mode != bookmarks_SidebarMode) {
+                updateItems_SidebarWidget_(d);
+                scrollOffset_ListWidget(d->list, 0);
+            }
         }
         else if (equal_Command(cmd, "sidebar.update")) {
             d->numUnreadEntries = numUnread_Feeds();
@@ -1555,7 +1629,7 @@ static iBool processEvent_SidebarWidget_(iSidebarWidget *d, const SDL_Event *ev)
                                                              d->mode == feeds_SidebarMode)) {
             if (pointerLabel_Command(cmd, "nosidebar") != d) {
                 updateItems_SidebarWidget_(d);
-                if (hasLabel_Command(cmd, "added")) {
+                if (hasLabel_Command(cmd, "added") && !d->isItemsPending) {
                     const size_t addedId    = argLabel_Command(cmd, "added");
                     const size_t addedIndex = findItem_SidebarWidget_(d, addedId);
                     scrollToItem_ListWidget(d->list, addedIndex, 200);
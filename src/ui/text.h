@@ -79,6 +79,20 @@ void    resetMissing_Text       (iText *);
 iBool   checkMissing_Text       (void); /* returns the flag, and clears it */
 SDL_Texture *glyphCache_Text    (void);
 
+iDeclareType(TextCacheStats)
+
+struct Impl_TextCacheStats {
+    unsigned glyphLookups;
+    unsigned glyphMisses;      /* glyph had to be allocated in the cache */
+    unsigned glyphCacheResets; /* cache texture ran out of space */
+    unsigned fontRunLookups;
+    unsigned fontRunHits;
+    iInt2    glyphCacheSize;
+    int      glyphCacheUsed;   /* height of the occupied part of the cache texture */
+};
+
+void    cacheStats_Text         (iTextCacheStats *stats_out); /* counts since the app was started */
+
 /*----------------------------------------------------------------------------------------------*/
 
 int     lineHeight_Text         (int fontId);
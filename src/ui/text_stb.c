@@ -512,7 +512,12 @@ void setOpacity_Text(float opacity) {
     SDL_SetTextureAlphaMod(current_StbText_()->cache, iClamp(opacity, 0.0f, 1.0f) * 255 + 0.5f);
 }
 
+static unsigned glyphLookups_      = 0;
+static unsigned glyphMisses_       = 0;
+static unsigned glyphCacheResets_  = 0;
+
 static void resetCache_StbText_(iStbText *d) {
+    glyphCacheResets_++;
     deinitCache_StbText_(d);
     iForEach(Array, i, &d->fonts) {
         clearGlyphs_GlyphTable_(((iFont *) i.value)->table);
@@ -680,11 +685,13 @@ static iGlyph *glyphByIndex_Font_(iFont *d, uint32_t glyphIndex) {
     }
     iGlyph* glyph = NULL;
     void *  node = value_Hash(&d->table->glyphs, glyphIndex);
+    glyphLookups_++;
     if (node) {
         glyph = node;
     }
     else {
         iStbText *tx = current_StbText_();
+        glyphMisses_++;
         /* If the cache is running out of space, clear it and we'll recache what's needed currently. */
         if (tx->cacheBottom > tx->cacheSize.y - maxGlyphHeight_Text_(&tx->base)) {
 #if !defined (NDEBUG)
@@ -858,7 +865,7 @@ static void cacheGlyphs_Font_(iFont *d, const uint32_t *glyphIndices, size_t num
         SDL_FreeSurface(buf);
     }
     if (isTargetChanged) {
-        SDL_SetRenderTarget(current_Text()->render, oldTarget);
+        restoreRenderTarget_Paint(current_Text()->render, oldTarget);
     }
 }
 
@@ -1842,3 +1849,14 @@ void resetMissing_Text(iText *d) {
 SDL_Texture *glyphCache_Text(void) {
     return current_StbText_()->cache;
 }
+
+void cacheStats_Text(iTextCacheStats *stats_out) {
+    const iStbText *d = current_StbText_();
+    stats_out->glyphLookups     = glyphLookups_;
+    stats_out->glyphMisses      = glyphMisses_;
+    stats_out->glyphCacheResets = glyphCacheResets_;
+    stats_out->fontRunLookups   = fontRunCacheTotal_;
+    stats_out->fontRunHits      = fontRunCacheHits_;
+    stats_out->glyphCacheSize   = d ? d->cacheSize : zero_I2();
+    stats_out->glyphCacheUsed   = d ? d->cacheBottom : 0;
+}
@@ -179,6 +179,10 @@ SDL_Texture *glyphCache_Text(void) {
     return NULL;
 }
 
+void cacheStats_Text(iTextCacheStats *stats_out) {
+    iZap(*stats_out);
+}
+
 void setOpacity_Text(float opacity) {
     iUnused(opacity);
 }
@@ -4231,7 +4231,9 @@ static iBool handleBookmarkCreationCommands_SidebarWidget_(iWidget *editor, cons
             const iString *ident = &as_Widget(findChild_Widget(editor, "bmed.setident"))->data;
             const iBookmark *folder = userData_Object(findChild_Widget(editor, "bmed.folder"));
             const iString *icon  = collect_String(trimmed_String(text_InputWidget(findChild_Widget(editor, "bmed.icon"))));
-            const uint32_t id    = add_Bookmarks(bookmarks_App(), url, title, tags, first_String(icon));
+            const uint32_t id    = addToFolder_Bookmarks(bookmarks_App(), url, title, tags,
+                                                         first_String(icon),
+                                                         folder ? id_Bookmark(folder) : 0);
             iBookmark *    bm    = get_Bookmarks(bookmarks_App(), id);
             set_String(&bm->notes, notes);
             set_String(&bm->identity, ident);
@@ -4247,7 +4249,7 @@ static iBool handleBookmarkCreationCommands_SidebarWidget_(iWidget *editor, cons
             if (isSelected_Widget(findChild_Widget(editor, "bmed.tag.linksplit"))) {
                 bm->flags |= linkSplit_BookmarkFlag;
             }
-            bm->parentId = folder ? id_Bookmark(folder) : 0;
+            reindex_Bookmarks(bookmarks_App(), id);
             setRecentFolder_Bookmarks(bookmarks_App(), bm->parentId);
             postCommandf_App("bookmarks.changed added:%zu", id);
         }
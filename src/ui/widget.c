@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "touch.h"
 #include "command.h"
 #include "paint.h"
+#include "profiler.h"
 #include "root.h"
 #include "util.h"
 #include "window.h"
@@ -124,6 +125,38 @@ static iRect boundsForDraw_Widget_(const iWidget *d) {
     return bounds;
 }
 
+static iBool isDrawConfined_Widget_(const iWidget *d) {
+    /* Only classes known to keep their drawing inside their bounds can be redrawn
+       partially. Layers may draw shadows and fades outside their bounds, so changes in them
+       affect the entire window. */
+    if (~d->flags2 & drawsWithinBounds_WidgetFlag2) {
+        return iFalse;
+    }
+    for (const iWidget *w = d; w; w = w->parent) {
+        if (w->flags & (keepOnTop_WidgetFlag | drawBackgroundToHorizontalSafeArea_WidgetFlag |
+                        drawBackgroundToVerticalSafeArea_WidgetFlag) ||
+            w->flags2 & fadeBackground_WidgetFlag2) {
+            return iFalse;
+        }
+    }
+    return iTrue;
+}
+
+static void postDamage_Widget_(const iWidget *d) {
+    iWindow *win = window_Widget(d);
+    if (!isDrawConfined_Widget_(d)) {
+        postRefresh_Window(win);
+        return;
+    }
+    /* Where it was last drawn needs to be redrawn, too, in case the widget has moved or
+       is being hidden. Selection pins and focus frames may reach slightly outside. */
+    iRect damage = boundsForDraw_Widget_(d);
+    if (!isEmpty_Rect(d->drawnRect)) {
+        damage = union_Rect(damage, d->drawnRect);
+    }
+    postRefreshRect_Window(win, expanded_Rect(damage, init1_I2(2 * gap_UI)));
+}
+
 static iBool checkDrawBuffer_Widget_(const iWidget *d) {
     return d->drawBuf && d->drawBuf->isValid &&
            isEqual_I2(d->drawBuf->size, boundsForDraw_Widget_(d).size);
@@ -154,6 +187,7 @@ void init_Widget(iWidget *d) {
     d->flags          = 0;
     d->flags2         = 0;
     d->rect           = zero_Rect();
+    d->drawnRect      = zero_Rect();
     d->oldSize        = zero_I2();
     d->minSize        = zero_I2();
     d->overflowTopMargin = 0;
@@ -222,6 +256,9 @@ void deinit_Widget(iWidget *d) {
                d->flags & keepOnTop_WidgetFlag ? 1 : 0);
     }
 #endif
+    if (!isEmpty_String(&d->id)) {
+        removeWidgetId_Root(d->root, d);
+    }
     deinit_String(&d->data);
     deinit_String(&d->resizeId);
     deinit_String(&d->id);
@@ -297,7 +334,13 @@ void destroy_Widget(iWidget *d) {
 }
 
 void setId_Widget(iWidget *d, const char *id) {
+    if (!isEmpty_String(&d->id)) {
+        removeWidgetId_Root(d->root, d);
+    }
     setCStr_String(&d->id, id);
+    if (!isEmpty_String(&d->id)) {
+        insertWidgetId_Root(d->root, d);
+    }
 }
 
 void setResizeId_Widget(iWidget *d, const char *resizeId) {
@@ -320,6 +363,9 @@ void setFlags_Widget(iWidget *d, int64_t flags, iBool set) {
         }
         const int64_t oldFlags = d->flags;
         iChangeFlags(d->flags, flags, set);
+        if ((oldFlags ^ d->flags) & hidden_WidgetFlag && d->root) {
+            postDamage_Widget_(d); /* appears or leaves behind its old area */
+        }
         if (flags & keepOnTop_WidgetFlag && !isRoot_Widget_(d)) {
             iPtrArray *onTop = onTop_Root(d->root);
             if (set) {
@@ -335,6 +381,15 @@ void setFlags_Widget(iWidget *d, int64_t flags, iBool set) {
                 iAssert(indexOf_PtrArray(onTop, d) == iInvalidPos);
             }
         }
+        if (d->flags2 & arrangementPending_WidgetFlag2 && !set &&
+            flags & (hidden_WidgetFlag | collapse_WidgetFlag)) {
+            /* Was skipped while collapsed. Mark the path from the root so the next
+               `arrangePending_Widget()` pass can find it. */
+            for (iWidget *w = d->parent; w && ~w->flags2 & descendantArrangementPending_WidgetFlag2;
+                 w = w->parent) {
+                w->flags2 |= descendantArrangementPending_WidgetFlag2;
+            }
+        }
 #if !defined (NDEBUG)
         if (d->flags & arrangeWidth_WidgetFlag &&
             d->flags & resizeToParentWidth_WidgetFlag) {
@@ -410,6 +465,9 @@ void showCollapsed_Widget(iWidget *d, iBool show) {
 void setVisualOffset_Widget(iWidget *d, int value, uint32_t span, int animFlags) {
     setFlags_Widget(d, visualOffset_WidgetFlag, iTrue);
     if (span == 0) {
+        if (d->root) {
+            postRefresh_Window(d->root->window); /* the previous position needs redrawing, too */
+        }
         init_Anim(&d->visualOffset, value);
         if (value == 0) {
             setFlags_Widget(d, visualOffset_WidgetFlag, iFalse); /* offset is being reset */
@@ -447,6 +505,10 @@ void setRoot_Widget(iWidget *d, iRoot *root) {
         }
     }
     if (d->root != root) {
+        if (!isEmpty_String(&d->id)) {
+            removeWidgetId_Root(d->root, d);
+            insertWidgetId_Root(root, d);
+        }
         d->root = root;
         if (class_Widget(d)->rootChanged) {
             class_Widget(d)->rootChanged(d);
@@ -475,6 +537,18 @@ iLocalDef iBool doesAffectSizing_Widget_(const iWidget *d) {
     return !isCollapsed_Widget_(d) && isArrangedPos_Widget_(d);
 }
 
+static const iWidget *arrangeRoot_Widget_; /* widget passed to arrange_Widget() */
+
+static iBool isArrangementDeferred_Widget_(iWidget *d) {
+    /* Collapsed floating layers (menus, dialogs) have no effect on the rest of the tree, so
+       they are only arranged when they are shown or arranged directly. */
+    if (d != arrangeRoot_Widget_ && d->flags & keepOnTop_WidgetFlag && isCollapsed_Widget_(d)) {
+        d->flags2 |= arrangementPending_WidgetFlag2;
+        return iTrue;
+    }
+    return iFalse;
+}
+
 static int numExpandingChildren_Widget_(const iWidget *d) {
     int count = 0;
     iConstForEach(ObjectList, i, d->children) {
@@ -658,7 +732,13 @@ static void boundsOfChildren_Widget_(const iWidget *d, iRect *bounds_out) {
 }
 
 static void arrange_Widget_(iWidget *d) {
+    if (isArrangementDeferred_Widget_(d)) {
+        TRACE(d, "collapsed, arrangement deferred");
+        return;
+    }
+    d->flags2 &= ~(arrangementPending_WidgetFlag2 | descendantArrangementPending_WidgetFlag2);
     TRACE(d, "arranging...");
+    countArranged_Profiler();
     if (d->sizeRef) {
         d->rect.size.y = height_Widget(d->sizeRef);
         TRACE(d, "use referenced height: %d", d->rect.size.y);
@@ -988,6 +1068,9 @@ static void arrange_Widget_(iWidget *d) {
 }
 
 static void resetArrangement_Widget_(iWidget *d) {
+    if (isArrangementDeferred_Widget_(d)) {
+        return;
+    }
     d->oldSize = d->rect.size;
     if (d->flags & resizeToParentWidth_WidgetFlag) {
         d->rect.size.x = 0;
@@ -1026,7 +1109,7 @@ static void resetArrangement_Widget_(iWidget *d) {
 }
 
 static void notifyArrangement_Widget_(iWidget *d) {
-    if (d->flags & destroyPending_WidgetFlag) {
+    if (d->flags & destroyPending_WidgetFlag || d->flags2 & arrangementPending_WidgetFlag2) {
         return;
     }
     if (class_Widget(d)->sizeChanged && !isEqual_I2(d->rect.size, d->oldSize)) {
@@ -1040,6 +1123,9 @@ static void notifyArrangement_Widget_(iWidget *d) {
 static void clampCenteredInRoot_Widget_(iWidget *d) {
     /* When arranging, we don't yet know if centered widgets will end up outside the root
        area, because the parent sizes and positions may change. */
+    if (d->flags2 & arrangementPending_WidgetFlag2) {
+        return;
+    }
     if (d->flags & centerHorizontal_WidgetFlag) {
         iRect rootRect = safeRect_Root(d->root);
         iRect bounds = boundsWithoutVisualOffset_Widget(d);
@@ -1072,10 +1158,16 @@ void arrange_Widget(iWidget *d) {
             puts("\n==== NEW WIDGET ARRANGEMENT ====\n");
         }
 #endif
+        beginPhase_Profiler(arrange_ProfilerPhase);
+        const iWidget *oldRoot = arrangeRoot_Widget_;
+        arrangeRoot_Widget_ = d;
+        d->flags2 &= ~arrangementPending_WidgetFlag2;
         resetArrangement_Widget_(d); /* back to initial default sizes */
         arrange_Widget_(d);
         clampCenteredInRoot_Widget_(d);
         notifyArrangement_Widget_(d);
+        arrangeRoot_Widget_ = oldRoot;
+        endPhase_Profiler(arrange_ProfilerPhase);
         d->root->didChangeArrangement = iTrue;
         if (isExtraWindowSizeInfluencer_Widget(d)) {
             /* Size of extra windows will change depending on the contents. */
@@ -1088,6 +1180,24 @@ void arrange_Widget(iWidget *d) {
     }
 }
 
+void arrangePending_Widget(iWidget *d) {
+    if (!d) {
+        return;
+    }
+    if (d->flags2 & arrangementPending_WidgetFlag2) {
+        if (!isCollapsed_Widget_(d)) {
+            arrange_Widget(d); /* floating layer, so the rest of the tree is unaffected */
+        }
+        return;
+    }
+    if (d->flags2 & descendantArrangementPending_WidgetFlag2) {
+        d->flags2 &= ~descendantArrangementPending_WidgetFlag2;
+        iForEach(ObjectList, i, d->children) {
+            arrangePending_Widget(i.object);
+        }
+    }
+}
+
 iBool isBeingVisuallyOffsetByReference_Widget(const iWidget *d) {
     return visualOffsetByReference_Widget(d) != 0;
 }
@@ -1975,6 +2085,18 @@ iLocalDef void incrementDrawCount_(const iWidget *d) {
     }
 }
 
+static void drawWithClass_Widget_(const iWidget *d) {
+    incrementDrawCount_(d);
+    iConstCast(iWidget *, d)->drawnRect = boundsForDraw_Widget_(d);
+    if (isEnabled_Profiler()) {
+        beginDraw_Profiler(class_Widget(d));
+        class_Widget(d)->draw(d);
+        endDraw_Profiler();
+        return;
+    }
+    class_Widget(d)->draw(d);
+}
+
 void drawChildren_Widget(const iWidget *d) {
     if (!isDrawn_Widget_(d)) {
         return;
@@ -1982,8 +2104,7 @@ void drawChildren_Widget(const iWidget *d) {
     iConstForEach(ObjectList, i, d->children) {
         const iWidget *child = constAs_Widget(i.object);
         if (~child->flags & keepOnTop_WidgetFlag && isDrawn_Widget_(child)) {
-            incrementDrawCount_(child);
-            class_Widget(child)->draw(child);
+            drawWithClass_Widget_(child);
         }
     }
 }
@@ -1995,8 +2116,7 @@ void drawRoot_Widget(const iWidget *d) {
     init_PtrArray(&pvs);
     findPotentiallyVisible_Widget_(d, &pvs);
     iReverseConstForEach(PtrArray, i, &pvs) {
-        incrementDrawCount_(i.ptr);
-        class_Widget(i.ptr)->draw(i.ptr);
+        drawWithClass_Widget_(i.ptr);
     }
     deinit_PtrArray(&pvs);
 }
@@ -2039,7 +2159,7 @@ static void beginBufferDraw_Widget_(const iWidget *d) {
 static void endBufferDraw_Widget_(const iWidget *d) {
     if (d->drawBuf) {
         d->drawBuf->isValid = iTrue;
-        SDL_SetRenderTarget(renderer_Window(get_Window()), d->drawBuf->oldTarget);
+        restoreRenderTarget_Paint(renderer_Window(get_Window()), d->drawBuf->oldTarget);
         origin_Paint = d->drawBuf->oldOrigin;
 //        printf("endBufferDraw: origin %d,%d\n", origin_Paint.x, origin_Paint.y);
 //        fflush(stdout);
@@ -2183,6 +2303,9 @@ iAny *removeChild_Widget(iWidget *d, iAnyObject *child) {
     }
     iAssert(found);
     iWidget *childWidget = child;
+    if (childWidget->root) {
+        postDamage_Widget_(childWidget); /* may extend outside the parent */
+    }
 //    if (childWidget->flags & keepOnTop_WidgetFlag) {
 //        removeOne_PtrArray(onTop_Root(childWidget->root), childWidget);
 //        iAssert(indexOf_PtrArray(onTop_Root(childWidget->root), childWidget) == iInvalidPos);
@@ -2267,18 +2390,41 @@ iAny *hitChild_Widget(const iWidget *d, iInt2 coord) {
     return NULL;
 }
 
-iAny *findChild_Widget(const iWidget *d, const char *id) {
-    if (!d) return NULL;
+static iAny *searchChild_Widget_(const iWidget *d, const char *id) {
     if (cmp_String(id_Widget(d), id) == 0) {
         return iConstCast(iAny *, d);
     }
     iConstForEach(ObjectList, i, d->children) {
-        iAny *found = findChild_Widget(constAs_Widget(i.object), id);
+        iAny *found = searchChild_Widget_(constAs_Widget(i.object), id);
         if (found) return found;
     }
     return NULL;
 }
 
+iAny *findChild_Widget(const iWidget *d, const char *id) {
+    if (!d) return NULL;
+    if (!*id || !d->root) {
+        return searchChild_Widget_(d, id);
+    }
+    /* Look up the widgets with this ID and check which ones are in the subtree. */
+    const iPtrArray *candidates = widgetsWithId_Root(d->root, id);
+    const iWidget   *found      = NULL;
+    if (!candidates) {
+        return NULL;
+    }
+    iConstForEach(PtrArray, i, candidates) {
+        const iWidget *w = i.ptr;
+        if (cmp_String(id_Widget(w), id) == 0 && (w == d || hasParent_Widget(w, d))) {
+            if (found) {
+                /* Several matches; the first one in tree order is the result. */
+                return searchChild_Widget_(d, id);
+            }
+            found = w;
+        }
+    }
+    return iConstCast(iAny *, found);
+}
+
 static void addMatchingToArray_Widget_(const iWidget *d, const iRangecc id, iPtrArray *found) {
     if (cmp_String(id_Widget(d), id.start) == 0) {
         pushBack_PtrArray(found, d);
@@ -2635,7 +2781,7 @@ void refresh_Widget(const iAnyObject *d) {
             w->drawBuf->isValid = iFalse;
         }
     }
-    postRefresh_Window(window_Widget(d));
+    postDamage_Widget_(d);
 }
 
 void raise_Widget(iWidget *d) {
@@ -137,6 +137,9 @@ enum iWidgetFlag2 {
     leftEdgeResizing_WidgetFlag2            = iBit(10),
     rightEdgeResizing_WidgetFlag2           = iBit(11),
     childMenuOpenedAsPopup_WidgetFlag2      = iBit(12),
+    arrangementPending_WidgetFlag2          = iBit(13), /* skipped while collapsed; arranged when shown */
+    descendantArrangementPending_WidgetFlag2 = iBit(14), /* path to a shown pending widget */
+    drawsWithinBounds_WidgetFlag2           = iBit(15), /* class does not draw outside bounds; partial redraw ok */
 };
 
 enum iWidgetAddPos {
@@ -174,6 +177,7 @@ struct Impl_Widget {
     iWidget *    parent;
     iRoot *      root;
     iWidgetDrawBuffer *drawBuf;
+    iRect        drawnRect; /* window coordinates when last drawn; redrawn if it moves or hides */
     iAnim        overflowScrollOpacity; /* scrollbar fading */
     iString      data; /* custom user data */
     /* Callbacks. */
@@ -333,6 +337,7 @@ iAny *  child_Widget                (iWidget *, size_t index); /* O(n) */
 size_t  indexOfChild_Widget         (const iWidget *, const iAnyObject *child); /* O(n) */
 void    changeChildIndex_Widget     (iWidget *, iAnyObject *child, size_t newIndex); /* O(n) */
 void    arrange_Widget              (iWidget *);
+void    arrangePending_Widget       (iWidget *); /* only widgets shown since they were skipped */
 iBool   scrollOverflow_Widget       (iWidget *, int delta); /* moves the widget */
 void    applyInteractiveResize_Widget(iWidget *, int width);
 iBool   dispatchEvent_Widget        (iWidget *, const SDL_Event *);
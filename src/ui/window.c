@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 #include "documentwidget.h"
 #include "sidebarwidget.h"
 #include "paint.h"
+#include "profiler.h"
 #include "snippets.h"
 #include "root.h"
 #include "touch.h"
@@ -621,6 +622,8 @@ void init_Window(iWindow *d, enum iWindowType type, iRect rect, uint32_t flags)
     d->isInvalidated = iFalse; /* set when posting event, to avoid repeated events */
     d->isMouseInside = iTrue;
     set_Atomic(&d->isRefreshPending, iTrue);
+    set_Atomic(&d->isFullRedrawPending, iTrue);
+    d->damage        = zero_Rect();
     d->ignoreClick   = iFalse;
     d->focusGainedAt = SDL_GetTicks();
     d->frameTime     = SDL_GetTicks();
@@ -1569,10 +1572,14 @@ void draw_Window(iWindow *d) {
         return;
     }
     isDrawing_ = iTrue;
+    /* Always redrawn in full. */
+    set_Atomic(&d->isFullRedrawPending, iFalse);
+    d->damage = zero_Rect();
     iPaint p;
     init_Paint(&p);
     iRoot *root = d->roots[0];
     setCurrent_Root(root);
+    arrangePending_Widget(root->widget);
     unsetClip_Paint(&p); /* update clip to full window */
     const iColor back = get_Color(root->widget->bgColor != none_ColorId ?
                 root->widget->bgColor : uiBackground_ColorId);
@@ -1593,7 +1600,9 @@ void draw_Window(iWindow *d) {
                                 root->widget->frameColor);
     }
     setCurrent_Root(NULL);
+    beginPhase_Profiler(present_ProfilerPhase);
     SDL_RenderPresent(d->render);
+    endPhase_Profiler(present_ProfilerPhase);
     isDrawing_ = iFalse;
 }
 
@@ -1677,11 +1686,20 @@ void draw_MainWindow(iMainWindow *d) {
                                                SDL_TEXTUREACCESS_TARGET,
                                                w->size.x,
                                                w->size.y);
+                set_Atomic(&w->isFullRedrawPending, iTrue); /* nothing retained yet */
 //                printf("NEW BACKING: %dx%d %p\n", renderSize.x, renderSize.y, d->backBuf); fflush(stdout);
             }
         }
     }
     setCurrent_Window(d);
+    /* Floating layers that were shown since their arrangement was skipped. This may cause
+       a full redraw below, so it needs to happen before the damage is checked. */
+    iForIndices(i, w->roots) {
+        if (w->roots[i]) {
+            setCurrent_Root(w->roots[i]);
+            arrangePending_Widget(w->roots[i]->widget);
+        }
+    }
     const int   winFlags = SDL_GetWindowFlags(d->base.win);
     const iBool gotFocus = (winFlags & SDL_WINDOW_INPUT_FOCUS) != 0;
     iPaint p;
@@ -1689,6 +1707,21 @@ void draw_MainWindow(iMainWindow *d) {
     if (d->backBuf) {
         SDL_SetRenderTarget(d->base.render, d->backBuf);
     }
+    /* If the back buffer still has the previous frame, only the damaged area needs to be
+       redrawn. Moving widgets leave behind areas that aren't covered by the damage. */
+    const iRect damage = intersect_Rect(w->damage, (iRect){ zero_I2(), w->size });
+    iBool isPartial = !exchange_Atomic(&w->isFullRedrawPending, iFalse) && d->backBuf &&
+                      !isEmpty_Rect(damage);
+    w->damage = zero_Rect();
+    iForIndices(i, w->roots) {
+        const iRoot *root = w->roots[i];
+        if (root && (root->didChangeArrangement || root->didAnimateVisualOffsets)) {
+            isPartial = iFalse;
+        }
+    }
+    if (isOverlayVisible_Profiler()) {
+        isPartial = iFalse; /* the overlay is updated every frame */
+    }
     /* Clear the window. The clear color is visible as a border around the window
        when the custom frame is being used. */ {
         setCurrent_Root(w->roots[0]);
@@ -1710,9 +1743,16 @@ void draw_MainWindow(iMainWindow *d) {
             back = get_Color(uiBackground_ColorId);
 #endif
         }
-        unsetClip_Paint(&p); /* update clip to full window */
         SDL_SetRenderDrawColor(w->render, back.r, back.g, back.b, 255);
-        SDL_RenderClear(w->render);
+        if (isPartial) {
+            beginDamage_Paint(d->backBuf, damage);
+            SDL_RenderSetClipRect(w->render, (const SDL_Rect *) &damage);
+            SDL_RenderFillRect(w->render, (const SDL_Rect *) &damage);
+        }
+        else {
+            unsetClip_Paint(&p); /* update clip to full window */
+            SDL_RenderClear(w->render);
+        }
     }
     /* Draw widgets. */
     w->frameTime = SDL_GetTicks();
@@ -1778,6 +1818,11 @@ void draw_MainWindow(iMainWindow *d) {
                 }
             }
         }
+        if (isOverlayVisible_Profiler()) {
+            setCurrent_Root(w->roots[0]);
+            unsetClip_Paint(&p);
+            drawOverlay_Profiler();
+        }
         setCurrent_Root(NULL);
 #if !defined (NDEBUG)
         draw_Text(uiLabelBold_FontId,
@@ -1788,6 +1833,9 @@ void draw_MainWindow(iMainWindow *d) {
         drawCount_ = 0;
 #endif
     }
+    if (isPartial) {
+        endDamage_Paint();
+    }
     if (d->backBuf) {
         SDL_SetRenderTarget(d->base.render, NULL);
         SDL_RenderCopy(d->base.render, d->backBuf, NULL, NULL);
@@ -1800,7 +1848,9 @@ void draw_MainWindow(iMainWindow *d) {
         SDL_RenderCopy(d->render, glyphCache_Text(), NULL, &rect);
     }
 #endif
+    beginPhase_Profiler(present_ProfilerPhase);
     SDL_RenderPresent(w->render);
+    endPhase_Profiler(present_ProfilerPhase);
     isDrawing_ = iFalse;
 }
 
@@ -93,6 +93,8 @@ struct Impl_Window {
     iBool         isMouseInside;
     iBool         isInvalidated;
     iAtomicInt    isRefreshPending;
+    iAtomicInt    isFullRedrawPending; /* something outside `damage` needs to be redrawn */
+    iRect         damage;       /* union of refreshed widget bounds since the last draw */
     iBool         ignoreClick; /* used on the Windows platform only */
     uint32_t      focusGainedAt;
     SDL_Renderer *render;
@@ -169,6 +171,7 @@ iBool       isOpenGLRenderer_Window (void);
 
 void        setCurrent_Window       (iAnyWindow *);
 void        postRefresh_Window      (iAnyWindow *);
+void        postRefreshRect_Window  (iAnyWindow *, iRect damage);
 
 iLocalDef iBool isExposed_Window(const iWindow *d) {
     iAssert(d);
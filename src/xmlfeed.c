@@ -0,0 +1,655 @@
+/* Copyright 2026 Jaakko Keränen <jaakko.keranen@iki.fi>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+#include "xmlfeed.h"
+
+#include <ctype.h>
+#include <string.h>
+
+enum iXmlFeedField {
+    none_XmlFeedField,
+    title_XmlFeedField,
+    subtitle_XmlFeedField,
+    entryTitle_XmlFeedField,
+    entryLink_XmlFeedField,
+    entryGuid_XmlFeedField,
+    entryUpdated_XmlFeedField,
+    entryPublished_XmlFeedField,
+};
+
+struct Impl_XmlFeedParser {
+    enum iXmlFeedFormat format;
+    iBool               isAborted;
+    iString             title;
+    iString             subtitle;
+    int                 depth;        /* of the innermost open element */
+    int                 channelDepth; /* feed metadata is in the children of this element */
+    int                 entryDepth;   /* zero when not inside an entry */
+    enum iXmlFeedField  field;        /* text content is currently collected for this */
+    int                 fieldDepth;
+    iString             text;
+    iXmlFeedEntry       entry;
+    int                 linkRank; /* suitability of the current entry URL */
+    iString             updated;
+    iString             published;
+    iXmlFeedEntryFunc   entryFunc;
+    void *              context;
+};
+
+iDefineTypeConstruction(XmlFeedParser)
+
+void init_XmlFeedParser(iXmlFeedParser *d) {
+    d->format = none_XmlFeedFormat;
+    d->isAborted = iFalse;
+    init_String(&d->title);
+    init_String(&d->subtitle);
+    d->depth = 0;
+    d->channelDepth = 0;
+    d->entryDepth = 0;
+    d->field = none_XmlFeedField;
+    d->fieldDepth = 0;
+    init_String(&d->text);
+    init_String(&d->entry.title);
+    init_String(&d->entry.url);
+    iZap(d->entry.date);
+    d->linkRank = 0;
+    init_String(&d->updated);
+    init_String(&d->published);
+    d->entryFunc = NULL;
+    d->context = NULL;
+}
+
+void deinit_XmlFeedParser(iXmlFeedParser *d) {
+    deinit_String(&d->published);
+    deinit_String(&d->updated);
+    deinit_String(&d->entry.url);
+    deinit_String(&d->entry.title);
+    deinit_String(&d->text);
+    deinit_String(&d->subtitle);
+    deinit_String(&d->title);
+}
+
+void setEntryHandler_XmlFeedParser(iXmlFeedParser *d, iXmlFeedEntryFunc entryFunc,
+                                   void *context) {
+    d->entryFunc = entryFunc;
+    d->context   = context;
+}
+
+enum iXmlFeedFormat format_XmlFeedParser(const iXmlFeedParser *d) {
+    return d->format;
+}
+
+const iString *title_XmlFeedParser(const iXmlFeedParser *d) {
+    return &d->title;
+}
+
+const iString *subtitle_XmlFeedParser(const iXmlFeedParser *d) {
+    return &d->subtitle;
+}
+
+iBool isXmlMimeType_XmlFeed(const iString *mime) {
+    static const char *xmlTypes_[] = {
+        "application/xml", "text/xml", "application/atom+xml", "application/rss+xml",
+    };
+    iForIndices(i, xmlTypes_) {
+        if (startsWithCase_String(mime, xmlTypes_[i])) {
+            return iTrue;
+        }
+    }
+    return iFalse;
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+static const char *find_(const char *pos, const char *end, const char *str) {
+    const size_t len = strlen(str);
+    while (end - pos >= (ptrdiff_t) len) {
+        const char *found = memchr(pos, str[0], end - pos - len + 1);
+        if (!found) {
+            break;
+        }
+        if (!memcmp(found, str, len)) {
+            return found;
+        }
+        pos = found + 1;
+    }
+    return NULL;
+}
+
+static iBool isSpace_(char c) {
+    return isspace((unsigned char) c) != 0;
+}
+
+static iRangecc localName_(iRangecc name) {
+    for (const char *i = name.start; i < name.end; i++) {
+        if (*i == ':') {
+            name.start = i + 1;
+            break;
+        }
+    }
+    return name;
+}
+
+static iChar entityChar_(iRangecc entity) {
+    if (startsWith_Rangecc(entity, "#")) {
+        iChar ch = 0;
+        int   base = 10;
+        entity.start++;
+        if (startsWithCase_Rangecc(entity, "x")) {
+            base = 16;
+            entity.start++;
+        }
+        if (isEmpty_Range(&entity)) {
+            return 0;
+        }
+        for (const char *i = entity.start; i < entity.end; i++) {
+            const int c = tolower((unsigned char) *i);
+            int digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            }
+            else if (base == 16 && c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            }
+            else {
+                return 0;
+            }
+            ch = ch * base + digit;
+            if (ch > 0x10ffff) {
+                return 0;
+            }
+        }
+        return ch;
+    }
+    static const struct {
+        const char *name;
+        iChar       ch;
+    } named_[] = {
+        { "lt", '<' }, { "gt", '>' }, { "amp", '&' }, { "quot", '"' }, { "apos", '\'' },
+    };
+    iForIndices(i, named_) {
+        if (equal_Rangecc(entity, named_[i].name)) {
+            return named_[i].ch;
+        }
+    }
+    return 0;
+}
+
+static void appendDecoded_(iString *d, iRangecc text) {
+    const char *pos = text.start;
+    while (pos < text.end) {
+        const char *amp = memchr(pos, '&', text.end - pos);
+        if (!amp) {
+            appendRange_String(d, (iRangecc){ pos, text.end });
+            break;
+        }
+        appendRange_String(d, (iRangecc){ pos, amp });
+        const char *semi = memchr(amp, ';', iMin(text.end - amp, 12));
+        const iChar ch   = semi ? entityChar_((iRangecc){ amp + 1, semi }) : 0;
+        if (ch) {
+            appendChar_String(d, ch);
+            pos = semi + 1;
+        }
+        else {
+            /* Unknown entity or a stray ampersand; keep as is. */
+            appendChar_String(d, '&');
+            pos = amp + 1;
+        }
+    }
+}
+
+static void normalizeSpace_(iString *d) {
+    /* Collapse all whitespace, including newlines, to single spaces. */
+    iString norm;
+    init_String(&norm);
+    iBool pendingSpace = iFalse;
+    for (const char *i = constBegin_String(d), *end = constEnd_String(d); i != end; i++) {
+        if (isSpace_(*i)) {
+            pendingSpace = !isEmpty_String(&norm);
+            continue;
+        }
+        if (pendingSpace) {
+            appendChar_String(&norm, ' ');
+            pendingSpace = iFalse;
+        }
+        appendCStrN_String(&norm, i, 1);
+    }
+    set_String(d, &norm);
+    deinit_String(&norm);
+}
+
+static iBool attribute_(iRangecc attrs, const char *name, iString *value_out) {
+    const char *pos = attrs.start;
+    while (pos < attrs.end) {
+        while (pos < attrs.end && isSpace_(*pos)) {
+            pos++;
+        }
+        iRangecc attrName = { pos, pos };
+        while (attrName.end < attrs.end && *attrName.end != '=' && !isSpace_(*attrName.end)) {
+            attrName.end++;
+        }
+        pos = attrName.end;
+        while (pos < attrs.end && isSpace_(*pos)) {
+            pos++;
+        }
+        if (pos == attrs.end || *pos != '=') {
+            if (isEmpty_Range(&attrName)) {
+                break;
+            }
+            continue; /* no value */
+        }
+        pos++;
+        while (pos < attrs.end && isSpace_(*pos)) {
+            pos++;
+        }
+        if (pos == attrs.end || (*pos != '"' && *pos != '\'')) {
+            break; /* malformed */
+        }
+        const char *valueStart = pos + 1;
+        const char *valueEnd   = memchr(valueStart, *pos, attrs.end - valueStart);
+        if (!valueEnd) {
+            break;
+        }
+        if (equal_Rangecc(attrName, name)) {
+            clear_String(value_out);
+            appendDecoded_(value_out, (iRangecc){ valueStart, valueEnd });
+            return iTrue;
+        }
+        pos = valueEnd + 1;
+    }
+    return iFalse;
+}
+
+static const char *endOfTag_(const char *pos, const char *end) {
+    /* Attribute values may contain '>'. */
+    char quote = 0;
+    for (; pos < end; pos++) {
+        if (quote) {
+            if (*pos == quote) {
+                quote = 0;
+            }
+        }
+        else if (*pos == '"' || *pos == '\'') {
+            quote = *pos;
+        }
+        else if (*pos == '>') {
+            return pos;
+        }
+    }
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+static int parseNumber_(iRangecc *range, int maxDigits) {
+    int num = 0;
+    int count = 0;
+    while (range->start < range->end && count < maxDigits && isdigit((unsigned char) *range->start)) {
+        num = num * 10 + (*range->start++ - '0');
+        count++;
+    }
+    return count ? num : -1;
+}
+
+static iBool isValidDate_(const iDate *date) {
+    return date->year > 0 && date->month >= 1 && date->month <= 12 && date->day >= 1 &&
+           date->day <= 31;
+}
+
+static iBool parseIsoDate_(iRangecc text, iDate *date_out) {
+    /* YYYY-MM-DD, optionally followed by the time. */
+    iDate date;
+    iZap(date);
+    if ((date.year = parseNumber_(&text, 4)) < 0 || !startsWith_Rangecc(text, "-")) {
+        return iFalse;
+    }
+    text.start++;
+    if ((date.month = parseNumber_(&text, 2)) < 0 || !startsWith_Rangecc(text, "-")) {
+        return iFalse;
+    }
+    text.start++;
+    date.day = parseNumber_(&text, 2);
+    if (!isValidDate_(&date) || (!isEmpty_Range(&text) && *text.start != 'T' &&
+                                 *text.start != 't' && !isSpace_(*text.start))) {
+        return iFalse;
+    }
+    *date_out = date;
+    return iTrue;
+}
+
+static iBool parseRfc822Date_(iRangecc text, iDate *date_out) {
+    /* [Day,] DD Mon YYYY HH:MM:SS Zone */
+    static const char *months_[] = {
+        "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec"
+    };
+    iDate date;
+    iZap(date);
+    for (const char *i = text.start; i < text.end && i < text.start + 16; i++) {
+        if (*i == ',') {
+            text.start = i + 1;
+            break;
+        }
+    }
+    trimStart_Rangecc(&text);
+    if ((date.day = parseNumber_(&text, 2)) < 0) {
+        return iFalse;
+    }
+    trimStart_Rangecc(&text);
+    if (size_Range(&text) < 3) {
+        return iFalse;
+    }
+    iForIndices(i, months_) {
+        if (equalCase_Rangecc((iRangecc){ text.start, text.start + 3 }, months_[i])) {
+            date.month = (int) i + 1;
+            break;
+        }
+    }
+    while (text.start < text.end && isalpha((unsigned char) *text.start)) {
+        text.start++;
+    }
+    trimStart_Rangecc(&text);
+    const char *yearStart = text.start;
+    date.year = parseNumber_(&text, 4);
+    if (date.year >= 0 && text.start - yearStart == 2) {
+        date.year += (date.year < 50 ? 2000 : 1900);
+    }
+    if (!isValidDate_(&date)) {
+        return iFalse;
+    }
+    *date_out = date;
+    return iTrue;
+}
+
+static iBool parseDate_(const iString *text, iDate *date_out) {
+    iRangecc range = range_String(text);
+    trim_Rangecc(&range);
+    return parseIsoDate_(range, date_out) || parseRfc822Date_(range, date_out);
+}
+
+/*----------------------------------------------------------------------------------------------*/
+
+static void offerLink_XmlFeedParser_(iXmlFeedParser *d, const iString *url, int rank) {
+    if (isEmpty_String(url)) {
+        return;
+    }
+    if (startsWithCase_String(url, "gemini:")) {
+        rank = 3; /* the best kind */
+    }
+    if (rank > d->linkRank) {
+        set_String(&d->entry.url, url);
+        d->linkRank = rank;
+    }
+}
+
+static void beginEntry_XmlFeedParser_(iXmlFeedParser *d) {
+    d->entryDepth = d->depth;
+    clear_String(&d->entry.title);
+    clear_String(&d->entry.url);
+    iZap(d->entry.date);
+    d->linkRank = 0;
+    clear_String(&d->updated);
+    clear_String(&d->published);
+}
+
+static void endEntry_XmlFeedParser_(iXmlFeedParser *d) {
+    d->entryDepth = 0;
+    if (!parseDate_(&d->updated, &d->entry.date)) {
+        parseDate_(&d->published, &d->entry.date);
+    }
+    trim_String(&d->entry.url);
+    if (d->entryFunc) {
+        d->entryFunc(d->context, &d->entry);
+    }
+}
+
+static void beginField_XmlFeedParser_(iXmlFeedParser *d, enum iXmlFeedField field) {
+    d->field      = field;
+    d->fieldDepth = d->depth;
+    clear_String(&d->text);
+}
+
+static void endField_XmlFeedParser_(iXmlFeedParser *d) {
+    iString *text = &d->text;
+    switch (d->field) {
+        case title_XmlFeedField:
+            normalizeSpace_(text);
+            set_String(&d->title, text);
+            break;
+        case subtitle_XmlFeedField:
+            normalizeSpace_(text);
+            set_String(&d->subtitle, text);
+            break;
+        case entryTitle_XmlFeedField:
+            normalizeSpace_(text);
+            set_String(&d->entry.title, text);
+            break;
+        case entryLink_XmlFeedField:
+            trim_String(text);
+            offerLink_XmlFeedParser_(d, text, 2);
+            break;
+        case entryGuid_XmlFeedField:
+            trim_String(text);
+            if (indexOfCStr_String(text, "://") != iInvalidPos) {
+                offerLink_XmlFeedParser_(d, text, 1);
+            }
+            break;
+        case entryUpdated_XmlFeedField:
+            set_String(&d->updated, text);
+            break;
+        case entryPublished_XmlFeedField:
+            if (isEmpty_String(&d->published)) {
+                set_String(&d->published, text);
+            }
+            break;
+        case none_XmlFeedField:
+            break;
+    }
+    d->field = none_XmlFeedField;
+}
+
+static void startElement_XmlFeedParser_(iXmlFeedParser *d, iRangecc name, iRangecc attrs) {
+    d->depth++;
+    if (d->format == none_XmlFeedFormat) {
+        /* The root element determines the format. */
+        if (equal_Rangecc(name, "feed")) {
+            d->format       = atom_XmlFeedFormat;
+            d->channelDepth = d->depth;
+        }
+        else if (equal_Rangecc(name, "rss") || equal_Rangecc(name, "RDF")) {
+            d->format = rss_XmlFeedFormat;
+        }
+        else {
+            d->isAborted = iTrue;
+        }
+        return;
+    }
+    if (d->field != none_XmlFeedField) {
+        return; /* markup inside text content */
+    }
+    const iBool isAtom = (d->format == atom_XmlFeedFormat);
+    if (!d->entryDepth) {
+        if (equal_Rangecc(name, isAtom ? "entry" : "item")) {
+            beginEntry_XmlFeedParser_(d);
+        }
+        else if (!isAtom && !d->channelDepth && equal_Rangecc(name, "channel")) {
+            d->channelDepth = d->depth;
+        }
+        else if (d->channelDepth && d->depth == d->channelDepth + 1) {
+            if (equal_Rangecc(name, "title")) {
+                beginField_XmlFeedParser_(d, title_XmlFeedField);
+            }
+            else if (equal_Rangecc(name, isAtom ? "subtitle" : "description")) {
+                beginField_XmlFeedParser_(d, subtitle_XmlFeedField);
+            }
+        }
+        return;
+    }
+    if (d->depth != d->entryDepth + 1) {
+        return;
+    }
+    iString *value = new_String();
+    if (equal_Rangecc(name, "title")) {
+        beginField_XmlFeedParser_(d, entryTitle_XmlFeedField);
+    }
+    else if (equal_Rangecc(name, "link")) {
+        /* Atom links are in attributes; RSS feeds may also include Atom links. */
+        if (attribute_(attrs, "href", value)) {
+            iString *rel = new_String();
+            const iBool isAlternate =
+                !attribute_(attrs, "rel", rel) || equalCase_String(rel, "alternate");
+            offerLink_XmlFeedParser_(d, value, isAlternate ? 2 : 1);
+            delete_String(rel);
+        }
+        else if (!isAtom) {
+            beginField_XmlFeedParser_(d, entryLink_XmlFeedField);
+        }
+    }
+    else if (isAtom) {
+        if (equal_Rangecc(name, "updated")) {
+            beginField_XmlFeedParser_(d, entryUpdated_XmlFeedField);
+        }
+        else if (equal_Rangecc(name, "published")) {
+            beginField_XmlFeedParser_(d, entryPublished_XmlFeedField);
+        }
+    }
+    else {
+        if (equal_Rangecc(name, "pubDate") || equal_Rangecc(name, "date")) {
+            beginField_XmlFeedParser_(d, entryPublished_XmlFeedField);
+        }
+        else if (equal_Rangecc(name, "guid")) {
+            if (!attribute_(attrs, "isPermaLink", value) || !equal_String(value, "false")) {
+                beginField_XmlFeedParser_(d, entryGuid_XmlFeedField);
+            }
+        }
+    }
+    delete_String(value);
+}
+
+static void endElement_XmlFeedParser_(iXmlFeedParser *d) {
+    if (d->depth <= 0) {
+        return;
+    }
+    if (d->field != none_XmlFeedField && d->depth == d->fieldDepth) {
+        endField_XmlFeedParser_(d);
+    }
+    if (d->entryDepth && d->depth == d->entryDepth) {
+        endEntry_XmlFeedParser_(d);
+    }
+    if (d->depth == d->channelDepth) {
+        d->channelDepth = 0;
+    }
+    d->depth--;
+}
+
+static void text_XmlFeedParser_(iXmlFeedParser *d, iRangecc text, iBool isRaw) {
+    if (d->field == none_XmlFeedField) {
+        return;
+    }
+    if (isRaw) {
+        appendRange_String(&d->text, text);
+    }
+    else {
+        appendDecoded_(&d->text, text);
+    }
+}
+
+iBool parse_XmlFeedParser(iXmlFeedParser *d, iRangecc source) {
+    d->format       = none_XmlFeedFormat;
+    d->isAborted    = iFalse;
+    d->depth        = 0;
+    d->channelDepth = 0;
+    d->entryDepth   = 0;
+    d->field        = none_XmlFeedField;
+    clear_String(&d->title);
+    clear_String(&d->subtitle);
+    const char *pos = source.start;
+    const char *end = source.end;
+    if (startsWith_Rangecc(source, "\xef\xbb\xbf")) {
+        pos += 3; /* byte order mark */
+    }
+    while (pos < end && !d->isAborted) {
+        if (*pos != '<') {
+            const char *next = memchr(pos, '<', end - pos);
+            if (!next) {
+                next = end;
+            }
+            text_XmlFeedParser_(d, (iRangecc){ pos, next }, iFalse);
+            pos = next;
+            continue;
+        }
+        const iRangecc rest = { pos, end };
+        if (startsWith_Rangecc(rest, "<!--")) {
+            const char *close = find_(pos + 4, end, "-->");
+            pos = close ? close + 3 : end;
+        }
+        else if (startsWith_Rangecc(rest, "<![CDATA[")) {
+            const char *close = find_(pos + 9, end, "]]>");
+            text_XmlFeedParser_(d, (iRangecc){ pos + 9, close ? close : end }, iTrue);
+            pos = close ? close + 3 : end;
+        }
+        else if (startsWith_Rangecc(rest, "<?")) {
+            const char *close = find_(pos + 2, end, "?>");
+            pos = close ? close + 2 : end;
+        }
+        else if (startsWith_Rangecc(rest, "<!")) {
+            /* Document type declaration, possibly with an internal subset. */
+            int nesting = 0;
+            for (pos += 2; pos < end; pos++) {
+                if (*pos == '[') {
+                    nesting++;
+                }
+                else if (*pos == ']') {
+                    nesting--;
+                }
+                else if (*pos == '>' && nesting <= 0) {
+                    pos++;
+                    break;
+                }
+            }
+        }
+        else {
+            const char *close = endOfTag_(pos + 1, end);
+            if (!close) {
+                break; /* truncated */
+            }
+            iRangecc tag = { pos + 1, close };
+            pos = close + 1;
+            if (startsWith_Rangecc(tag, "/")) {
+                endElement_XmlFeedParser_(d);
+                continue;
+            }
+            const iBool isEmpty = endsWith_Rangecc(tag, "/");
+            if (isEmpty) {
+                tag.end--;
+            }
+            iRangecc name = { tag.start, tag.start };
+            while (name.end < tag.end && !isSpace_(*name.end)) {
+                name.end++;
+            }
+            startElement_XmlFeedParser_(d, localName_(name), (iRangecc){ name.end, tag.end });
+            if (isEmpty) {
+                endElement_XmlFeedParser_(d);
+            }
+        }
+    }
+    return d->format != none_XmlFeedFormat;
+}
@@ -0,0 +1,59 @@
+/* Copyright 2026 Jaakko Keränen <jaakko.keranen@iki.fi>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+#pragma once
+
+#include <the_Foundation/string.h>
+#include <the_Foundation/time.h>
+
+/* Streaming parser for Atom and RSS feeds. The source is tokenized in a single pass
+   without building a document tree, and each entry is handed to a callback as soon as
+   its end tag has been seen. Only the fields needed for subscriptions are kept. */
+
+enum iXmlFeedFormat {
+    none_XmlFeedFormat,
+    atom_XmlFeedFormat,
+    rss_XmlFeedFormat, /* RSS 2.0 or RDF-based RSS 1.0 */
+};
+
+iDeclareType(XmlFeedEntry)
+
+struct Impl_XmlFeedEntry {
+    iString title; /* whitespace normalized */
+    iString url;
+    iDate   date; /* only year, month, and day are set; year is zero if unknown */
+};
+
+iDeclareType(XmlFeedParser)
+iDeclareTypeConstruction(XmlFeedParser)
+
+typedef void (*iXmlFeedEntryFunc)(void *context, const iXmlFeedEntry *);
+
+void                setEntryHandler_XmlFeedParser   (iXmlFeedParser *, iXmlFeedEntryFunc entryFunc,
+                                                     void *context);
+iBool               parse_XmlFeedParser             (iXmlFeedParser *, iRangecc source);
+
+enum iXmlFeedFormat format_XmlFeedParser            (const iXmlFeedParser *);
+const iString *     title_XmlFeedParser             (const iXmlFeedParser *);
+const iString *     subtitle_XmlFeedParser          (const iXmlFeedParser *);
+
+iBool               isXmlMimeType_XmlFeed           (const iString *mime);